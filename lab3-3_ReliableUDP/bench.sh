@@ -0,0 +1,76 @@
+#!/bin/sh
+# RUDP吞吐基准矩阵，由 make bench 调用，也可直接 sh bench.sh
+# 每个组合启动一组 router/server/client，传输同一个文件，结果追加到CSV
+# 扫描维度可用环境变量覆盖，例如: LOSS="0 5" DELAY=20 REPEAT=1 make bench
+
+LOSS=${LOSS:-"0 5"}            # 丢包率(%)
+DELAY=${DELAY:-"5 20"}         # 单向延迟(ms)
+MSS=${MSS:-"1024 0"}           # 每个报文的数据长度，0表示BODY_SIZE
+ACK_DELAY=${ACK_DELAY:-"0 10"} # 服务端延迟ACK时长(ms)，0为逐包确认
+CC=${CC:-"reno fixed"}         # 拥塞控制算法
+ARQ=${ARQ:-"gbn sr"}           # 重传策略: sw(停等) gbn(回退N) sr(选择重传)
+COMPRESS=${COMPRESS:-raw}      # 负载压缩: raw lz，配合FILE=resources/helloworld.txt对比
+IO=${IO:-socket}               # 收发后端: socket uring，两端使用相同后端
+WINDOW=${WINDOW:-20}           # fixed算法使用的窗口大小
+REPEAT=${REPEAT:-3}
+FILE=${FILE:-resources/1.jpg}
+TIMEOUT=${TIMEOUT:-60}         # 单次运行的超时(s)
+OUT=${OUT:-bench.csv}
+
+BIN=./bin
+NAME=$(basename "$FILE")
+
+echo "loss,delay_ms,mss,ack_delay_ms,cc,arq,compress,io,run,bytes,completion_ms,goodput_mbps,packets_sent,retransmits,retrans_ratio,status" > "$OUT"
+
+for loss in $LOSS; do
+for delay in $DELAY; do
+for mss in $MSS; do
+for ack in $ACK_DELAY; do
+for cc in $CC; do
+for arq in $ARQ; do
+for compress in $COMPRESS; do
+for io in $IO; do
+run=1
+while [ $run -le "$REPEAT" ]; do
+    rm -f "download/$NAME"
+
+    # router读到EOF后停止接收控制命令，但转发线程继续工作
+    $BIN/router 5000 "$delay" "$loss" < /dev/null > /dev/null 2>&1 &
+    router_pid=$!
+    timeout "$TIMEOUT" $BIN/server "$ack" "$io" < /dev/null > /dev/null 2>&1 &
+    server_pid=$!
+    sleep 0.2
+
+    result=$(timeout "$TIMEOUT" $BIN/client "$FILE" "$mss" "$cc" "$WINDOW" "$arq" "$compress" "$io" < /dev/null 2> /dev/null | grep '^BENCH,')
+    wait $server_pid
+    kill $router_pid 2> /dev/null
+    wait $router_pid 2> /dev/null
+
+    if [ -z "$result" ]; then
+        status=timeout
+        result="BENCH,,,,"
+    elif cmp -s "download/$NAME" "$FILE"; then
+        status=ok
+    else
+        status=corrupt
+    fi
+
+    echo "$result" | awk -F, -v prefix="$loss,$delay,$mss,$ack,$cc,$arq,$compress,$io,$run" -v status="$status" '{
+        goodput = $3 > 0 ? $2 * 8 / $3 / 1000 : 0
+        ratio   = $4 > 0 ? $5 / $4 : 0
+        printf "%s,%s,%s,%.3f,%s,%s,%.4f,%s\n", prefix, $2, $3, goodput, $4, $5, ratio, status
+    }' | tee -a "$OUT"
+
+    run=$((run + 1))
+done
+done
+done
+done
+done
+done
+done
+done
+done
+
+rm -f "download/$NAME"
+echo "Results written to $OUT"
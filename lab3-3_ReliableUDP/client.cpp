@@ -2,42 +2,37 @@
 #include <net/socket_defs.h>
 #include <net/rudp/rudp_defs.h>
 #include <net/rudp/rudp.h>
+#include <transfer/dir_sender.h>
+#include <transfer/file_sender.h>
 using namespace std;
 using namespace chrono;
 
-void sendFile(RUDP_C& client, const string& filePath)
+void printStats(RUDP_C& client)
 {
-    ifstream file(filePath, ios::binary);
-    if (!file.is_open())
-    {
-        cerr << "Failed to open file: " << filePath << endl;
-        return;
-    }
-
-    string fileName = filePath.substr(filePath.find_last_of("/\\") + 1);
-
-    string beginMessage = "File begin: " + fileName + "\r\n";
-    client.send(beginMessage.c_str(), beginMessage.size());
+    RUDP_Stats stats = client.stats();
+    cout << "Retransmissions so far: " << stats.timeout_retransmits << " on timeout, " << stats.fast_retransmits
+         << " fast; sRTT=" << stats.srtt_ms << "ms, cwnd=" << stats.cwnd << "." << endl;
+    if (stats.ecn_reductions)
+        cout << "Window reduced " << stats.ecn_reductions << " times on ECN echo without loss." << endl;
+    if (stats.compress_in)
+        cout << "Compression ratio: " << stats.compress_ratio << ", " << stats.compress_bypassed
+             << " segments bypassed, " << stats.compress_us << "us CPU." << endl;
+}
 
-    char   buffer[BODY_SIZE];
-    size_t totalBytesSent = 0;
+// delta为真时服务端已有同名文件则只发差异
+size_t sendFile(RUDP_C& client, const string& filePath, size_t mss = BODY_SIZE, bool delta = false)
+{
+    FileSender sender(client, mss);
+    sender.set_delta(delta);
 
     auto start = high_resolution_clock::now();
-
-    while (file)
+    if (!sender.send(filePath))
     {
-        file.read(buffer, BODY_SIZE);
-        size_t bytesRead = file.gcount();
-        if (bytesRead > 0)
-        {
-            client.send(buffer, bytesRead);
-            totalBytesSent += bytesRead;
-            // cout << "Sent " << totalBytesSent << " bytes so far..." << endl;
-        }
+        cerr << "Failed to open file: " << filePath << endl;
+        return 0;
     }
-
-    string endMessage = "File end\r\n";
-    client.send(endMessage.c_str(), endMessage.size());
+    size_t totalBytesSent = sender.bytes_sent();
+    string fileName       = filePath.substr(filePath.find_last_of("/\\") + 1);
 
     auto end      = high_resolution_clock::now();
     auto duration = duration_cast<milliseconds>(end - start);
@@ -47,22 +42,105 @@ void sendFile(RUDP_C& client, const string& filePath)
         double throughput = (totalBytesSent * 8.0) / duration.count() / 1000;
         cout << "File transfer completed in " << duration.count() << " milliseconds." << endl;
         cout << "Total data sent: " << totalBytesSent << " bytes." << endl;
+        if (sender.bytes_skipped())
+            cout << "Reused: " << sender.bytes_skipped() << " bytes already at the receiver." << endl;
         cout << "Throughput: " << throughput << " mbps." << endl;
+
+        printStats(client);
     }
     else { cout << "File transfer completed, but duration is too short to measure throughput." << endl; }
 
-    file.close();
     cout << "File " << fileName << " sent successfully." << endl;
+    return totalBytesSent;
 }
 
-int main()
+// 先发清单再以jobs个并发发送目录下的全部文件，服务端在download下重建目录树
+size_t sendDirectory(RUDP_C& client, const string& dirPath, size_t mss = BODY_SIZE, size_t jobs = DIR_SEND_JOBS)
 {
+    DirectorySender sender(client, mss, jobs);
+
+    auto start = high_resolution_clock::now();
+    if (!sender.send(dirPath))
+    {
+        cerr << "Failed to read directory: " << dirPath << endl;
+        return 0;
+    }
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+
+    // 只有接收方确认全部条目都已落盘才算成功
+    if (!sender.confirmed() || sender.files_failed())
+    {
+        if (sender.files_failed()) cerr << sender.files_failed() << " entries were not transferred intact." << endl;
+        if (!sender.confirmed()) cerr << "Receiver did not confirm the directory." << endl;
+        cerr << "Directory transfer failed after " << duration.count() << " milliseconds." << endl;
+        printStats(client);
+        return sender.bytes_sent();
+    }
+    cout << "Directory transfer completed in " << duration.count() << " milliseconds." << endl;
+    cout << "Total data sent: " << sender.bytes_sent() << " bytes in " << sender.files_sent() << " files." << endl;
+    if (duration.count() > 0)
+        cout << "Throughput: " << sender.bytes_sent() * 8.0 / duration.count() / 1000 << " mbps." << endl;
+    printStats(client);
+    return sender.bytes_sent();
+}
+
+/*
+ *  非交互模式，供make bench调用:
+ *  client <file|dir> [mss] [reno|fixed] [window] [sw|gbn|sr] [raw|lz] [socket|uring] [jobs] [full|delta]
+ *  mss为0时取BODY_SIZE，传目录时jobs为同时在途的文件数，传单个文件时delta请求增量传输
+ *  传完后断开连接，并输出一行 BENCH,<字节数>,<完成时间ms>,<发送报文数>,<重传报文数>
+ *  完成时间从首个报文发出到全部数据被确认为止
+ */
+int runBench(int argc, char* argv[])
+{
+    string file   = argv[1];
+    size_t mss    = argc > 2 && atoi(argv[2]) > 0 ? min<size_t>(atoi(argv[2]), BODY_SIZE) : BODY_SIZE;
+    string cc     = argc > 3 ? argv[3] : "reno";
+    size_t window = argc > 4 ? max(1, atoi(argv[4])) : 20;
+    string arq    = argc > 5 ? argv[5] : "gbn";
+    bool   lz     = argc > 6 && string(argv[6]) == "lz";
+    bool   uring  = argc > 7 && string(argv[7]) == "uring";
+    size_t jobs   = argc > 8 ? max(1, atoi(argv[8])) : DIR_SEND_JOBS;
+    bool   delta  = argc > 9 && string(argv[9]) == "delta";
+
+    RUDP_C client(7777, window);
+    client.set_congestion_control(cc == "fixed" ? CongestionControl::FIXED : CongestionControl::RENO);
+    client.set_arq(arq == "sw"   ? ArqMode::STOP_AND_WAIT
+                   : arq == "sr" ? ArqMode::SELECTIVE_REPEAT
+                                 : ArqMode::GO_BACK_N);
+    client.set_compression(lz);
+    if (uring && !client.set_io_backend(IoBackend::IO_URING))
+        cerr << "io_uring unavailable, fall back to socket I/O." << endl;
+    if (!client.connect("127.0.0.1", 5000))
+    {
+        cerr << "Failed to connect." << endl;
+        return 1;
+    }
+
+    auto   start = high_resolution_clock::now();
+    size_t bytes = filesystem::is_directory(file) ? sendDirectory(client, file, mss, jobs)
+                                                  : sendFile(client, file, mss, delta);
+    client.flush();
+    auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    client.disconnect();
+
+    RUDP_Stats stats = client.stats();
+    cout << "BENCH," << bytes << ',' << elapsed.count() << ',' << stats.packets_sent << ','
+         << stats.timeout_retransmits + stats.fast_retransmits << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) return runBench(argc, argv);
+
     map<int, string> file_map = {
         {1, "resources/1.jpg"},
         {2, "resources/2.jpg"},
         {3, "resources/3.jpg"},
         {4, "resources/helloworld.txt"},
         {5, "resources/small.txt"},
+        {6, "resources"},
     };
 
     RUDP_C client(7777);
@@ -76,17 +154,20 @@ int main()
     while (true)
     {
         cout << "\n\nChoose file to send(or 0 to exit): ";
-        cout << "\n1. 1.jpg\n2. 2.jpg\n3. 3.jpg\n4. helloworld.txt\n5. small.txt\n";
+        cout << "\n1. 1.jpg\n2. 2.jpg\n3. 3.jpg\n4. helloworld.txt\n5. small.txt\n6. resources/ (whole directory)\n";
 
         cin >> i;
         if (i == 0) break;
-        if (i < 0 || i > 5)
+        if (i < 0 || i > 6)
         {
             cout << "Invalid choice. Please try again." << endl;
             continue;
         }
 
-        sendFile(client, file_map[i]);
+        if (filesystem::is_directory(file_map[i]))
+            sendDirectory(client, file_map[i]);
+        else
+            sendFile(client, file_map[i], BODY_SIZE, true);
     }
 
     client.disconnect();
@@ -3,34 +3,62 @@
 
 #include <net/socket_defs.h>
 #include <net/rudp/rudp_defs.h>
+#include <net/rudp/rudp_buf.h>
+#include <net/rudp/rudp_env.h>
+#include <net/rudp/rudp_lz.h>
+#include <net/rudp/rudp_shm.h>
+#include <net/rudp/rudp_stats.h>
+#include <net/rudp/rudp_token.h>
+#include <net/rudp/rudp_trace.h>
+#include <net/rudp/rudp_uring.h>
 #include <common/lock.h>
 #include <chrono>
 #include <functional>
 #include <thread>
+#include <tuple>
 #include <atomic>
 #include <map>
 #include <condition_variable>
 #include <mutex>
 #include <deque>
+#include <vector>
 
 #define GUESS_RTT 50
 #define CHECK_GAP 10  // check timeout every 10ms
+
+#define DEFAULT_SOCK_BUF (1 << 20)  // 初始套接字收发缓冲区 1MB
+#define MAX_SOCK_BUF (64 << 20)     // 缓冲区自动调优上限 64MB
+#define MAX_CWND 4096               // 默认最大拥塞窗口(以报文段数计)
+#define COMPRESS_MIN_SIZE 64        // 更短的报文段不压缩
+#define COMPRESS_MAX_SKIP 64        // 压缩失败后最多连续旁路的报文段数
+#define BUSY_POLL_US 50             // 延迟模式下SO_BUSY_POLL的内核忙等时长(微秒)
+#define REPLY_QUEUE_DEPTH 64        // 客户端保留的未取走应答数，更早的丢弃
 extern std::chrono::milliseconds check_gap;
 
 void printRUDP(RUDP_P& p);
 
+class RUDP_Endpoint;
+
+enum class IoBackend
+{
+    SYSCALL,  // 普通套接字，每次收发一个系统调用
+    IO_URING  // 多发recvmsg与批量sendmsg，仅Linux
+};
+
 class RUDP
 {
   protected:
-    RUDP_STATUS _statu;
-    int         _port;
-    SOCKET      _sockfd;
-    sockaddr_in _local_addr;
-    sockaddr_in _remote_addr;
+    RUDP_Env*      _env;       // 时钟、线程与收发数据报的环境，默认为真实系统
+    RUDP_Endpoint* _endpoint;  // 非空时与其他连接共用端点的套接字，本身不创建套接字
+    RUDP_STATUS    _statu;
+    int            _port;
+    SOCKET         _sockfd;
+    sockaddr_in    _local_addr;
+    sockaddr_in    _remote_addr;
 
     uint32_t _connect_id;
-    uint32_t _seq_num;
-    uint32_t _ack_num;
+    uint64_t _seq_num;  // 64位扩展序号，报文中只携带低32位，见seqExtend
+    uint64_t _ack_num;
 
     std::chrono::milliseconds _rtt;
     std::chrono::milliseconds _dev_rtt;
@@ -39,47 +67,231 @@ class RUDP
     std::chrono::milliseconds _rto;
     ReWrLock                  _rto_lock;
 
+    size_t                _sock_buf;       // 当前套接字收发缓冲区大小(字节)
+    double                _delivery_rate;  // 最近测得的交付速率(字节/秒)
+    std::atomic<uint32_t> _kernel_drops;   // 内核接收队列溢出丢弃的数据报累计数(SO_RXQ_OVFL)
+    uint32_t              _reported_drops;
+
+    ShmRing           _shm_ring;  // 同主机共享内存通道
+    std::atomic<bool> _shm_mode;
+
+    RUDP_Counters     _counters;
+    std::atomic<bool> _stats_dumping;
+    std::thread       _stats_thread;
+
+    RUDP_Trace _trace;  // 拥塞控制事件时间线
+
+    UringIo _uring;  // 选用IO_URING后端时有效
+
+    bool _latency_mode;  // 自旋收包、立即确认、收包线程内直接处理
+    int  _latency_cpu;   // 收包线程绑定的CPU，<0表示不绑核
+
+    bool _ecn;  // 发出的数据报IP头带ECT(0)，发送方对ECE回显降窗
+
     std::atomic<bool> _receiving;
     std::thread       _receive_thread;
     std::atomic<bool> _wakeup;
     std::thread       _wakeup_thread;
 
   public:
-    RUDP(int port);
+    RUDP(int port, RUDP_Env* env = nullptr, RUDP_Endpoint* endpoint = nullptr);
     virtual ~RUDP() = 0;
 
     int getBoundPort() const;
 
+    // 当前连接是否走共享内存通道
+    bool localFastpath() const;
+
+    // 当前连接的统计快照
+    virtual RUDP_Stats stats() const;
+
+    // 按固定间隔把统计快照追加写入文件(JSON为每行一个对象)，供看板采集
+    void start_stats_dump(
+        const std::string& path, std::chrono::milliseconds interval, StatsFormat format = StatsFormat::JSON);
+    void stop_stats_dump();
+
+    // 开启/关闭二进制事件记录，开启时分配定长环，关闭后已记录的事件仍可导出
+    void enable_trace(bool enabled);
+    // 把环中保留的事件写入文件，用trace_conv离线转换
+    bool dump_trace(const std::string& path) const;
+
+    // 内核因接收缓冲区不足而丢弃的数据报数，与网络丢包分开统计
+    uint32_t kernelDrops() const;
+
+    // connect/listen前切换收发后端；内核不支持io_uring或处于模拟环境时保持SYSCALL并返回false
+    bool      set_io_backend(IoBackend backend);
+    IoBackend io_backend() const;
+
+    // connect/listen前开启延迟模式：收包线程绑定到cpu(<0不绑)并以非阻塞方式自旋收包，
+    // 服务端逐包立即确认且不经接收队列，等待窗口与确认时让出CPU而不睡眠。
+    // 面向小消息请求/响应，以CPU换尾延迟；SO_BUSY_POLL未生效或无法绑核时返回false，自旋照常启用
+    bool set_latency_mode(bool enabled, int cpu = -1);
+
+    // 开启/关闭ECN(默认开启)：发出的数据报标记ECT(0)，接收方把途中的CE标记经ACK回显，
+    // 发送方每个窗口至多因此降窗一次且不重传。平台无法设置或读取TOS时返回false
+    bool set_ecn(bool enabled);
+
   protected:
     virtual void clear_statu() = 0;
 
+    bool      _set_sock_buf(size_t bytes);
+    void      _autotune_sock_buf(std::chrono::milliseconds rtt, double delivery_rate);
+    void      _publish_rtt(std::chrono::milliseconds srtt, std::chrono::milliseconds rttvar);  // 连同_rto发布给统计线程
+    // ce非空时置为该数据报的IP头是否带CE标记
+    int       _recv_packet(RUDP_P& packet, sockaddr_in* from = nullptr, bool* ce = nullptr);
+    // 按数据报实际长度从PacketPool分配缓冲区收包；唤醒报文或长度与报头不符时返回空句柄
+    PacketBuf _recv_buffer(sockaddr_in* from = nullptr, bool* ce = nullptr);
+    // more为真时可暂缓提交，随后的_flush_sends()把一批报文一次交给内核
+    int       _send_to(const RUDP_P& packet, const sockaddr_in& to, bool more = false);
+    // 挂在端点上时句柄直接进入端点的发送队列，不拷贝报文
+    int       _send_to(const PacketBuf& packet, const sockaddr_in& to, bool more = false);
+    void      _flush_sends();
+    void      _send_to_self(const char* data, int len);  // 向本端口发数据报，唤醒阻塞在收包上的线程
+    uint32_t  _take_kernel_drops();
+    void      _pin_to_core();  // 延迟模式下把调用线程绑定到_latency_cpu
+    void      _idle_wait();    // 轮询条件的间隔：延迟模式下让出CPU，否则睡眠check_gap
+
+  private:
+    // 收一个数据报到place(len)返回的位置；sized为真时len为数据报实际长度，否则为sizeof(RUDP_P)
+    int  _recv_into(const std::function<void*(size_t&)>& place, bool sized, sockaddr_in* from, bool* ce);
+    void _count_sent(const RUDP_P& packet, int ret);
+
   protected:
     virtual void _wakeup_handler() = 0;
 };
 
+enum class CongestionControl
+{
+    RENO,  // 慢启动、拥塞避免与快恢复
+    FIXED  // 固定窗口，大小取构造时的w_s，用于对照测试
+};
+
+// 重传策略，在connect时随SYN告知对端
+enum class ArqMode
+{
+    STOP_AND_WAIT,    // 停等：窗口恒为1，对端逐包立即确认
+    GO_BACK_N,        // 回退N：累计确认，超时或三次重复ACK时从base起全部重传
+    SELECTIVE_REPEAT  // 选择重传：逐包确认、逐包计时，只重传丢失的报文
+};
+
+// 降窗前的窗口。本轮重传被对端逐个报告为重复到达(D-SACK)时，说明丢包判断是误判，据此撤销降窗
+struct RUDP_Undo
+{
+    double   cwnd     = 0;
+    double   ssthresh = 0;
+    uint64_t low      = 0;  // 本轮重传覆盖的序号范围[low, high)，high为0表示没有可撤销的降窗
+    uint64_t high     = 0;
+    uint32_t retrans  = 0;  // 尚未被证实多余的重传数
+};
+
+// 多路径条带化时每条路径独立维护的拥塞与RTT状态
+struct RUDP_Path
+{
+    sockaddr_in               addr;
+    double                    cwnd;
+    double                    ssthresh;
+    std::chrono::milliseconds srtt;
+    std::chrono::milliseconds rttvar;
+    uint32_t                  inflight;    // 在该路径上发出且尚未确认的报文数
+    uint64_t                  recover;     // 序号小于该值的丢包不再重复降窗
+    uint64_t                  rack_order;  // 该路径上最近被确认报文的发送顺序，RACK据此判断先发未至
+    RUDP_Undo                 undo;
+
+    RUDP_Path(const sockaddr_in& addr);
+};
+
+// 客户端缓存的会话，再次连接同一服务端时交给resume()
+struct RUDP_Session
+{
+    sockaddr_in               server{};
+    RUDP_TOKEN                token{};
+    bool                      has_token = false;  // 令牌只能兑现一次，用掉后等新的SYN_ACK补发
+    bool                      compress  = false;  // 对端上次接受了压缩
+    std::chrono::milliseconds srtt{0};
+    std::chrono::milliseconds rttvar{0};
+    double                    ssthresh = 0;
+    double                    cwnd     = 0;  // 上次连接结束时的窗口，恢复时只取一半
+};
+
 class RUDP_C : public RUDP
 {
   public:
-    using entry = std::pair<RUDP_P, std::chrono::time_point<std::chrono::steady_clock, std::chrono::milliseconds>>;
+    using time_point = std::chrono::time_point<std::chrono::steady_clock, std::chrono::milliseconds>;
+
+    struct entry
+    {
+        PacketBuf  packet;  // 按报文实际长度分配，重传与多路径发送共用
+        time_point send_time;
+        uint8_t    path          = 0;      // 最近一次发送所用路径
+        bool       sacked        = false;  // 已被逐包确认，等待累计确认推进
+        bool       retransmitted = false;
+        uint8_t    dup_sacks     = 0;  // 同路径上后发报文被确认的次数
+        uint64_t   tx_order      = 0;  // 全局发送顺序，用于同路径内判定乱序
+        time_point deadline{};         // 部分可靠：过期后放弃重传，默认值表示永不过期
+    };
 
   private:
     double            _cwnd;           // 拥塞窗口(以报文段数计)
     double            _ssthresh;       // 慢启动阈值
+    double            _max_cwnd;       // 拥塞窗口上限
     bool              _fast_recovery;  // 是否处于快恢复阶段
-    std::atomic<bool> _ca_running;
+    CongestionControl _cc;
+    ArqMode           _arq;
+    uint32_t          _fixed_window;
+    std::atomic<bool> _ca_running;  // 拥塞避免线程随连接建立与断开启停
+    std::atomic<bool> _ca_active;   // 处于拥塞避免阶段，由各阶段切换函数置位
     std::thread       _ca_thread;
 
-    uint32_t          _base;
+    uint64_t          _base;
+    uint32_t          _isn;  // 初始序号，默认为0
     std::atomic<bool> _resending;
+    bool              _shm_enabled;
+    bool              _compress_enabled;
+    bool              _compress;          // 对端接受了压缩
+    uint32_t          _compress_skip;     // 剩余需原样发送的报文段数
+    uint32_t          _compress_backoff;  // 下次压缩失败后的旁路段数，连续失败时加倍
     std::thread       _resend_thread;
 
-    std::map<uint32_t, entry> _send_buffer;
+    std::map<uint64_t, entry> _send_buffer;
     ReWrLock                  _send_buffer_lock;
 
+    std::vector<sockaddr_in> _extra_paths;  // connect前配置的附加路径
+    std::vector<RUDP_Path>   _paths;        // 选择重传模式下的全部路径，0号为握手路径
+    uint64_t                 _tx_counter;
+
+    RUDP_Session _session;   // resume()导入的会话，握手时更新令牌
+    bool         _zero_rtt;  // 本次连接以0-RTT建立，SYN_ACK在收包线程中处理
+
+    time_point        _last_ack_time;  // 最近一次收到ACK的时间，尾部探测从它与最后一次发送中较晚者起算
+    bool              _tlp_pending;    // 已发出尾部探测，等待新数据被确认
+    std::atomic<bool> _dup_ack_seen;   // 累计确认上次推进后收到过重复ACK，即有后发的报文已到达
+    RUDP_Undo         _undo;           // 单路径时的降窗撤销状态，选择重传时见各路径的undo
+    uint64_t          _ecn_recover;    // 单路径时序号小于该值的ECE回显不再重复降窗，选择重传时见各路径的recover
+
+    std::atomic<uint64_t> _peer_ack;   // 对端最近一次累计确认号
+    uint64_t              _skip_to;    // 最近一次前向跳过的目标序号
+    time_point            _skip_sent;  // 前向跳过报文的发送时间
+
+    // 服务端经APP报文发回的应答(类型, 负载)，由收包线程放入，recv_reply取出
+    std::deque<std::pair<uint16_t, std::vector<char>>> _replies;
+    std::mutex                                         _reply_mtx;
+    std::condition_variable                            _reply_cv;
+
+    // 累计确认的处理进度，由收包线程(或端点的收包线程)独占，开始收包时清零
+    struct AckState
+    {
+        uint64_t             last_ack_seq  = 0;
+        int                  dup_ack_count = 0;
+        size_t               cnt           = 0;  // 每5个新确认的报文取一次RTT样本
+        size_t               acked_bytes   = 0;  // 交付速率测量：每个RTT统计一次被确认的字节数
+        RUDP_Env::time_point rate_start{};
+    } _ack_state;
+
   private:
     void _start_congestion_avoidance_thread();
     void _stop_congestion_avoidance_thread();
     void _congestion_avoidance_handler();
+    void _ca_tick();  // 每个RTT一次，拥塞避免阶段增窗
 
     void _enter_slow_start();
     void _enter_congestion_avoidance();
@@ -88,52 +300,170 @@ class RUDP_C : public RUDP
     void _on_timeout();
 
     void _adjust_cwnd_on_ack(uint32_t acked_seq_diff);
+    void _trace_cwnd(uint8_t path = 0);  // 记录窗口变化，并把汇总后的窗口发布给统计线程
+
+    bool _multipath() const;
+    bool _selective() const;
+    int  _pick_path(bool ignore_window) const;
+    void _transmit(uint64_t seq, entry& ent, uint8_t path);
+    void _mp_on_ack(RUDP_P& ack);
+    void _mp_on_delivered(entry& ent);
+    void _mp_on_loss(uint64_t seq, entry& ent, bool timeout);
+
+    bool _rack_lost(const entry& ent, time_point now) const;
+    void _go_back_n(time_point now);
+    void _tail_probe(time_point now);
+
+    void _undo_begin(RUDP_Undo& undo, double cwnd, double ssthresh);
+    void _undo_track(RUDP_Undo& undo, uint64_t seq);
+    void _on_dsack(uint64_t seq);
+    void _on_ece(uint64_t seq, int path);
+
+    bool _compress_body(const char* buffer, size_t buffer_size, RUDP_P& packet);
+    bool _same_server(const sockaddr_in& addr) const;
+    void _store_token(RUDP_P& syn_ack);
+    void _apply_session();
+    void _on_syn_ack(RUDP_P& syn_ack);
+    // 负载由head与buffer两段依次拼成，head可为空
+    void _send(const char* head, size_t head_size, const char* buffer, size_t buffer_size,
+        std::chrono::milliseconds lifetime, uint16_t flags, uint16_t msg_type);
+
+    static bool _expired(const entry& ent, time_point now);
+    void        _skip_expired(std::chrono::milliseconds rto);
+    void        _send_forward_skip();
+
+    RUDP_C(int port, size_t w_s, RUDP_Env* env, RUDP_Endpoint* endpoint);
 
   public:
-    RUDP_C(int port, size_t w_s = 20);
+    RUDP_C(int port, size_t w_s = 20, RUDP_Env* env = nullptr);
+    // 挂在端点上，与同一端点的其他连接共用套接字与收发线程；端点须比连接活得久
+    RUDP_C(RUDP_Endpoint& endpoint, size_t w_s = 20);
     virtual ~RUDP_C() override;
 
   private:
     virtual void clear_statu() override;
     void         _resend_handler();
+    void         _resend_tick();  // 一次超时检查，由重传线程或端点的定时线程每check_gap调用
     void         _receive_handler();
+    void         _on_packet(RUDP_P& packet);  // 处理一个已建立连接上收到的报文
+    void         _start_receiving();
     virtual void _wakeup_handler() override;
 
+    friend class RUDP_Endpoint;
+
   public:
     bool connect(const char* remote_ip, int remote_port);
     bool disconnect();
-    void send(const char* buffer, size_t buffer_size);
+    // lifetime非零时为部分可靠消息：超过时限仍未确认则放弃，并通知接收方跳过。
+    // send与send_fragment每次调用发一个报文，负载超过BODY_SIZE时记错误日志并丢弃，不会截断
+    void send(const char* buffer, size_t buffer_size, std::chrono::milliseconds lifetime = std::chrono::milliseconds(0));
+    // 发送一条带类型的消息，超过BODY_SIZE时拆成多个分片，接收方按first/last识别边界
+    void send_message(uint16_t type, const char* buffer, size_t buffer_size,
+        std::chrono::milliseconds lifetime = std::chrono::milliseconds(0));
+    // 边读边发的大消息逐片发送，由调用方标记首尾分片，同一消息的各分片type应一致；每片不超过BODY_SIZE
+    void send_fragment(uint16_t type, const char* buffer, size_t buffer_size, bool first, bool last,
+        std::chrono::milliseconds lifetime = std::chrono::milliseconds(0));
+    // 分片负载由head与buffer两段拼成，应用层的分段头不必先和数据拼到一起，两段总长不超过BODY_SIZE
+    void send_fragment(uint16_t type, const char* head, size_t head_size, const char* buffer, size_t buffer_size,
+        bool first, bool last, std::chrono::milliseconds lifetime = std::chrono::milliseconds(0));
+    // 阻塞直到已发送的数据全部被确认(或因过期被放弃)
+    void flush();
+    // 取出服务端经RUDP_S::reply发回的一个应答；应答不可靠，timeout内没有收到时返回false，由调用方重发请求
+    bool recv_reply(uint16_t& type, std::vector<char>& data, std::chrono::milliseconds timeout);
+
+    // 握手时向同主机对端提议共享内存通道，对端不在本机时自动回退UDP
+    void set_local_fastpath(bool enabled);
+
+    // 握手时提议逐报文段LZ压缩，对端接受后生效；压缩率差的数据(如图片)自动旁路
+    void set_compression(bool enabled);
+
+    // 挂在端点上时设置本连接的发送权重(默认1)，端点发送队列积压时按权重分配带宽
+    void set_weight(double weight);
+
+    // connect前添加额外路径(如另一个router实例)，报文在各路径间条带化发送
+    void add_path(const char* remote_ip, int remote_port);
+
+    // 设置拥塞窗口上限，长肥管道下可调到数千个报文段
+    void set_max_window(uint32_t max_window);
+
+    // 导出会话：最新的恢复令牌与路径参数(sRTT、ssthresh、cwnd)，断开后仍可调用
+    RUDP_Session session() const;
+    // connect前导入同一服务端的会话，沿用其路径参数；持有令牌、重传策略不是选择重传且未启用
+    // 共享内存时以0-RTT连接：发出SYN即返回，数据紧随其后。服务端拒绝令牌时在收包线程里补全握手，
+    // 早发的数据经超时重传送达
+    void resume(const RUDP_Session& session);
+
+    // 选择拥塞控制算法，FIXED时窗口恒为w_s
+    void set_congestion_control(CongestionControl cc);
 
-    // 当前可用窗口大小（以整数方式返回）
-    inline uint32_t current_window() { return static_cast<uint32_t>(_cwnd); }
+    // connect前选择重传策略，默认GO_BACK_N；配置了多路径时总是选择重传
+    void set_arq(ArqMode arq);
+
+    // connect前设置初始序号，默认为0；取接近2^32的值可在短传输中验证序号回绕
+    void set_initial_seq(uint32_t isn);
+
+    // 当前可用窗口大小（以整数方式返回），多路径时为各路径窗口之和
+    uint32_t current_window() const;
 };
 
 class RUDP_S : public RUDP
 {
   public:
-    using callback = std::function<void(RUDP_P&)>;
+    using callback         = std::function<void(RUDP_P&)>;
+    using message_callback = std::function<void(const RUDP_Message&)>;
+    using buffer_callback  = std::function<void(const PacketBuf&)>;
+    using early_callback   = std::function<bool(const PacketBuf&)>;
 
   private:
-    std::deque<RUDP_P> _recv_queue;
-    ReWrLock           _recv_queue_lock;
+    std::deque<std::tuple<PacketBuf, sockaddr_in, bool>> _recv_queue;  // 报文、来源路径及IP头是否带CE标记
+    ReWrLock                                             _recv_queue_lock;
+    // 由SYN决定；选择重传时逐包确认并沿来路返回
+    ArqMode _arq;
+
+    TokenIssuer _tokens;   // 每个SYN_ACK附带新令牌，供客户端下次0-RTT连接
+    PacketBuf   _syn_ack;  // SYN_RCVD阶段收到非ACK报文时重发
+
+    early_callback _early;  // 乱序报文的提前交付，见set_early_delivery
+
+    std::chrono::steady_clock::time_point _syn_ack_time;  // 用于握手阶段估计RTT
+    std::chrono::milliseconds             _ack_delay;     // 延迟ACK时长
+    std::thread                           _shm_thread;     // 共享内存的消费者
+    uint64_t                              _shm_delivered;  // 消费者交付的报文数，只由消费者修改，join后计入_ack_num
 
   public:
-    RUDP_S(int port);
+    RUDP_S(int port, RUDP_Env* env = nullptr);
     virtual ~RUDP_S() override;
 
   private:
     virtual void clear_statu() override;
-    void         _receive_handler(callback cb);
+    void         _receive_handler(buffer_callback cb);
     virtual void _wakeup_handler() override;
+    void         _stop_shm();  // 关闭共享内存队列，等消费者交付完剩余报文后退出
 
   private:
     void _listen();
     void _syn_rcvd();
-    void _established(callback cb);
+    void _established(const buffer_callback& cb, const callback& shm_cb);
     void _fin_rcvd();
+    void _serve(const buffer_callback& cb, const callback& shm_cb);  // shm_cb直接交付共享内存槽位中的报文
 
   public:
     void listen(callback cb = printRUDP);
+    // 以消息视图交付，应用按type与首尾标记分派，不必拷贝或扫描负载
+    void listen(message_callback cb);
+    // 交付收包时分配的缓冲区句柄，负载从收包到回调不经拷贝；回调可保留句柄，在别处继续使用负载
+    void listen(buffer_callback cb);
+
+    // 设置延迟ACK时长，0表示每个报文都立即确认
+    void set_ack_delay(std::chrono::milliseconds delay);
+
+    // listen前设置：乱序到达的报文先交给cb，返回true表示应用已自行处理(如按偏移直接写盘)，
+    // 重排缓冲区只记下序号而不持有负载，按序推进到该报文时不再交付；返回false的报文照常缓存、按序交付。
+    // cb与listen的回调在同一线程调用
+    void set_early_delivery(early_callback cb);
+
+    // 在listen的回调中向客户端发回一个应答(APP报文)，不占序号、不确认也不重传，丢失时由客户端重发请求
+    void reply(uint16_t type, const char* buffer, size_t buffer_size);
 };
 
 #endif
@@ -0,0 +1,87 @@
+#ifndef __NET_RUDP_RUDP_BUF_H__
+#define __NET_RUDP_RUDP_BUF_H__
+
+#include <net/rudp/rudp_defs.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#define PKT_MIN_CLASS 64           // 最小尺寸级(字节，含报头)，逐级翻倍，最大一级为整个RUDP_P
+#define PKT_CLASSES 10             // 64B到16KB共9级，加上整包一级
+#define PKT_SLAB_SIZE (256 << 10)  // 每次向系统申请的slab大小，切分为同一尺寸级的缓冲区
+
+/**
+ * @brief 引用计数的报文缓冲区句柄
+ *
+ * 缓冲区由PacketPool按数据报长度分配，起始处按RUDP_P布局，但只有前capacity()字节可用，
+ * 即body最多容纳capacity() - sizeof(RUDP_H)字节。拷贝句柄只增加引用计数，收包队列、
+ * 乱序缓存与交付回调之间传递的都是句柄；最后一个句柄析构时缓冲区回到池中。
+ * 引用计数是原子的，句柄可以跨线程传递，缓冲区内容的并发修改由使用者自行避免。
+ */
+class PacketBuf
+{
+  public:
+    PacketBuf() = default;
+    PacketBuf(const PacketBuf& other);
+    PacketBuf(PacketBuf&& other) noexcept;
+    PacketBuf& operator=(const PacketBuf& other);
+    PacketBuf& operator=(PacketBuf&& other) noexcept;
+    ~PacketBuf();
+
+    // 从全局池分配至少bytes字节(含报头，超过sizeof(RUDP_P)时按整包分配)，报头按RUDP_H()初始化
+    static PacketBuf alloc(size_t bytes);
+
+    RUDP_P* get() const;
+    RUDP_P& operator*() const { return *get(); }
+    RUDP_P* operator->() const { return get(); }
+    explicit operator bool() const { return _block != nullptr; }
+
+    size_t capacity() const;  // 可用字节数(含报头)
+
+  private:
+    struct Block;
+    Block* _block = nullptr;
+
+    explicit PacketBuf(Block* block) : _block(block) {}
+    void _release();
+
+    friend class PacketPool;
+};
+
+/**
+ * @brief 按尺寸级划分的报文缓冲区slab分配器
+ *
+ * 每个尺寸级维护一条空闲链表，链表为空时向系统申请一个slab切分补充。归还的缓冲区只回到
+ * 空闲链表，不还给系统，因此常驻内存取决于同时在用的缓冲区峰值，而不是累计收发量。
+ */
+class PacketPool
+{
+  private:
+    mutable std::mutex      _mtx;
+    PacketBuf::Block*       _free[PKT_CLASSES];
+    std::vector<char*>      _slabs;
+    size_t                  _reserved;  // 已向系统申请的字节数
+    size_t                  _in_use;    // 尚未归还的缓冲区数
+
+    PacketPool();
+
+    static size_t _class_capacity(size_t cls);
+    void          _grow(size_t cls);
+    void          _recycle(PacketBuf::Block* block);
+
+    friend class PacketBuf;
+
+  public:
+    PacketPool(const PacketPool&)            = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    static PacketPool& instance();
+
+    PacketBuf alloc(size_t bytes);
+
+    size_t reserved() const;
+    size_t in_use() const;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define __NET_RUDP_RUDP_DEFS_H__
 
 #include <stdint.h>
+#include <span>
 #include <string>
 
 #define PACKET_SIZE 32767
@@ -31,7 +32,8 @@ struct RUDP_H
     uint32_t connect_id;
     uint32_t seq_num;
     uint32_t ack_num;
-    uint32_t data_len;
+    uint16_t data_len;  // 不超过BODY_SIZE，16位足够
+    uint16_t msg_type;  // 应用自定义的消息类型，随消息的每个分片携带
     uint16_t flags, checksum;
 
     /*
@@ -40,6 +42,18 @@ struct RUDP_H
      *  flags[1]: ACK   0b0000_0000_0000_0010   0x0002
      *  flags[2]: FIN   0b0000_0000_0000_0100   0x0004
      *  flags[3]: RST   0b0000_0000_0000_1000   0x0008
+     *  flags[4]: SHM   0b0000_0000_0001_0000   0x0010  同主机共享内存通道协商
+     *  flags[5]: MP    0b0000_0000_0010_0000   0x0020  多路径，要求逐包确认(ACK体携带被确认序号)
+     *  flags[6]: FSK   0b0000_0000_0100_0000   0x0040  前向跳过，接收方将ack_num推进到报文的ack_num
+     *  flags[7]: SW    0b0000_0000_1000_0000   0x0080  停等协议，要求每个报文立即确认
+     *  flags[8]: SR    0b0000_0001_0000_0000   0x0100  选择重传，要求逐包确认(同MP，但只有一条路径)
+     *  flags[9]: CMP   0b0000_0010_0000_0000   0x0200  握手时协商压缩；数据报文上表示负载经LZ压缩
+     *  flags[10]: MSB  0b0000_0100_0000_0000   0x0400  消息的第一个分片
+     *  flags[11]: MSE  0b0000_1000_0000_0000   0x0800  消息的最后一个分片，单报文消息两者同时置位
+     *  flags[12]: RES  0b0001_0000_0000_0000   0x1000  会话恢复：SYN携带令牌请求0-RTT，SYN_ACK上表示已接受
+     *  flags[13]: DUP  0b0010_0000_0000_0000   0x2000  ACK由重复到达的报文触发(D-SACK)，ACK体回显其序号
+     *  flags[14]: ECE  0b0100_0000_0000_0000   0x4000  ACK回显：自上一个ACK以来收到过IP头带CE标记的报文
+     *  flags[15]: APP  0b1000_0000_0000_0000   0x8000  服务端发给客户端的应用应答，不占序号、不确认也不重传
      */
 
     RUDP_H();
@@ -53,41 +67,117 @@ struct RUDP_P
 
 #pragma pack()
 
+// 交付给应用的消息分片视图，data直接指向报文体，只在回调期间有效；
+// 不经消息接口发送的报文first与last都为假
+struct RUDP_Message
+{
+    uint16_t              type;
+    std::span<const char> data;
+    bool                  first;
+    bool                  last;
+};
+
 uint16_t lenInByte(const RUDP_P& packet);
 
 uint16_t genCheckSum(RUDP_P& packet);
 bool     checkCheckSum(RUDP_P& packet);
 
-#define SET_SYN(rudp) (rudp.header.flags |= 0x0001)
-#define SET_ACK(rudp) (rudp.header.flags |= 0x0002)
-#define SET_FIN(rudp) (rudp.header.flags |= 0x0004)
-#define SET_RST(rudp) (rudp.header.flags |= 0x0008)
-
-#define CHK_SYN(rudp) (rudp.header.flags & 0x0001)
-#define CHK_ACK(rudp) (rudp.header.flags & 0x0002)
-#define CHK_FIN(rudp) (rudp.header.flags & 0x0004)
-#define CHK_RST(rudp) (rudp.header.flags & 0x0008)
-
-#define CLR_FLAGS(rudp) (rudp.header.flags = 0x0000)
-#define CLR_PACKET(rudp)          \
-    {                             \
-        CLR_FLAGS(rudp);          \
-        rudp.header.seq_num  = 0; \
-        rudp.header.ack_num  = 0; \
-        rudp.header.data_len = 0; \
-    }
+/*
+ *  序号扩展：两端内部以64位计数，报文只携带低32位。收到的序号按序列号算术(RFC 1982)
+ *  还原为离ref最近的64位值，ref取本端已知的序号(发送方的base、接收方的ack_num)，
+ *  只要两者相差不到2^31，回绕后比较与容器排序仍然正确。
+ *  64位计数从SEQ_EPOCH起步，ref之前的旧序号还原后不会下溢。
+ */
+#define SEQ_EPOCH (1ull << 32)
 
-#define SET_SYN_H(rudp) (rudp.flags |= 0x0001)
-#define SET_ACK_H(rudp) (rudp.flags |= 0x0002)
-#define SET_FIN_H(rudp) (rudp.flags |= 0x0004)
-#define SET_RST_H(rudp) (rudp.flags |= 0x0008)
-
-#define CHK_SYN_H(rudp) (rudp.flags & 0x0001)
-#define CHK_ACK_H(rudp) (rudp.flags & 0x0002)
-#define CHK_FIN_H(rudp) (rudp.flags & 0x0004)
-#define CHK_RST_H(rudp) (rudp.flags & 0x0008)
+inline uint64_t seqExtend(uint32_t seq, uint64_t ref)
+{
+    return ref + static_cast<int32_t>(seq - static_cast<uint32_t>(ref));
+}
+
+// IP头TOS字段低两位的ECN码点(RFC 3168)
+#define ECN_MASK 0x03
+#define ECN_ECT0 0x02
+#define ECN_CE 0x03
+
+#define SET_SYN(rudp) ((rudp).header.flags |= 0x0001)
+#define SET_ACK(rudp) ((rudp).header.flags |= 0x0002)
+#define SET_FIN(rudp) ((rudp).header.flags |= 0x0004)
+#define SET_RST(rudp) ((rudp).header.flags |= 0x0008)
+#define SET_SHM(rudp) ((rudp).header.flags |= 0x0010)
+#define SET_MP(rudp) ((rudp).header.flags |= 0x0020)
+#define SET_FSK(rudp) ((rudp).header.flags |= 0x0040)
+#define SET_SW(rudp) ((rudp).header.flags |= 0x0080)
+#define SET_SR(rudp) ((rudp).header.flags |= 0x0100)
+#define SET_CMP(rudp) ((rudp).header.flags |= 0x0200)
+#define SET_MSB(rudp) ((rudp).header.flags |= 0x0400)
+#define SET_MSE(rudp) ((rudp).header.flags |= 0x0800)
+#define SET_RES(rudp) ((rudp).header.flags |= 0x1000)
+#define SET_DUP(rudp) ((rudp).header.flags |= 0x2000)
+#define SET_ECE(rudp) ((rudp).header.flags |= 0x4000)
+#define SET_APP(rudp) ((rudp).header.flags |= 0x8000)
+
+#define CHK_SYN(rudp) ((rudp).header.flags & 0x0001)
+#define CHK_ACK(rudp) ((rudp).header.flags & 0x0002)
+#define CHK_FIN(rudp) ((rudp).header.flags & 0x0004)
+#define CHK_RST(rudp) ((rudp).header.flags & 0x0008)
+#define CHK_SHM(rudp) ((rudp).header.flags & 0x0010)
+#define CHK_MP(rudp) ((rudp).header.flags & 0x0020)
+#define CHK_FSK(rudp) ((rudp).header.flags & 0x0040)
+#define CHK_SW(rudp) ((rudp).header.flags & 0x0080)
+#define CHK_SR(rudp) ((rudp).header.flags & 0x0100)
+#define CHK_CMP(rudp) ((rudp).header.flags & 0x0200)
+#define CHK_MSB(rudp) ((rudp).header.flags & 0x0400)
+#define CHK_MSE(rudp) ((rudp).header.flags & 0x0800)
+#define CHK_RES(rudp) ((rudp).header.flags & 0x1000)
+#define CHK_DUP(rudp) ((rudp).header.flags & 0x2000)
+#define CHK_ECE(rudp) ((rudp).header.flags & 0x4000)
+#define CHK_APP(rudp) ((rudp).header.flags & 0x8000)
+
+#define CLR_FLAGS(rudp) ((rudp).header.flags = 0x0000)
+#define CLR_PACKET(rudp)            \
+    {                               \
+        CLR_FLAGS(rudp);            \
+        (rudp).header.seq_num  = 0; \
+        (rudp).header.ack_num  = 0; \
+        (rudp).header.data_len = 0; \
+    }
 
-#define CLR_FLAGS_H(rudp) (rudp.flags = 0x0000)
+#define SET_SYN_H(rudp) ((rudp).flags |= 0x0001)
+#define SET_ACK_H(rudp) ((rudp).flags |= 0x0002)
+#define SET_FIN_H(rudp) ((rudp).flags |= 0x0004)
+#define SET_RST_H(rudp) ((rudp).flags |= 0x0008)
+#define SET_SHM_H(rudp) ((rudp).flags |= 0x0010)
+#define SET_MP_H(rudp) ((rudp).flags |= 0x0020)
+#define SET_FSK_H(rudp) ((rudp).flags |= 0x0040)
+#define SET_SW_H(rudp) ((rudp).flags |= 0x0080)
+#define SET_SR_H(rudp) ((rudp).flags |= 0x0100)
+#define SET_CMP_H(rudp) ((rudp).flags |= 0x0200)
+#define SET_MSB_H(rudp) ((rudp).flags |= 0x0400)
+#define SET_MSE_H(rudp) ((rudp).flags |= 0x0800)
+#define SET_RES_H(rudp) ((rudp).flags |= 0x1000)
+#define SET_DUP_H(rudp) ((rudp).flags |= 0x2000)
+#define SET_ECE_H(rudp) ((rudp).flags |= 0x4000)
+#define SET_APP_H(rudp) ((rudp).flags |= 0x8000)
+
+#define CHK_SYN_H(rudp) ((rudp).flags & 0x0001)
+#define CHK_ACK_H(rudp) ((rudp).flags & 0x0002)
+#define CHK_FIN_H(rudp) ((rudp).flags & 0x0004)
+#define CHK_RST_H(rudp) ((rudp).flags & 0x0008)
+#define CHK_SHM_H(rudp) ((rudp).flags & 0x0010)
+#define CHK_MP_H(rudp) ((rudp).flags & 0x0020)
+#define CHK_FSK_H(rudp) ((rudp).flags & 0x0040)
+#define CHK_SW_H(rudp) ((rudp).flags & 0x0080)
+#define CHK_SR_H(rudp) ((rudp).flags & 0x0100)
+#define CHK_CMP_H(rudp) ((rudp).flags & 0x0200)
+#define CHK_MSB_H(rudp) ((rudp).flags & 0x0400)
+#define CHK_MSE_H(rudp) ((rudp).flags & 0x0800)
+#define CHK_RES_H(rudp) ((rudp).flags & 0x1000)
+#define CHK_DUP_H(rudp) ((rudp).flags & 0x2000)
+#define CHK_ECE_H(rudp) ((rudp).flags & 0x4000)
+#define CHK_APP_H(rudp) ((rudp).flags & 0x8000)
+
+#define CLR_FLAGS_H(rudp) ((rudp).flags = 0x0000)
 
 std::string   statuStr(RUDP_STATUS statu);
 std::string   flagsToStr(const RUDP_P& p);
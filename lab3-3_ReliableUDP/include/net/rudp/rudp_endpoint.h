@@ -0,0 +1,114 @@
+#ifndef __NET_RUDP_RUDP_ENDPOINT_H__
+#define __NET_RUDP_RUDP_ENDPOINT_H__
+
+#include <net/socket_defs.h>
+#include <net/rudp/rudp_buf.h>
+#include <net/rudp/rudp_env.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+class RUDP;
+class RUDP_C;
+
+/**
+ * @brief 客户端连接管理器：多条出向RUDP连接共用一个套接字
+ *
+ * 端点持有唯一的套接字与三个线程：收包线程按connect_id把报文分派给对应连接，
+ * 定时线程替各连接做超时检查与拥塞避免增窗，发送线程按加权公平排队(自计时WFQ)
+ * 依次发出各连接提交的报文。连接数增加时线程数与套接字数不变。
+ *
+ * 每个报文入队时打上完成标签 max(V, 该连接上一报文的标签) + 长度/权重，发送线程
+ * 总取标签最小者并把V推进到该标签，积压时各连接按权重分得带宽，小消息不必排在
+ * 大块数据之后。不限速时报文几乎随到随发，排队发生在下游瓶颈处；set_rate()把发送
+ * 速率限制在瓶颈带宽以下，积压留在本端，调度才起作用。
+ */
+class RUDP_Endpoint
+{
+  public:
+    RUDP_Endpoint(int port, RUDP_Env* env = nullptr);
+    ~RUDP_Endpoint();
+
+    RUDP_Endpoint(const RUDP_Endpoint&)            = delete;
+    RUDP_Endpoint& operator=(const RUDP_Endpoint&) = delete;
+
+    int       port() const;
+    RUDP_Env* env() const;
+
+    // 限制发送速率(字节/秒)，0表示不限速
+    void set_rate(double bytes_per_sec);
+
+    // 已挂载的连接数
+    size_t connections() const;
+
+  private:
+    class Socket;
+
+    // 每条连接在端点上的状态
+    struct Flow
+    {
+        RUDP_C*                                              conn        = nullptr;
+        double                                               weight      = 1.0;
+        double                                               last_finish = 0;  // 最近入队报文的完成标签
+        // 连接未在收包(握手、挥手)时到达的报文，空句柄为唤醒标记
+        std::deque<std::tuple<PacketBuf, sockaddr_in, bool>> inbox;
+        std::condition_variable                              cv;
+        RUDP_Env::time_point                                 ca_due{};  // 下次拥塞避免增窗的时刻
+    };
+
+    struct Pending
+    {
+        PacketBuf   packet;
+        sockaddr_in to;
+    };
+
+    RUDP_Env*               _env;
+    int                     _port;
+    std::unique_ptr<Socket> _socket;
+
+    // 收包与定时线程调用连接的回调时持有，连接停用回调后经_quiesce()确认回调已退出
+    std::mutex _loop_mtx;
+    // 保护发送队列、各连接的收件箱与标签，总在_loop_mtx之后获取
+    mutable std::mutex _mtx;
+
+    std::map<const RUDP*, Flow>    _flows;
+    std::map<uint32_t, RUDP_C*>    _routes;  // connect_id到连接
+    std::multimap<double, Pending> _queue;   // 按完成标签排序，标签相同时先入先出
+    double                         _virtual_time;
+    std::condition_variable        _tx_cv;
+    double                         _rate;
+    RUDP_Env::time_point           _next_tx;  // 限速时下一个报文的最早发送时刻
+
+    std::atomic<bool> _running;
+    std::thread       _rx_thread;
+    std::thread       _timer_thread;
+    std::thread       _tx_thread;
+
+    void _rx_loop();
+    void _timer_loop();
+    void _tx_loop();
+
+    void _attach(RUDP_C* conn);
+    void _detach(RUDP_C* conn);
+    bool _route(RUDP_C* conn, uint32_t connect_id);  // connect_id已被占用时返回false
+    void _unroute(RUDP_C* conn);
+    void _set_weight(RUDP_C* conn, double weight);
+
+    void _submit(const RUDP* conn, const PacketBuf& packet, const sockaddr_in& to);
+    // 阻塞取出本连接收件箱中的下一个报文，唤醒标记返回0且报头清零
+    int  _take(const RUDP* conn, const std::function<void*(size_t&)>& place, bool sized, sockaddr_in* from,
+        bool* ce);
+    void _wake(const RUDP* conn);
+    void _quiesce();  // 不能在端点自己的线程中调用
+
+    friend class RUDP;
+    friend class RUDP_C;
+};
+
+#endif
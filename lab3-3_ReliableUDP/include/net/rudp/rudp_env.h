@@ -0,0 +1,51 @@
+#ifndef __NET_RUDP_RUDP_ENV_H__
+#define __NET_RUDP_RUDP_ENV_H__
+
+#include <net/socket_defs.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief RUDP的运行环境：时钟、线程、条件变量等待与数据报收发
+ *
+ * RUDP内部所有计时、睡眠、线程启停都经由该接口。默认环境(system())直接使用
+ * steady_clock、std::thread与真实UDP套接字；SimNetwork(rudp_sim.h)以虚拟时钟和
+ * 离散事件链路替换它们。
+ */
+class RUDP_Env
+{
+  public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    virtual ~RUDP_Env() = default;
+
+    // 为真时RUDP不创建套接字，数据报经由下面的bind/send_to/recv_from收发
+    virtual bool simulated() const = 0;
+
+    virtual time_point now()                          = 0;
+    virtual void       sleep_for(clock::duration dur) = 0;
+
+    virtual std::thread spawn(std::function<void()> fn) = 0;
+    virtual void        join(std::thread& t)            = 0;
+
+    // 释放lk等待cv被通知或到达deadline(time_point::max()表示不设超时)，返回时重新持有lk；
+    // 与std::condition_variable一样可能虚假唤醒，调用方需自行检查条件
+    virtual void wait_until(std::unique_lock<std::mutex>& lk, std::condition_variable& cv, time_point deadline) = 0;
+    virtual void notify_all(std::condition_variable& cv)                                                      = 0;
+
+    // tos为数据报IP头的TOS字节，链路只关心其中的ECN码点：发送时ECT表示可被标记，收到时CE表示途中拥塞
+    virtual void bind(int port) {}
+    virtual void unbind(int port) {}
+    virtual int  send_to(int port, const void* data, size_t len, const sockaddr_in& to, uint8_t tos = 0) { return -1; }
+    virtual int  recv_from(int port, void* buf, size_t len, sockaddr_in* from, uint8_t* tos = nullptr) { return -1; }
+    // 阻塞到port上有数据报可取，返回其长度但不取出，用于按实际长度分配接收缓冲区
+    virtual int  peek_size(int port) { return -1; }
+
+    static RUDP_Env& system();
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __NET_RUDP_RUDP_LZ_H__
+#define __NET_RUDP_RUDP_LZ_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12  // 哈希表4096项，单个报文段(<32KB)内足够
+
+/*
+ *  LZ4风格的块压缩，用于单个报文段的负载：
+ *  序列 = token(高4位字面量长度，低4位匹配长度-4) [字面量长度扩展] 字面量 offset(2字节小端) [匹配长度扩展]
+ *  长度字段为15时后跟若干字节累加，遇到非255的字节结束；最后一个序列只有字面量
+ *  压缩与解压都不分配内存
+ */
+
+// 压缩src到dst，输出超过cap时放弃并返回0，否则返回压缩后长度
+size_t lzCompress(const char* src, size_t len, char* dst, size_t cap);
+
+// 解压src到dst，数据损坏或输出超过cap时返回-1，否则返回解压后长度
+long lzDecompress(const char* src, size_t len, char* dst, size_t cap);
+
+// 只扫描序列得到解压后长度，不写输出，用于按实际长度分配解压缓冲区；数据损坏时返回-1
+long lzDecompressedLen(const char* src, size_t len);
+
+#endif
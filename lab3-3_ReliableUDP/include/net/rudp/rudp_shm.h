@@ -0,0 +1,86 @@
+#ifndef __NET_RUDP_RUDP_SHM_H__
+#define __NET_RUDP_RUDP_SHM_H__
+
+#include <net/rudp/rudp_defs.h>
+#include <atomic>
+#include <functional>
+#include <string>
+
+#define SHM_RING_SLOTS 128         // 环形队列槽位数，每槽一个完整RUDP_P
+#define SHM_MAGIC 0x52534D31       // "RSM1"
+#define SHM_WAIT_US 10000          // futex等待超时，防止唤醒丢失或对端异常退出
+
+#pragma pack(1)
+
+/*
+ *  SYN携带的共享内存提议：
+ *  对端用boot_id判断是否同一主机，再通过/proc/<pid>/fd/<fd>打开memfd，
+ *  映射后核对token，确认映射到的确实是发起方的环形队列
+ */
+struct RUDP_SHM_OFFER
+{
+    uint32_t magic;
+    char     boot_id[40];
+    int32_t  pid;
+    int32_t  fd;
+    uint64_t token;
+};
+
+#pragma pack()
+
+/**
+ * @brief 同主机共享内存环形队列
+ *
+ * memfd + futex实现的单生产者单消费者队列，发送方直接在槽位中构造报文，
+ * 接收方在槽位上原地回调，不经过内核拷贝与校验和计算。
+ */
+class ShmRing
+{
+  private:
+    struct Control
+    {
+        uint32_t              magic;
+        uint64_t              token;
+        std::atomic<uint32_t> head;              // 生产者下一个写入位置
+        std::atomic<uint32_t> tail;              // 消费者下一个读取位置
+        std::atomic<uint32_t> consumer_waiting;  // 消费者是否在head上等待
+        std::atomic<uint32_t> producer_waiting;  // 生产者是否在tail上等待
+        std::atomic<uint32_t> closed;
+    };
+
+    int      _fd;
+    void*    _base;
+    size_t   _size;
+    Control* _ctl;
+    RUDP_P*  _slots;
+
+    bool _map(int fd);
+
+  public:
+    ShmRing();
+    ~ShmRing();
+    ShmRing(const ShmRing&)            = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    // 发起方创建队列；非Linux平台恒返回false
+    bool create();
+    // 接收方依据提议映射队列，不在同一主机或校验失败时返回false
+    bool attach(const RUDP_SHM_OFFER& offer);
+    void fillOffer(RUDP_SHM_OFFER& offer) const;
+    void release();
+    bool valid() const;
+
+    // 生产者：取得下一个空槽(队列满时阻塞)，填好后publish
+    RUDP_P& acquire();
+    void    publish();
+
+    // 消费者：阻塞直到有报文并对其回调，队列关闭且为空时返回false
+    bool consume(const std::function<void(RUDP_P&)>& fn);
+
+    void close();
+    bool drained() const;
+
+    static std::string bootId();
+};
+
+#endif
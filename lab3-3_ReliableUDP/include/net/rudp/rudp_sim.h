@@ -0,0 +1,135 @@
+#ifndef __NET_RUDP_RUDP_SIM_H__
+#define __NET_RUDP_RUDP_SIM_H__
+
+#include <net/rudp/rudp_env.h>
+#include <net/rudp/rudp_defs.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+// 单向链路模型
+struct SimLink
+{
+    std::chrono::microseconds delay{5000};  // 传播时延
+    double                    loss      = 0;  // 随机丢包概率[0, 1]
+    uint64_t                  bandwidth = 0;  // 瓶颈带宽(比特/秒)，0表示不限速
+    size_t                    queue     = 0;  // 瓶颈队列容量(字节)，超出时尾部丢弃，0表示不限
+    size_t                    ecn       = 0;  // 队列超过该字节数时给ECT报文打CE标记，0表示不标记
+};
+
+struct SimStats
+{
+    uint64_t delivered;  // 送达的数据报数
+    uint64_t lost;       // 随机丢弃
+    uint64_t overflow;   // 瓶颈队列溢出丢弃
+    uint64_t ce_marked;  // 因队列超过ECN阈值被打上CE标记
+    size_t   max_queue;  // 瓶颈队列的峰值(字节)
+    uint64_t events;     // 处理过的离散事件数
+};
+
+/**
+ * @brief 确定性的进程内网络模拟器
+ *
+ * 作为RUDP_Env传给RUDP_C/RUDP_S后，二者的线程仍是真实线程，但任一时刻只有一个在运行：
+ * 线程只在睡眠、等待条件变量、收包或join时交出执行权，全部线程阻塞时虚拟时钟直接跳到
+ * 下一个事件(定时器到期或数据报到达)。调度顺序只由事件时间与发生次序决定，链路丢包
+ * 使用给定种子的随机数，因此同一场景的结果逐位可复现，耗时也与虚拟时长无关。
+ *
+ * 约束：线程在持有普通锁时不得调用上述阻塞原语，否则其他线程会在锁上真实阻塞而无法调度。
+ * 端口即地址，IP被忽略；发往自身端口的数据报不经过链路立即到达。
+ */
+class SimNetwork : public RUDP_Env
+{
+  private:
+    struct Datagram
+    {
+        int               from_port;
+        uint8_t           tos;
+        std::vector<char> data;
+    };
+
+    struct Task
+    {
+        std::condition_variable  cv;
+        uint64_t                 gen     = 0;  // 每次被唤醒后递增，使过期的定时器失效
+        bool                     done    = false;
+        std::condition_variable* cv_wait = nullptr;
+        std::vector<int>         joiners;
+    };
+
+    struct Event
+    {
+        int      task;  // >=0为定时唤醒，否则为数据报到达
+        uint64_t gen;
+        int      port;
+        Datagram dgram;
+    };
+
+    struct Endpoint
+    {
+        std::deque<Datagram> queue;
+        int                  waiter = -1;
+    };
+
+    std::mutex                                       _mtx;
+    time_point                                       _now;
+    int                                              _running;
+    std::vector<std::unique_ptr<Task>>               _tasks;
+    std::deque<int>                                  _ready;
+    std::map<std::pair<time_point, uint64_t>, Event> _events;  // 按(时间, 发生次序)排序
+    uint64_t                                         _event_seq;
+    std::multimap<std::condition_variable*, int>     _cv_waiters;
+    std::map<std::thread::id, int>                   _thread_tasks;
+    std::map<int, Endpoint>                          _endpoints;
+
+    SimLink                                   _default_link;
+    std::map<std::pair<int, int>, SimLink>    _link_overrides;
+    std::map<std::pair<int, int>, time_point> _link_busy;  // 各方向链路发完已排队数据的时刻
+    std::mt19937_64                           _rng;
+    SimStats                                  _stats;
+
+  private:
+    int  _self() const;
+    void _block(std::unique_lock<std::mutex>& lk);
+    int  _next();
+    void _wake(int task);
+    void _schedule(time_point at, Event&& ev);
+    void _deliver(int port, Datagram&& dgram);
+    bool _wait_datagram(std::unique_lock<std::mutex>& lk, int port);  // 端口已解绑时返回false
+
+  public:
+    explicit SimNetwork(uint64_t seed = 1);
+
+    // 所有方向的默认链路
+    void set_link(const SimLink& link);
+    // 覆盖from_port到to_port方向的链路
+    void set_link(int from_port, int to_port, const SimLink& link);
+
+    // 在虚拟时钟下运行场景，调用线程成为调度的一员；场景返回前须join其启动的所有线程
+    void run(const std::function<void()>& scenario);
+
+    SimStats stats() const;
+
+  public:
+    bool simulated() const override;
+
+    time_point now() override;
+    void       sleep_for(clock::duration dur) override;
+
+    std::thread spawn(std::function<void()> fn) override;
+    void        join(std::thread& t) override;
+
+    void wait_until(std::unique_lock<std::mutex>& lk, std::condition_variable& cv, time_point deadline) override;
+    void notify_all(std::condition_variable& cv) override;
+
+    void bind(int port) override;
+    void unbind(int port) override;
+    int  send_to(int port, const void* data, size_t len, const sockaddr_in& to, uint8_t tos = 0) override;
+    int  recv_from(int port, void* buf, size_t len, sockaddr_in* from, uint8_t* tos = nullptr) override;
+    int  peek_size(int port) override;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __NET_RUDP_RUDP_STATS_H__
+#define __NET_RUDP_RUDP_STATS_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#define RTT_HIST_BUCKETS 16  // 0号桶为<1ms，第i号桶为[2^(i-1), 2^i)ms，最后一个桶收纳更大的样本
+
+enum class StatsFormat
+{
+    JSON,
+    CSV
+};
+
+/**
+ * @brief 连接统计快照
+ *
+ * 由RUDP::stats()生成，字段均为读取时刻的拷贝，可随意传递与序列化。
+ */
+struct RUDP_Stats
+{
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t packets_sent;
+    uint64_t packets_received;
+
+    uint64_t timeout_retransmits;   // 超时重传的报文数
+    uint64_t fast_retransmits;      // 快速重传的报文数(含RACK按时间判定的丢包)
+    uint64_t tail_probes;           // 尾部丢失探测发出的报文数
+    uint64_t spurious_retransmits;  // 被对端报告为重复到达(D-SACK)的报文数
+    uint64_t cwnd_undos;            // 因重传全部多余而撤销的降窗次数
+    uint64_t ce_received;           // IP头带CE标记到达的报文数(接收方)
+    uint64_t ecn_reductions;        // 因ECE回显而降窗的次数(发送方)
+    uint64_t dup_acks;              // 收到的重复ACK数
+    uint64_t out_of_order;          // 乱序到达的报文数
+    uint64_t kernel_drops;          // 内核接收队列溢出丢弃数，不属于网络丢包
+
+    uint64_t compress_in;        // 送入压缩的原始字节数(含因压缩率差而原样发送的)
+    uint64_t compress_out;       // 上述数据实际上线的字节数
+    uint64_t compress_bypassed;  // 原样发送的报文段数
+    uint64_t compress_us;        // 压缩耗费的CPU时间(微秒)
+    uint64_t decompress_us;      // 解压耗费的CPU时间(微秒)
+    double   compress_ratio;     // compress_in / compress_out，未启用压缩时为0
+
+    double   cwnd;
+    double   ssthresh;
+    uint32_t srtt_ms;
+    uint32_t rttvar_ms;
+    uint32_t rto_ms;
+    double   delivery_rate;  // 字节/秒
+
+    uint64_t rtt_hist[RTT_HIST_BUCKETS];
+
+    std::string toJson() const;
+    std::string toCsv() const;
+
+    static std::string csvHeader();
+};
+
+/**
+ * @brief 热路径上的统计计数器
+ *
+ * 全部使用relaxed原子操作，只保证计数本身不丢失，不建立任何先后关系。窗口与RTT等状态量由
+ * 收发线程在修改后发布到对应字段，统计线程只读这些副本，不接触_paths等受锁保护的结构。
+ */
+struct RUDP_Counters
+{
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> packets_sent{0};
+    std::atomic<uint64_t> packets_received{0};
+    std::atomic<uint64_t> timeout_retransmits{0};
+    std::atomic<uint64_t> fast_retransmits{0};
+    std::atomic<uint64_t> tail_probes{0};
+    std::atomic<uint64_t> spurious_retransmits{0};
+    std::atomic<uint64_t> cwnd_undos{0};
+    std::atomic<uint64_t> ce_received{0};
+    std::atomic<uint64_t> ecn_reductions{0};
+    std::atomic<uint64_t> dup_acks{0};
+    std::atomic<uint64_t> out_of_order{0};
+    std::atomic<uint64_t> compress_in{0};
+    std::atomic<uint64_t> compress_out{0};
+    std::atomic<uint64_t> compress_bypassed{0};
+    std::atomic<uint64_t> compress_us{0};
+    std::atomic<uint64_t> decompress_us{0};
+    std::atomic<uint64_t> rtt_hist[RTT_HIST_BUCKETS]{};
+
+    // 最近一次发布的状态量，reset不清零
+    std::atomic<double>   cwnd{0};
+    std::atomic<double>   ssthresh{0};
+    std::atomic<uint32_t> srtt_ms{0};
+    std::atomic<uint32_t> rttvar_ms{0};
+    std::atomic<uint32_t> rto_ms{0};
+    std::atomic<double>   delivery_rate{0};
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t n = 1)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    static void set(std::atomic<T>& gauge, T value)
+    {
+        gauge.store(value, std::memory_order_relaxed);
+    }
+
+    void recordRtt(std::chrono::milliseconds rtt);
+    void reset();
+    void fill(RUDP_Stats& stats) const;
+};
+
+#endif
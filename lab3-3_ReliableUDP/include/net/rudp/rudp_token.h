@@ -0,0 +1,47 @@
+#ifndef __NET_RUDP_RUDP_TOKEN_H__
+#define __NET_RUDP_RUDP_TOKEN_H__
+
+#include <stdint.h>
+#include <map>
+
+#define TOKEN_LIFETIME_MS (10 * 60 * 1000)  // 令牌有效期10分钟
+#define TOKEN_REPLAY_CACHE 4096             // 有效期内最多记录的已用令牌数，满时拒绝0-RTT
+
+#pragma pack(1)
+
+// 会话恢复令牌：由服务端签发，客户端在下次SYN中原样带回
+struct RUDP_TOKEN
+{
+    uint32_t addr;       // 签发对象的IPv4地址(网络序)
+    uint64_t expire_ms;  // 过期时刻，服务端时钟的毫秒数
+    uint64_t nonce;      // 使每个令牌唯一，重放检测以此区分
+    uint64_t mac;        // SipHash-2-4(服务端密钥, 以上字段)
+};
+
+#pragma pack()
+
+/**
+ * @brief 会话恢复令牌的签发与核验
+ *
+ * 密钥在构造时随机生成且不离开进程，客户端既不能伪造也不能改动令牌中的地址与期限；
+ * 服务端重启后旧令牌全部失效，连接退回完整握手。0-RTT数据可被重放，因此每个令牌只能
+ * 兑现一次，已兑现的令牌在过期前记录在内存中。
+ */
+class TokenIssuer
+{
+  private:
+    uint64_t                     _k0, _k1;
+    uint64_t                     _counter;
+    std::map<uint64_t, uint64_t> _redeemed;  // 已兑现令牌的nonce -> 过期时刻
+
+    uint64_t _mac(const RUDP_TOKEN& token) const;
+
+  public:
+    TokenIssuer();
+
+    RUDP_TOKEN issue(uint32_t addr, uint64_t now_ms);
+    // 摘要、地址、期限都正确且未兑现过时返回true，并把令牌记为已兑现
+    bool redeem(const RUDP_TOKEN& token, uint32_t addr, uint64_t now_ms);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __NET_RUDP_RUDP_TRACE_H__
+#define __NET_RUDP_RUDP_TRACE_H__
+
+#include <net/rudp/rudp_env.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#define TRACE_CAPACITY (1 << 16)  // 每个连接保留最近65536条事件，必须是2的幂
+#define TRACE_MAGIC 0x43525452    // "RTRC"
+#define TRACE_VERSION 1
+
+#define TRACE_EVENT_LIST    \
+    X(PACKET_SENT, 0)       \
+    X(PACKET_ACKED, 1)      \
+    X(PACKET_LOST, 2)       \
+    X(CWND_CHANGE, 3)       \
+    X(RTO_FIRED, 4)         \
+    X(STATE_CHANGE, 5)      \
+    X(RTT_SAMPLE, 6)        \
+    X(PROBE_SENT, 7)
+
+enum class TraceEvent : uint8_t
+{
+#define X(name, idx) name = idx,
+    TRACE_EVENT_LIST
+#undef X
+};
+
+// STATE_CHANGE事件的aux字段
+#define CC_STATE_LIST               \
+    X(SLOW_START, 0)                \
+    X(CONGESTION_AVOIDANCE, 1)      \
+    X(FAST_RECOVERY, 2)
+
+enum class CcState : uint8_t
+{
+#define X(name, idx) name = idx,
+    CC_STATE_LIST
+#undef X
+};
+
+#pragma pack(1)
+
+/*
+ *  各事件的字段含义：
+ *  PACKET_SENT:  seq=报文序号  len=数据长度  aux=报文flags低8位
+ *  PACKET_ACKED: seq=被确认序号  aux=路径号
+ *  PACKET_LOST:  seq=判定丢失的序号  aux=路径号
+ *  CWND_CHANGE:  seq=当前base  v1=cwnd  v2=ssthresh  aux=路径号
+ *  RTO_FIRED:    seq=超时序号  v1=RTO(ms)
+ *  STATE_CHANGE: aux=CcState
+ *  RTT_SAMPLE:   seq=采样报文序号  v1=样本(ms)  v2=平滑RTT(ms)  aux=路径号
+ */
+struct TraceRecord
+{
+    uint64_t ts_ns;  // steady_clock单调时间戳
+    uint8_t  type;
+    uint8_t  aux;
+    uint16_t len;
+    uint32_t seq;
+    float    v1;
+    float    v2;
+};
+
+struct TraceFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t count;
+};
+
+#pragma pack()
+
+std::string traceEventStr(TraceEvent type);
+std::string ccStateStr(CcState state);
+
+/**
+ * @brief 定长二进制事件环
+ *
+ * 记录一次事件只需一次relaxed的fetch_add与一次时钟读取，写满后覆盖最旧的记录；
+ * 未启用时record仅做一次原子读。导出文件可用trace_conv转换为qlog风格JSON或CSV。
+ */
+class RUDP_Trace
+{
+  private:
+    RUDP_Env&                      _env;  // 时间戳取自所属连接的环境时钟
+    std::unique_ptr<TraceRecord[]> _ring;
+    std::atomic<uint64_t>          _head;
+    std::atomic<bool>              _enabled;
+
+  public:
+    RUDP_Trace(RUDP_Env& env);
+
+    // 首次启用时分配环形缓冲区
+    void enable(bool on);
+    bool enabled() const;
+    void clear();
+
+    void record(TraceEvent type, uint32_t seq, float v1 = 0, float v2 = 0, uint8_t aux = 0, uint16_t len = 0);
+
+    // 按时间顺序导出当前保留的全部事件
+    bool dump(const std::string& path) const;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef __NET_RUDP_RUDP_URING_H__
+#define __NET_RUDP_RUDP_URING_H__
+
+#include <net/socket_defs.h>
+#include <net/rudp/rudp_defs.h>
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#define URING_ENTRIES 256     // 每个环的SQ深度
+#define URING_RECV_BUFS 64    // 多发接收使用的预置缓冲区个数，须为2的幂
+#define URING_SEND_SLOTS 128  // 发送槽位数，即最多在途(已提交未完成)的发送数
+#define URING_BUF_GROUP 1
+
+/**
+ * @brief 基于io_uring的数据报收发后端
+ *
+ * 接收：一个多发(multishot)recvmsg请求常驻内核，数据报直接落入预先注册的缓冲区环，
+ * 每个完成事件对应一个数据报，取走后缓冲区立即归还；只有完成队列为空时才进入内核等待，
+ * 请求失效后的重新挂起与等待合并在同一次io_uring_enter中。
+ * 发送：报文拷入预分配的发送槽位后生成sendmsg SQE，more为真时暂不提交，
+ * 一批报文在flush时一次提交；槽位在对应完成事件到达后回收。
+ *
+ * 收与发各用一个环，分别加锁，因此收包线程与各发送线程互不阻塞。
+ * 直接使用系统调用，不依赖liburing；非Linux平台open()恒返回false。
+ */
+class UringIo
+{
+  private:
+    struct Ring
+    {
+        int    fd        = -1;
+        void*  sq_ptr    = nullptr;
+        size_t sq_size   = 0;
+        void*  cq_ptr    = nullptr;
+        size_t cq_size   = 0;
+        void*  sqes      = nullptr;
+        size_t sqes_size = 0;
+
+        unsigned* sq_head  = nullptr;
+        unsigned* sq_tail  = nullptr;
+        unsigned* sq_mask  = nullptr;
+        unsigned* sq_array = nullptr;
+        unsigned* cq_head  = nullptr;
+        unsigned* cq_tail  = nullptr;
+        unsigned* cq_mask  = nullptr;
+        void*     cqes     = nullptr;
+
+        unsigned sqe_tail = 0;  // 本地SQ尾，enter时才对内核发布
+        unsigned pending  = 0;  // 已填写未提交的SQE数
+
+        bool  setup(unsigned entries);
+        void  teardown();
+        void* next_sqe();
+        int   enter(unsigned min_complete);  // 提交全部待提交的SQE，并等待至少min_complete个完成事件
+        void* peek_cqe();
+        void  advance_cqe();
+    };
+
+    SOCKET _sockfd;
+    Ring   _rx;
+    Ring   _tx;
+
+    std::mutex        _rx_mtx;
+    void*             _buf_ring;  // 注册给内核的缓冲区环
+    size_t            _buf_ring_size;
+    std::vector<char> _rx_bufs;  // URING_RECV_BUFS个接收缓冲区
+    size_t            _rx_buf_size;
+    void*             _rx_msg;  // 多发recvmsg的msghdr模板，内核只使用其中的名字与控制区长度
+    bool              _rx_armed;
+
+    struct SendSlot;
+    std::mutex            _tx_mtx;
+    std::vector<SendSlot> _tx_slots;
+    std::vector<int>      _tx_free;
+
+    void _arm_recv();
+    void _recycle(uint16_t bid);
+    void _reap_sends();
+
+  public:
+    UringIo();
+    ~UringIo();
+    UringIo(const UringIo&)            = delete;
+    UringIo& operator=(const UringIo&) = delete;
+
+    // 在已绑定的UDP套接字上建立两个环并挂起多发接收，内核不支持时返回false
+    bool open(SOCKET sockfd);
+    void close();
+    bool valid() const;
+
+    // 阻塞直到收到一个数据报，drops在数据报附带SO_RXQ_OVFL计数时被更新，tos取自IP_RECVTOS控制消息
+    int recv(void* buf, size_t len, sockaddr_in* from, uint32_t& drops, uint8_t* tos = nullptr);
+    // 同上，但数据报直接拷入place(n)返回的位置，n为数据报长度，place可将其改小以截断
+    int recv(const std::function<void*(size_t&)>& place, sockaddr_in* from, uint32_t& drops, uint8_t* tos = nullptr);
+
+    // 排入一个数据报，more为假时连同之前排入的一起提交；返回排入的字节数
+    int  send(const void* data, size_t len, const sockaddr_in& to, bool more = false);
+    void flush();
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef __TRANSFER_CHUNK_HASH_H__
+#define __TRANSFER_CHUNK_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// XXH64(种子为0)：按8字节字处理的非密码学散列，用于断点续传时核对分块内容，速度接近内存带宽
+uint64_t chunkHash(const char* data, size_t len);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __TRANSFER_DELTA_INDEX_H__
+#define __TRANSFER_DELTA_INDEX_H__
+
+#include <transfer/file_msg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define DELTA_MIN_BLOCK 2048          // 块长下限，块太小时签名与COPY记录的开销超过节省的数据
+#define DELTA_MAX_BLOCKS (1 << 16)    // 已有副本的块数上限，超过时加大块长
+#define DELTA_SCAN_BATCH (64 << 10)   // 每批计算弱校验和的位置数
+
+// rsync的弱校验和：a为各字节之和，b为按到块尾距离加权之和，各取低16位，返回a | b << 16
+uint32_t weakChecksum(const char* data, size_t len);
+
+/**
+ * @brief 对每个位置计算以它开头的一个块的弱校验和
+ *
+ * 不逐字节滚动更新，而是先求字节与加权字节的前缀和，每个位置的a、b都由前缀和之差得到，
+ * 各位置互不依赖，由编译器向量化。a、b只取低16位，前缀和也按16位计算：有SSE2时每次8个字节，
+ * 组内用移位相加求前缀，组间只传递末项。
+ */
+class RollingChecksum
+{
+  private:
+    std::vector<uint16_t> _sum;       // _sum[i]为前i个字节之和
+    std::vector<uint16_t> _weighted;  // _weighted[i]为前i个字节按下标加权之和
+    std::vector<uint32_t> _weak;
+
+  public:
+    // 计算data[0, count)各位置的弱校验和，需要data[0, count + block - 1)可读；返回的数组在下次scan前有效
+    const uint32_t* scan(const char* data, size_t count, size_t block);
+};
+
+/**
+ * @brief 已有副本的块签名索引，发送方据此在新文件中查找可以引用的块
+ *
+ * 弱校验和折叠到16位后记入位图，绝大多数位置一次位测试即可排除；命中时再按弱校验和
+ * 二分查找候选块，最后比对强散列。优先尝试上一个匹配块的下一块，未改动的区域连续命中。
+ */
+class DeltaIndex
+{
+  private:
+    std::vector<BlockSignature> _sigs;
+    std::vector<uint32_t>       _order;  // 按弱校验和排序的块号
+    std::vector<uint64_t>       _tags;   // 2^16位的位图
+    size_t                      _block;
+
+    static uint32_t _tag(uint32_t weak);
+
+  public:
+    DeltaIndex(std::vector<BlockSignature> sigs, size_t block);
+
+    // 找内容与data[0, block)一致的块，优先hint；没有时返回UINT32_MAX
+    uint32_t find(uint32_t weak, const char* data, uint32_t hint) const;
+
+    // 接收方按已有副本的长度选取块长，约为其平方根，且块数不超过DELTA_MAX_BLOCKS
+    static uint32_t block_size_for(uint64_t size);
+    // 计算data[0, size)各整块的签名
+    static std::vector<BlockSignature> sign(const char* data, size_t size, size_t block);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __TRANSFER_DIR_SENDER_H__
+#define __TRANSFER_DIR_SENDER_H__
+
+#include <net/rudp/rudp.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define DIR_SEND_JOBS 4            // 默认同时在途的文件数
+#define PACK_FILE_SIZE (16 << 10)  // 不超过此长度的文件与其他小文件拼在同一分片中
+
+/**
+ * @brief 经RUDP_C发送整个目录
+ *
+ * 先发清单(相对路径、长度、权限)，接收方据此重建目录树并一次打开全部文件。之后jobs个工作
+ * 线程各自领取文件，映射、预读与回收都在本线程完成，磁盘等待与其他文件的发送重叠；分片
+ * 自带文件编号与偏移，各文件的分片在连接上交错发出。小文件读入共享的拼包缓冲区，凑满一个
+ * 分片再作为PACK发送，成千上万的小文件不再各占一个报文。发完后等待接收方的RESULT应答，
+ * 得知各条目是否都已落盘。
+ */
+class DirectorySender
+{
+  private:
+    struct Entry
+    {
+        std::string path;  // 本地路径
+        std::string name;  // 清单中的相对路径
+        uint64_t    size;
+        uint32_t    mode;
+        uint32_t    id;
+    };
+
+    RUDP_C& _conn;
+    size_t  _mss;
+    size_t  _jobs;
+
+    std::vector<Entry>    _entries;
+    std::atomic<size_t>   _next;      // 下一个待领取的条目
+    std::mutex            _send_mtx;  // RUDP_C的发送接口不可并发调用，同时保护_pack
+    std::vector<char>     _pack;      // 待发送的PACK负载
+    std::atomic<uint64_t> _sent;
+    std::atomic<size_t>   _failed;    // 清单发出后无法读取的文件数
+    size_t                _rejected;  // 接收方报告未能落盘的条目数
+    bool                  _confirmed;
+
+    void _send_manifest();
+    void _worker_handler();
+    void _send_file(const Entry& entry);
+    void _pack_file(const Entry& entry);
+    void _flush_pack();  // 调用方持有_send_mtx
+    void _await_result();
+
+  public:
+    // mss为每个分片的负载长度，含分段头；jobs为同时在途的文件数
+    DirectorySender(RUDP_C& conn, size_t mss = BODY_SIZE, size_t jobs = DIR_SEND_JOBS);
+
+    // 发送dir下的全部文件与子目录，接收方在其目录下重建以dir的名字为根的目录树；dir无法遍历时返回false
+    bool send(const std::string& dir);
+
+    // 最近一次send发出的文件字节数与文件数
+    uint64_t bytes_sent() const;
+    size_t   files_sent() const;
+
+    // 最近一次send中本地无法读取或接收方未能落盘的条目数
+    size_t files_failed() const;
+
+    // 最近一次send是否收到了接收方的RESULT应答；本地有文件无法读取时接收方收不齐，不再等待
+    bool confirmed() const;
+};
+
+#endif
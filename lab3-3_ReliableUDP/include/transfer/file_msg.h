@@ -0,0 +1,121 @@
+#ifndef __TRANSFER_FILE_MSG_H__
+#define __TRANSFER_FILE_MSG_H__
+
+#include <stdint.h>
+
+// 文件传输使用的消息类型，经RUDP消息接口收发
+enum class FileMsg : uint16_t
+{
+    NAME      = 1,  // 单分片消息，负载为FileHeader加文件名，随后是该文件的SKIP(续传)或COPY(增量)与DATA
+    DATA      = 2,  // 文件内容，每个分片以SegmentHeader开头，可与其他文件的分片交错
+    MANIFEST  = 3,  // 目录清单，首个分片以ManifestHeader开头，每个分片只含完整的ManifestEntry
+    PACK      = 4,  // 单分片消息，多个小文件各以PackRecord开头依次拼在同一个负载中
+    QUERY     = 5,  // 负载为ReplyQuery，请求服务端重发该文件的RESUME、RESULT应答或从first起的SIGNATURE应答
+    RESUME    = 6,  // 服务端对NAME的应答(经RUDP_S::reply)，负载为ResumeState、块位图与已有块的散列
+    SKIP      = 7,  // 发送方核对散列后不再发送的块，负载为ResumeState与块位图，随后才是DATA
+    SIGNATURE = 8,  // 服务端对增量NAME的应答，负载为SignatureHeader与已有副本从first起的各块签名
+    COPY      = 9,  // 单分片消息，负载为CopyHeader与CopyRecord，引用已有副本中的块，其余内容仍以DATA发送
+    RESULT    = 10  // 服务端在目录的全部条目处理完后的应答，负载为BatchResult
+};
+
+#define MANIFEST_DIR 0040000  // ManifestEntry::mode中的目录标记，与st_mode的S_IFDIR取值相同
+#define FILE_DELTA 0x1        // FileHeader::flags：接收方已有同名文件时以它为基础增量传输
+
+#pragma pack(1)
+
+// NAME消息的负载头，后接文件名
+struct FileHeader
+{
+    uint32_t id;          // 发送方给每个文件分配的编号，DATA分片据此对应到文件
+    uint64_t size;        // 文件长度，接收方据此预分配空间并判断是否收齐
+    uint32_t chunk_size;  // 断点续传的分块大小，0表示不续传
+    uint32_t flags;       // FILE_*标志
+};
+
+// DATA分片的负载头，后接文件内容；分片自带位置，接收方可按任意顺序写入
+struct SegmentHeader
+{
+    uint32_t id;
+    uint64_t offset;
+};
+
+// RESUME与SKIP的负载头，后接(count + 7) / 8字节的块位图(低位在前)；
+// RESUME中置位的块是接收方已有的块，位图之后按块号顺序为每个置位的块附一个chunkHash
+struct ResumeState
+{
+    uint32_t id;
+    uint32_t count;  // 文件的块数
+};
+
+// QUERY的负载，first只对SIGNATURE应答有意义，为发送方尚未收到的第一个块签名
+struct ReplyQuery
+{
+    uint32_t id;
+    uint32_t first;
+};
+
+// SIGNATURE的负载头，后接已有副本第first块起的若干BlockSignature，直到分片结束
+struct SignatureHeader
+{
+    uint32_t id;
+    uint32_t block_size;
+    uint32_t count;  // 已有副本的整块数，不足一块的尾部不参与匹配
+    uint32_t first;
+};
+
+// 已有副本一个块的签名
+struct BlockSignature
+{
+    uint32_t weak;    // weakChecksum，可在新文件上逐字节滚动计算
+    uint64_t strong;  // chunkHash，弱校验和相同时再比对
+};
+
+// COPY的负载头，后接count个CopyRecord
+struct CopyHeader
+{
+    uint32_t id;
+    uint32_t count;
+};
+
+// 把已有副本从block起的count个连续块写到新文件的offset处
+struct CopyRecord
+{
+    uint64_t offset;
+    uint32_t block;
+    uint32_t count;
+};
+
+// 清单的开头，说明随后的条目数与文件总长度
+struct ManifestHeader
+{
+    uint32_t count;  // 条目数，含目录
+    uint64_t bytes;  // 所有文件的长度之和
+};
+
+// 清单条目，后接name_len字节的相对路径(以/分隔，首段为发送的目录名)
+struct ManifestEntry
+{
+    uint32_t id;
+    uint64_t size;
+    uint32_t mode;  // 权限位，目录另带MANIFEST_DIR
+    uint16_t name_len;
+};
+
+// RESULT的负载，id为清单中根目录条目的编号
+struct BatchResult
+{
+    uint32_t id;
+    uint32_t count;   // 清单条目数
+    uint32_t failed;  // 未能完整落盘的条目数
+};
+
+// PACK负载中一个小文件的记录头，后接该文件的全部内容
+struct PackRecord
+{
+    uint32_t id;
+    uint32_t len;
+};
+
+#pragma pack()
+
+#endif
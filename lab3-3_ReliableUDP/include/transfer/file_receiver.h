@@ -0,0 +1,123 @@
+#ifndef __TRANSFER_FILE_RECEIVER_H__
+#define __TRANSFER_FILE_RECEIVER_H__
+
+#include <net/rudp/rudp_buf.h>
+#include <transfer/file_msg.h>
+#include <transfer/file_sink.h>
+#include <transfer/mapped_file.h>
+#include <transfer/resume_journal.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define DELTA_SUFFIX ".delta"  // 增量传输时新内容先写入的临时文件后缀
+
+/**
+ * @brief 按FileMsg协议接收文件，内容经FileSink写入dir目录
+ *
+ * on_packet接RUDP_S::listen(buffer_callback)的按序交付，on_early接set_early_delivery：
+ * 属于已打开文件的DATA分片与PACK乱序到达时直接按偏移写盘，不在重排缓冲区中等待缺口补齐。
+ * 两者都在服务端收包线程中调用，落盘由FileSink的写入线程完成，不阻塞确认。
+ *
+ * 目录传输先收清单，按其中的相对路径在dir下重建目录树并记下各文件，文件在首个分片到达时
+ * 才打开、收齐即关闭，同时打开的只有在途的少数文件；各文件的分片可以任意交错到达。清单中的
+ * 条目全部处理完后输出总字节数与吞吐量，并经应答回调把失败的条目数作为RESULT报告给发送方。
+ *
+ * 单个文件带分块大小时支持断点续传：按块把接收进度记在<文件>.part中，再次收到同名同长度的
+ * 文件时保留已有内容，把记录为完成的块的散列经应答回调报告给发送方，由发送方跳过一致的块。
+ *
+ * 发送方请求增量传输且没有可续传的记录时，以已有的同名文件为基础：把它各块的弱校验和与
+ * 强散列经应答回调发回，发送方只发不匹配的内容(DATA)与对已有块的引用(COPY)。新内容写在
+ * <文件>.delta中，收齐后替换原文件，期间原文件保持完整。
+ */
+class FileReceiver
+{
+  public:
+    using reply_callback = std::function<void(uint16_t type, const char* data, size_t len)>;
+
+  private:
+    // 一次目录传输的进度，目录在收包线程中完成，文件在写入线程关闭后完成
+    struct Batch
+    {
+        uint32_t                                      id = 0;  // 根目录条目的编号
+        std::string                                   root;
+        size_t                                        count = 0;  // 清单条目数
+        uint64_t                                      bytes = 0;
+        std::chrono::steady_clock::time_point         start;
+        std::vector<std::pair<std::string, uint32_t>> dirs;  // 全部落盘后再设置权限，以免只读目录挡住写入
+        // 尚未完成的条目数，另加1由清单末尾释放；归零者负责_finish
+        std::atomic<size_t>                           pending{1};
+        std::atomic<size_t>                           failed{0};  // 失败的条目数
+    };
+
+    struct Incoming
+    {
+        uint64_t                       size;
+        uint64_t                       received;        // 已交给FileSink的字节数，含续传时跳过的块
+        uint32_t                       mode;            // 权限位，0表示不设置
+        std::shared_ptr<Batch>         batch;           // 单独发送的文件为空
+        uint32_t                       chunk_size = 0;  // 断点续传的分块大小，0表示不续传
+        std::vector<uint64_t>          chunk_left;      // 各块尚未收到的字节数
+        std::unique_ptr<ResumeJournal> journal;         // 无法建立记录时为空，照常接收
+        std::shared_ptr<MappedFile>    basis;           // 增量传输时的已有副本，COPY从中取块
+        uint32_t                       block_size = 0;  // 增量传输的块长
+        std::string                    target;          // 增量传输时收齐后替换的文件
+        std::string                    path;            // 尚未打开时的路径，首个分片到达时打开
+    };
+
+    std::string                  _dir;
+    std::map<uint32_t, Incoming> _files;  // 已打开(或已登记待打开)尚未收齐的文件
+    std::shared_ptr<Batch>       _batch;  // 正在接收清单的目录传输
+
+    reply_callback              _reply;
+    uint32_t                    _reply_id;     // 最近一次应答所属的文件
+    std::vector<char>           _reply_cache;  // 最近一次RESUME应答，收到QUERY时原样重发
+    std::vector<BlockSignature> _signatures;   // 最近一次SIGNATURE应答的全部签名，收到QUERY时从first起重发
+    uint32_t                    _block_size;
+
+    std::mutex  _result_mtx;  // _finish在写入线程中调用
+    BatchResult _result;      // 最近完成的目录，收到QUERY时重发
+
+    // 最后声明、最先析构：写入线程退出前仍会回调_release，此时其他成员都还有效
+    FileSink _sink;
+
+    void _on_name(const PacketBuf& packet);
+    void _on_manifest(const PacketBuf& packet);
+    void _on_skip(const PacketBuf& packet);
+    bool _open(uint32_t id, const std::string& path, uint64_t size, uint32_t mode, std::shared_ptr<Batch> batch,
+        bool truncate = true, bool defer = false);
+    bool _opened(uint32_t id);  // 打开登记待打开的文件，失败时按失败的条目结束它
+    void _resume(uint32_t id, const std::string& path, uint32_t chunk_size, std::unique_ptr<ResumeJournal> journal,
+        bool reuse);
+    bool _delta(uint32_t id, const std::string& path, uint64_t size);  // 没有可作基础的已有文件时返回false
+    void _send_signatures(uint32_t first);
+    void _on_copy(const PacketBuf& packet);
+    bool _on_data(const PacketBuf& packet);
+    bool _on_pack(const PacketBuf& packet, bool early);
+    void _received(uint32_t id, uint64_t offset, size_t len);
+
+    void _release(Batch& batch);  // 一个条目完成
+    void _finish(Batch& batch);
+
+  public:
+    explicit FileReceiver(const std::string& dir = "download");
+
+    void on_packet(const PacketBuf& packet);
+    bool on_early(const PacketBuf& packet);
+
+    // 续传与增量协商经cb把RESUME、SIGNATURE应答发回发送方，通常接RUDP_S::reply；
+    // 未设置时发送方等不到应答，会整个重发
+    void set_reply(reply_callback cb);
+
+    // 等待已收到的内容全部落盘
+    void flush();
+};
+
+#endif
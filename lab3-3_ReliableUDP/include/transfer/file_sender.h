@@ -0,0 +1,81 @@
+#ifndef __TRANSFER_FILE_SENDER_H__
+#define __TRANSFER_FILE_SENDER_H__
+
+#include <net/rudp/rudp.h>
+#include <transfer/file_msg.h>
+#include <transfer/mapped_file.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define READ_AHEAD_SIZE (8 << 20)  // 预读领先发送位置的字节数
+#define READ_AHEAD_STEP (1 << 20)  // 预读与回收的粒度
+#define RESUME_REPLY_TIMEOUT 500   // 等待RESUME应答的初始超时(ms)，每次重发QUERY后加倍
+#define RESUME_QUERY_RETRIES 6     // 重发QUERY的次数，用尽后整个文件照常发送
+
+/**
+ * @brief 经RUDP_C发送文件
+ *
+ * 文件整体映射，分片直接从映射区交给send_fragment，与分段头一起在构造报文时拷贝一次，
+ * 不经过中间缓冲区。预读线程始终领先发送位置READ_AHEAD_SIZE字节，把页读入页缓存并建好映射，
+ * 发送路径上不会因缺页等待磁盘；已装入发送窗口的部分随即提示内核回收。
+ *
+ * 超过一块的文件按块协商续传：NAME带上分块大小后等待接收方的RESUME应答，对其中已有的块
+ * 算出源文件的散列逐一比对，一致的块记入SKIP消息且不再发送，预读也随之跳过。
+ *
+ * 开启增量传输后，接收方已有同名文件时回以其各块的签名。发送方在新文件上逐位置计算弱校验和，
+ * 经DeltaIndex找到内容相同的块就以COPY引用，其余内容照常以DATA发送。
+ */
+class FileSender
+{
+  private:
+    RUDP_C&    _conn;
+    size_t     _mss;
+    MappedFile _file;
+    size_t     _sent;
+    size_t     _skipped;
+
+    uint32_t          _chunk_size;  // 0表示不续传
+    std::vector<bool> _skip;        // 各块是否跳过，发送期间只读
+
+    bool                        _delta;
+    uint32_t                    _block_size;  // 接收方已有副本的块长
+    std::vector<BlockSignature> _signatures;
+
+    std::mutex              _mtx;
+    std::condition_variable _cv;
+    size_t                  _pos;   // 已交给连接的字节数，预读线程据此推进
+    bool                    _done;  // 发送结束或中止，预读线程退出
+
+    void     _read_ahead_handler();
+    void     _advance(size_t pos);  // 推进发送位置，唤醒预读线程
+    uint16_t _await_reply(uint32_t id, std::vector<char>& resume);
+    void     _skip_chunks(uint32_t id, const std::vector<char>& resume);
+    bool     _skipped_at(size_t off) const;
+    void     _send_chunks(uint32_t id);
+    void     _send_delta(uint32_t id);
+    void     _send_literal(uint32_t id, size_t from, size_t to);
+    void     _send_copies(uint32_t id, std::vector<CopyRecord>& records);
+
+  public:
+    // mss为每个分片的负载长度，含分段头
+    FileSender(RUDP_C& conn, size_t mss = BODY_SIZE);
+
+    // 先发带编号与长度的NAME消息(文件名不含目录)，协商续传后把其余内容作为一条DATA消息发出；
+    // 文件无法打开时返回false
+    bool send(const std::string& path);
+
+    // 之后的send请求增量传输，默认关闭；接收方没有同名文件时多等一个往返后照常发送
+    void set_delta(bool enabled);
+
+    // 最近一次send实际发出的文件字节数，与接收方已有(续传跳过或增量引用)而未发送的字节数
+    size_t bytes_sent() const;
+    size_t bytes_skipped() const;
+
+    // 预留count个连续的文件编号，返回第一个；单个文件与目录传输共用编号空间
+    static uint32_t next_id(uint32_t count = 1);
+};
+
+#endif
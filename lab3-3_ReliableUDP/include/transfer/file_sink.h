@@ -0,0 +1,73 @@
+#ifndef __TRANSFER_FILE_SINK_H__
+#define __TRANSFER_FILE_SINK_H__
+
+#include <net/rudp/rudp_buf.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define SINK_QUEUE_DEPTH 256        // 写队列最多积压的分段数，满时写入方阻塞
+#define SINK_SYNC_BYTES (16 << 20)  // 每写入这么多字节合并做一次fdatasync
+
+/**
+ * @brief 接收文件的异步落盘
+ *
+ * 收包线程只把(偏移, 负载句柄)放进有界队列，由写入线程用pwrite按偏移写入，负载在写完前
+ * 一直由句柄持有，不另行拷贝。文件在open时按声明的长度fallocate预分配，分段可以按任意顺序
+ * 到达；fdatasync按SINK_SYNC_BYTES合并，close时再做最后一次。非Linux平台退化为fstream定位写。
+ * 文件按调用方给的编号区分，可以同时打开多个，各自的分段在同一队列中交错写入。
+ */
+class FileSink
+{
+  public:
+    using done_callback = std::function<void(const std::string& path, bool ok)>;
+
+  private:
+    struct Target;
+    struct Job
+    {
+        std::shared_ptr<Target> target;
+        uint64_t                offset;
+        PacketBuf               packet;  // 持有data所在的缓冲区
+        const char*             data;
+        size_t                  len;
+        bool                    close;  // 关闭任务：同步并关闭文件，再回调done
+        done_callback           done;
+    };
+
+    std::mutex              _mtx;
+    std::condition_variable _cv;
+    std::deque<Job>         _jobs;
+    size_t                  _busy;  // 写入线程正在处理的任务数
+    bool                    _stop;
+    std::thread             _writer;
+
+    std::map<uint32_t, std::shared_ptr<Target>> _files;  // 已打开尚未close的文件
+
+    void _push(Job job);
+    void _writer_handler();
+
+  public:
+    FileSink();
+    ~FileSink();  // 写完已排队的分段后退出
+    FileSink(const FileSink&)            = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    // 创建(或截断)path并预分配size字节，以id打开；id已打开时先关闭旧文件。
+    // truncate为假时保留已有内容(断点续传)
+    bool open(uint32_t id, const std::string& path, uint64_t size, bool truncate = true);
+    // 把data[0, len)写到文件id的offset处，packet为data所在的缓冲区；队列满时阻塞
+    void write(uint32_t id, uint64_t offset, const PacketBuf& packet, const char* data, size_t len);
+    // 文件id已交齐：排在它之前的分段写完后同步并关闭，done在写入线程中回调
+    void close(uint32_t id, done_callback done = nullptr);
+    // 阻塞直到队列中的任务全部完成
+    void flush();
+};
+
+#endif
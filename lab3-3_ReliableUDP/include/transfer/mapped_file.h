@@ -0,0 +1,41 @@
+#ifndef __TRANSFER_MAPPED_FILE_H__
+#define __TRANSFER_MAPPED_FILE_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 只读映射整个文件
+ *
+ * Linux上用mmap映射并以MADV_SEQUENTIAL提示顺序访问，内容直接来自页缓存；
+ * 其他平台退化为一次性读入内存。空文件打开成功，data()可能为空指针。
+ */
+class MappedFile
+{
+  private:
+    const char*       _data;
+    size_t            _size;
+    std::vector<char> _fallback;  // 不支持mmap时的文件内容
+
+  public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const;
+    size_t      size() const;
+
+    // 让[offset, offset + len)所在的页进入页缓存并建立映射，之后访问不再缺页
+    void prefetch(size_t offset, size_t len) const;
+    // 提示[offset, offset + len)之后不再访问，可先于其他页被回收
+    void release(size_t offset, size_t len) const;
+
+    static size_t page_size();
+};
+
+#endif
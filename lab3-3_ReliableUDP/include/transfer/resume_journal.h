@@ -0,0 +1,56 @@
+#ifndef __TRANSFER_RESUME_JOURNAL_H__
+#define __TRANSFER_RESUME_JOURNAL_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#ifndef __linux__
+#include <fstream>
+#endif
+
+#define RESUME_CHUNK_SIZE (1 << 20)  // 最小分块，分块大小总是它的整数倍
+#define RESUME_SUFFIX ".part"        // 旁路记录文件的后缀
+
+/**
+ * @brief 断点续传的分块记录，保存在接收文件旁的<文件>.part中
+ *
+ * 记录头之后每块一个字节，块内数据全部交给写入线程后置1。标记可能先于数据落盘，因此续传时
+ * 只把标记过的块当作候选：接收方算出它们的散列报告给发送方，与源文件一致的块才跳过。
+ * 文件收齐并同步后由接收方删除记录。
+ */
+class ResumeJournal
+{
+  private:
+    uint64_t             _size;
+    uint32_t             _chunk_size;
+    std::vector<uint8_t> _done;
+#ifdef __linux__
+    int _fd;
+#else
+    std::fstream _file;
+#endif
+
+  public:
+    ResumeJournal();
+    ~ResumeJournal();
+    ResumeJournal(const ResumeJournal&)            = delete;
+    ResumeJournal& operator=(const ResumeJournal&) = delete;
+
+    // 打开path处长度与分块都一致的记录并沿用其标记；不存在或不一致时返回false
+    bool load(const std::string& path, uint64_t size, uint32_t chunk_size);
+    // 新建(或覆盖)记录，所有块都未完成
+    bool create(const std::string& path, uint64_t size, uint32_t chunk_size);
+    void close();
+
+    uint32_t count() const;
+    uint64_t chunk_len(uint32_t chunk) const;  // 末块可能不满
+    bool     done(uint32_t chunk) const;
+    void     mark(uint32_t chunk);
+
+    // 按文件长度选取分块大小：至少RESUME_CHUNK_SIZE，块数不超过一个RESUME应答能容纳的上限
+    static uint32_t chunk_size_for(uint64_t size);
+    // 分块大小与块数能放进一个RESUME应答
+    static bool valid(uint64_t size, uint32_t chunk_size);
+};
+
+#endif
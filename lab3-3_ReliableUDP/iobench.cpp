@@ -0,0 +1,145 @@
+#include <bits/stdc++.h>
+#include <net/socket_defs.h>
+#include <net/rudp/rudp_uring.h>
+#include <time.h>
+using namespace std;
+using namespace chrono;
+
+/*
+ *  收发后端的小包吞吐基准，在回环上直接比较socket与io_uring，不经过RUDP协议
+ *  用法: iobench [socket|uring|both] [packets] [size]
+ *  每个后端输出一行 IOBENCH,<后端>,<方向>,<报文数>,<耗时ms>,<pps>,<CPU ms>,<每核pps>
+ *  每核pps = 报文数 / 该线程消耗的CPU秒数，反映单个报文的系统调用与拷贝开销
+ */
+
+#define IOBENCH_PORT 9100
+#define IOBENCH_BATCH 32  // io_uring发送时每批提交的报文数
+
+namespace
+{
+    double threadCpuMs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+    }
+
+    SOCKET openSocket(int port)
+    {
+        SOCKET      fd   = socket(AF_INET, SOCK_DGRAM, 0);
+        int         size = 64 << 20;
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(port);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+#ifdef SO_RCVBUFFORCE
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+#endif
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            perror("bind");
+            exit(1);
+        }
+        return fd;
+    }
+
+    struct Result
+    {
+        uint64_t packets;
+        double   wall_ms;
+        double   cpu_ms;
+    };
+
+    void report(const string& backend, const string& dir, const Result& r)
+    {
+        double pps      = r.wall_ms > 0 ? r.packets * 1000.0 / r.wall_ms : 0;
+        double per_core = r.cpu_ms > 0 ? r.packets * 1000.0 / r.cpu_ms : 0;
+        cout << "IOBENCH," << backend << ',' << dir << ',' << r.packets << ',' << fixed << setprecision(1) << r.wall_ms
+             << ',' << setprecision(0) << pps << ',' << setprecision(1) << r.cpu_ms << ',' << setprecision(0)
+             << per_core << endl;
+    }
+
+    // 发送方发完数据后反复发长度为1的结束标记，直到接收方确认收到
+    void run(bool uring, uint64_t packets, size_t size)
+    {
+        SOCKET      rx_fd = openSocket(IOBENCH_PORT);
+        SOCKET      tx_fd = openSocket(IOBENCH_PORT + 1);
+        sockaddr_in to{};
+        to.sin_family      = AF_INET;
+        to.sin_port        = htons(IOBENCH_PORT);
+        to.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+        UringIo rx_io, tx_io;
+        if (uring && (!rx_io.open(rx_fd) || !tx_io.open(tx_fd)))
+        {
+            cerr << "io_uring unavailable." << endl;
+            exit(1);
+        }
+
+        atomic<bool> done = false;
+        Result       rx_result{};
+        thread       receiver([&]() {
+            vector<char> buf(65536);
+            uint32_t     drops = 0;
+            uint64_t     count = 0;
+            double       cpu_start = 0;
+            auto         start     = steady_clock::now();
+            while (true)
+            {
+                int n = uring ? rx_io.recv(buf.data(), buf.size(), nullptr, drops)
+                              : static_cast<int>(::recv(rx_fd, buf.data(), buf.size(), 0));
+                if (n < 0) continue;
+                if (n == 1) break;
+                if (count++ == 0)
+                {
+                    cpu_start = threadCpuMs();
+                    start     = steady_clock::now();
+                }
+            }
+            double wall_ms = duration<double, milli>(steady_clock::now() - start).count();
+            rx_result      = {count, wall_ms, threadCpuMs() - cpu_start};
+            done           = true;
+        });
+
+        vector<char> payload(size, 'x');
+        double       cpu_start = threadCpuMs();
+        auto         start     = steady_clock::now();
+        for (uint64_t i = 0; i < packets; ++i)
+        {
+            if (uring)
+                tx_io.send(payload.data(), size, to, (i + 1) % IOBENCH_BATCH != 0);
+            else
+                sendto(tx_fd, payload.data(), size, 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+        }
+        if (uring) tx_io.flush();
+        double wall_ms = duration<double, milli>(steady_clock::now() - start).count();
+        Result tx_result{packets, wall_ms, threadCpuMs() - cpu_start};
+
+        while (!done)
+        {
+            sendto(tx_fd, "", 1, 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+            this_thread::sleep_for(milliseconds(1));
+        }
+        receiver.join();
+
+        string backend = uring ? "uring" : "socket";
+        report(backend, "tx", tx_result);
+        report(backend, "rx", rx_result);
+
+        rx_io.close();
+        tx_io.close();
+        CLOSE_SOCKET(rx_fd);
+        CLOSE_SOCKET(tx_fd);
+    }
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    string   mode    = argc > 1 ? argv[1] : "both";
+    uint64_t packets = argc > 2 ? strtoull(argv[2], nullptr, 10) : 200000;
+    size_t   size    = argc > 3 ? max(2, atoi(argv[3])) : 64;
+
+    if (mode != "uring") run(false, packets, size);
+    if (mode != "socket") run(true, packets, size);
+}
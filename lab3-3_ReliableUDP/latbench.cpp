@@ -0,0 +1,85 @@
+#include <bits/stdc++.h>
+#include <net/socket_defs.h>
+#include <net/rudp/rudp.h>
+using namespace std;
+using namespace chrono;
+
+/*
+ *  小消息乒乓延迟基准：同一进程内起服务端与客户端，经回环直连(不经router)
+ *  每条消息携带发送时刻，服务端回调交付时记录单向延迟；客户端等到该消息被确认后再发下一条
+ *  用法: latbench [normal|latency|both] [count] [size] [client_cpu] [server_cpu]
+ *  每种模式输出一行 LATBENCH,<模式>,<条数>,<字节>,<单向p50>,<p99>,<p999>,<往返p50>,<p99>,<p999>，单位微秒
+ */
+
+#define LATBENCH_PORT 9300
+
+namespace
+{
+    double percentile(vector<double>& samples, double p)
+    {
+        if (samples.empty()) return 0;
+        sort(samples.begin(), samples.end());
+        return samples[min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+    }
+
+    void run(bool latency, size_t count, size_t size, int client_cpu, int server_cpu)
+    {
+        vector<double> one_way;
+        vector<double> round_trip;
+        one_way.reserve(count);
+        round_trip.reserve(count);
+
+        RUDP_S server(LATBENCH_PORT);
+        if (latency && !server.set_latency_mode(true, server_cpu))
+            cerr << "Server: SO_BUSY_POLL or CPU pinning unavailable, spin only." << endl;
+        thread server_thread([&]() {
+            // 时间戳与对端同源(同进程的steady_clock)，直接相减即单向延迟
+            server.listen([&](RUDP_P& packet) {
+                int64_t sent_ns;
+                memcpy(&sent_ns, packet.body, sizeof(sent_ns));
+                int64_t now_ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+                one_way.push_back((now_ns - sent_ns) / 1000.0);
+            });
+        });
+
+        RUDP_C client(LATBENCH_PORT + 1, 1);
+        if (latency && !client.set_latency_mode(true, client_cpu))
+            cerr << "Client: SO_BUSY_POLL or CPU pinning unavailable, spin only." << endl;
+        if (!client.connect("127.0.0.1", LATBENCH_PORT))
+        {
+            cerr << "Failed to connect." << endl;
+            exit(1);
+        }
+
+        vector<char> message(size, 'x');
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto    start    = steady_clock::now();
+            int64_t start_ns = duration_cast<nanoseconds>(start.time_since_epoch()).count();
+            memcpy(message.data(), &start_ns, sizeof(start_ns));
+            client.send(message.data(), message.size());
+            client.flush();
+            round_trip.push_back(duration<double, micro>(steady_clock::now() - start).count());
+        }
+        client.disconnect();
+        server_thread.join();
+
+        cout << "LATBENCH," << (latency ? "latency" : "normal") << ',' << one_way.size() << ',' << size << fixed
+             << setprecision(1);
+        for (auto* samples : {&one_way, &round_trip})
+            for (double p : {0.5, 0.99, 0.999}) cout << ',' << percentile(*samples, p);
+        cout << endl;
+    }
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    string mode       = argc > 1 ? argv[1] : "both";
+    size_t count      = argc > 2 ? max(1, atoi(argv[2])) : 1000;
+    size_t size       = argc > 3 ? clamp<size_t>(atoi(argv[3]), sizeof(int64_t), BODY_SIZE) : 64;
+    int    client_cpu = argc > 4 ? atoi(argv[4]) : 0;
+    int    server_cpu = argc > 5 ? atoi(argv[5]) : (thread::hardware_concurrency() > 1 ? 1 : 0);
+
+    if (mode != "latency") run(false, count, size, client_cpu, server_cpu);
+    if (mode != "normal") run(true, count, size, client_cpu, server_cpu);
+}
@@ -18,8 +18,15 @@ static const int BUF_SIZE = 65536;
 
 static atomic<int>  g_delay_ms{10};  // 延迟时间(ms)
 static atomic<int>  g_loss_rate{3};  // 丢包率百分比(0-100)
+static atomic<int>  g_rate_mbps{0};  // 瓶颈带宽(Mbit/s)，0表示不限速
+static atomic<int>  g_queue_kb{0};   // 瓶颈队列容量(KB)，超出时尾部丢弃，0表示不限
+static atomic<int>  g_ecn_kb{0};     // 瓶颈队列超过该值(KB)时给ECT报文打CE标记，0表示不标记
 static atomic<bool> g_stop{false};   // 程序是否结束标志
 
+// IP头TOS字段低两位的ECN码点
+static const uint8_t ECN_MASK = 0x03;
+static const uint8_t ECN_CE   = 0x03;
+
 Logger logger("router.log");
 
 struct Packet
@@ -27,7 +34,8 @@ struct Packet
     vector<char>                     data;
     sockaddr_in                      dest;
     size_t                           size;
-    chrono::steady_clock::time_point enqueue_time;
+    uint8_t                          tos;
+    chrono::steady_clock::time_point enqueue_time;  // 离开瓶颈队列的时刻，不限速时即入队时刻
 };
 
 class PacketQueue
@@ -65,11 +73,70 @@ class PacketQueue
 static mt19937_64                    rng(random_device{}());
 static uniform_int_distribution<int> dist_0_100(0, 100);
 
-int main()
+// 收包时一并取出IP头的TOS字节，平台不支持IP_RECVTOS时视为0
+static int recvWithTos(SOCKET sock, char* buf, int len, sockaddr_in& src, uint8_t& tos)
+{
+    tos = 0;
+#ifdef IP_RECVTOS
+    iovec  iov{buf, static_cast<size_t>(len)};
+    char   ctrl[CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_name       = &src;
+    msg.msg_namelen    = sizeof(src);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    int ret = recvmsg(sock, &msg, 0);
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); ret > 0 && cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS) tos = *CMSG_DATA(cmsg);
+    return ret;
+#else
+    socklen_t srclen = sizeof(src);
+    return recvfrom(sock, buf, len, 0, (sockaddr*)&src, &srclen);
+#endif
+}
+
+// 按报文自己的TOS转发，保留发送方的ECT与途中打上的CE标记
+static int sendWithTos(SOCKET sock, const char* data, int len, const sockaddr_in& dest, uint8_t tos)
+{
+#ifdef IP_RECVTOS
+    iovec  iov{const_cast<char*>(data), static_cast<size_t>(len)};
+    char   ctrl[CMSG_SPACE(sizeof(int))]{};
+    msghdr msg{};
+    msg.msg_name       = const_cast<sockaddr_in*>(&dest);
+    msg.msg_namelen    = sizeof(dest);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    cmsghdr* cmsg    = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_IP;
+    cmsg->cmsg_type  = IP_TOS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+    int value        = tos;
+    memcpy(CMSG_DATA(cmsg), &value, sizeof(value));
+    return sendmsg(sock, &msg, 0);
+#else
+    return sendto(sock, data, len, 0, (const sockaddr*)&dest, sizeof(dest));
+#endif
+}
+
+// 用法: router [port] [delay_ms] [loss_rate] [rate_mbps] [queue_kb] [ecn_kb]
+// 多个实例监听不同端口即可模拟多条路径；rate_mbps非0时每个方向各有一个瓶颈队列，
+// 队列超过ecn_kb时给ECT报文打CE标记，超过queue_kb时尾部丢弃
+int main(int argc, char* argv[])
 {
     SocketInitializer::getInstance();
 
-    int router_port = 5000;
+    int router_port = argc > 1 ? atoi(argv[1]) : 5000;
+    if (argc > 2) g_delay_ms.store(atoi(argv[2]));
+    if (argc > 3) g_loss_rate.store(atoi(argv[3]));
+    if (argc > 4) g_rate_mbps.store(atoi(argv[4]));
+    if (argc > 5) g_queue_kb.store(atoi(argv[5]));
+    if (argc > 6) g_ecn_kb.store(atoi(argv[6]));
 
     const char* A_IP   = "127.0.0.1";
     int         A_PORT = 7777;
@@ -106,15 +173,28 @@ int main()
         CLOSE_SOCKET(sock);
         exit(EXIT_FAILURE);
     }
+#ifdef IP_RECVTOS
+    int opt = 1;
+    setsockopt(sock, IPPROTO_IP, IP_RECVTOS, (const char*)&opt, sizeof(opt));
+#endif
 
     LOG(logger, "Router started, listening on port ", router_port);
     LOG(logger, "Packets from A(", A_IP, ":", A_PORT, ") forward to B(", B_IP, ":", B_PORT, ")");
     LOG(logger, "Packets from B(", B_IP, ":", B_PORT, ") forward to A(", A_IP, ":", A_PORT, ")");
     LOG(logger, "Initial delay=", g_delay_ms.load(), "ms, loss_rate=", g_loss_rate.load(), "%");
-
-    PacketQueue pkt_queue;
-
-    auto send_thread_func = [&]() {
+    LOG(logger,
+        "Bottleneck rate=",
+        g_rate_mbps.load(),
+        "Mbps, queue=",
+        g_queue_kb.load(),
+        "KB, ecn=",
+        g_ecn_kb.load(),
+        "KB");
+
+    // 两个方向各一个队列，避免反向的ACK排在数据报文后面
+    PacketQueue pkt_queues[2];
+
+    auto send_thread_func = [&](PacketQueue& pkt_queue) {
         while (!g_stop.load())
         {
             Packet pkt;
@@ -133,7 +213,7 @@ int main()
                 if (rnd < loss) { LOG_WARN(logger, "Packet dropped, size=", pkt.size, ", loss_rate=", loss, "%"); }
                 else
                 {
-                    int sret = sendto(sock, pkt.data.data(), (int)pkt.size, 0, (sockaddr*)&pkt.dest, sizeof(pkt.dest));
+                    int sret = sendWithTos(sock, pkt.data.data(), (int)pkt.size, pkt.dest, pkt.tos);
                     if (sret < 0)
                     {
                         perror("sendto error");
@@ -153,12 +233,13 @@ int main()
     };
 
     auto receive_thread_func = [&]() {
-        char buf[BUF_SIZE];
+        char                             buf[BUF_SIZE];
+        chrono::steady_clock::time_point busy[2];  // 各方向瓶颈发完已排队数据的时刻
         while (!g_stop.load())
         {
             sockaddr_in src;
-            socklen_t   srclen = sizeof(src);
-            int         ret    = recvfrom(sock, buf, BUF_SIZE, 0, (sockaddr*)&src, &srclen);
+            uint8_t     tos;
+            int         ret = recvWithTos(sock, buf, BUF_SIZE, src, tos);
 
             if (g_stop.load()) break;
 
@@ -193,18 +274,44 @@ int main()
             pkt.data.assign(buf, buf + ret);
             pkt.size         = ret;
             pkt.dest         = dest;
+            pkt.tos          = tos;
             pkt.enqueue_time = chrono::steady_clock::now();
 
-            pkt_queue.push(std::move(pkt));
+            int dir  = fromA ? 0 : 1;
+            int rate = g_rate_mbps.load();
+            if (rate > 0)
+            {
+                // 排在前面尚未发完的字节数即为当前队列长度
+                auto   start   = max(busy[dir], pkt.enqueue_time);
+                double backlog = chrono::duration<double>(start - pkt.enqueue_time).count() * rate * 1000000 / 8;
+                size_t queue   = static_cast<size_t>(g_queue_kb.load()) * 1024;
+                size_t ecn     = static_cast<size_t>(g_ecn_kb.load()) * 1024;
+                if (queue && backlog + ret > queue)
+                {
+                    LOG_WARN(
+                        logger, "Queue overflow, packet dropped, size=", ret, ", backlog=", (size_t)backlog, " bytes");
+                    continue;
+                }
+                if (ecn && backlog > ecn && (tos & ECN_MASK))
+                {
+                    pkt.tos = tos | ECN_CE;
+                    LOG(logger, "Packet marked CE, size=", ret, ", backlog=", (size_t)backlog, " bytes");
+                }
+                busy[dir]        = start + chrono::nanoseconds(static_cast<int64_t>(ret) * 8000 / rate);
+                pkt.enqueue_time = busy[dir];
+            }
+
+            pkt_queues[dir].push(std::move(pkt));
             // LOG(logger, "Packet queued, size=", ret, ", will send after delay & loss check");
         }
 
         LOG(logger, "Receive thread exiting.");
     };
 
-    cout << "Control thread started. Commands: 'delay X', 'loss X', 'quit'" << endl;
+    cout << "Control thread started. Commands: 'delay X', 'loss X', 'rate X', 'queue X', 'ecn X', 'quit'" << endl;
 
-    thread send_thread(send_thread_func);
+    thread send_thread_ab(send_thread_func, ref(pkt_queues[0]));
+    thread send_thread_ba(send_thread_func, ref(pkt_queues[1]));
     thread receive_thread(receive_thread_func);
 
     while (true)
@@ -234,6 +341,16 @@ int main()
             }
             else { LOG_ERR(logger, "Invalid loss value, must be 0-100"); }
         }
+        else if (cmd == "rate" || cmd == "queue" || cmd == "ecn")
+        {
+            int v;
+            if (iss >> v && v >= 0)
+            {
+                (cmd == "rate" ? g_rate_mbps : cmd == "queue" ? g_queue_kb : g_ecn_kb).store(v);
+                LOG(logger, "Bottleneck ", cmd, " changed to ", v, cmd == "rate" ? "Mbps" : "KB");
+            }
+            else { LOG_ERR(logger, "Invalid ", cmd, " value, must be >= 0"); }
+        }
         else if (cmd == "quit")
         {
             LOG(logger, "Quit command received, stopping...");
@@ -243,7 +360,8 @@ int main()
         else { LOG_WARN(logger, "Unknown command: ", cmd); }
     }
 
-    send_thread.join();
+    send_thread_ab.join();
+    send_thread_ba.join();
     receive_thread.join();
 
     CLOSE_SOCKET(sock);
@@ -2,54 +2,29 @@
 #include <net/socket_defs.h>
 #include <net/rudp/rudp_defs.h>
 #include <net/rudp/rudp.h>
+#include <transfer/file_receiver.h>
 using namespace std;
 
-void receiveFile(RUDP_P& packet, ofstream& outFile, bool& receivingFile)
-{
-    string data(packet.body, packet.header.data_len);
-
-    if (data.find("File begin: ") == 0)
-    {
-        string fileName = data.substr(12, data.find("\r\n") - 12);
-        string filePath = "download/" + fileName;
-
-        outFile.open(filePath, ios::binary);
-        if (!outFile.is_open())
-        {
-            cerr << "Failed to open file: " << filePath << endl;
-            receivingFile = false;
-            return;
-        }
-
-        cout << "Receiving file: " << fileName << endl;
-        receivingFile = true;
-    }
-    else if (data == "File end\r\n")
-    {
-        if (outFile.is_open())
-        {
-            outFile.close();
-            cout << "File received successfully." << endl;
-        }
-        receivingFile = false;
-    }
-    else if (receivingFile)
-    {
-        if (outFile.is_open())
-            outFile.write(packet.body, packet.header.data_len);
-        else
-            cerr << "File output stream is not open." << endl;
-    }
-}
-
-int main()
+// server [ack_delay_ms] [socket|uring] [loop]，ack_delay_ms为0时逐包立即确认
+// 默认服务一个连接后退出；loop时连接关闭后回到LISTEN继续服务，客户端可用上次发放的令牌以0-RTT重连
+int main(int argc, char* argv[])
 {
     RUDP_S server(8888);
+    if (argc > 1) server.set_ack_delay(chrono::milliseconds(atoi(argv[1])));
+    if (argc > 2 && string(argv[2]) == "uring" && !server.set_io_backend(IoBackend::IO_URING))
+        cerr << "io_uring unavailable, fall back to socket I/O." << endl;
+    bool loop = argc > 3 && string(argv[3]) == "loop";
 
     cout << "Server run at port " << server.getBoundPort() << endl;
 
-    ofstream outFile;
-    bool     receivingFile = false;
-
-    server.listen([&](RUDP_P& packet) { receiveFile(packet, outFile, receivingFile); });
+    // 文件内容由FileReceiver的写入线程落盘，乱序到达的分片直接按偏移写入
+    FileReceiver receiver("download");
+    receiver.set_reply([&](uint16_t type, const char* data, size_t len) { server.reply(type, data, len); });
+    server.set_early_delivery([&](const PacketBuf& packet) { return receiver.on_early(packet); });
+    do
+    {
+        server.listen([&](const PacketBuf& packet) { receiver.on_packet(packet); });
+        // 等写入线程把本连接的分段全部落盘，此后文件内容完整
+        receiver.flush();
+    } while (loop);
 }
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include <bits/stdc++.h>
+#include <net/rudp/rudp.h>
+#include <net/rudp/rudp_endpoint.h>
+#include <net/rudp/rudp_sim.h>
+using namespace std;
+using namespace chrono;
+
+namespace
+{
+    constexpr uint64_t FNV_BASIS = 0xcbf29ce484222325ull;
+
+    uint64_t fnv(uint64_t hash, const char* data, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i) hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001b3ull;
+        return hash;
+    }
+
+    ArqMode arqMode(const string& arq)
+    {
+        return arq == "sw" ? ArqMode::STOP_AND_WAIT : arq == "sr" ? ArqMode::SELECTIVE_REPEAT : ArqMode::GO_BACK_N;
+    }
+
+    // seqExtend的边界用例：回绕点两侧、ref为0、差值恰为±2^31
+    bool runSeqCases()
+    {
+        struct Case
+        {
+            const char* name;
+            uint32_t    seq;
+            uint64_t    ref;
+            uint64_t    expected;
+        };
+        const uint64_t E    = SEQ_EPOCH;
+        const uint64_t HALF = 1ull << 31;
+        const Case     cases[] = {
+            {"below wrap, ref past it", 0xfffffff0u, 2 * E + 5, 2 * E - 16},
+            {"past wrap, ref below it", 16, 2 * E - 5, 2 * E + 16},
+            {"below wrap, ref below it", 0xfffffff0u, 2 * E - 5, 2 * E - 16},
+            {"past wrap, ref past it", 16, 2 * E + 5, 2 * E + 16},
+            {"ref=0, same", 0, 0, 0},
+            {"ref=0, ahead", 5, 0, 5},
+            {"ref=0, behind underflows", 0xffffffffu, 0, UINT64_MAX},
+            {"ref=epoch, behind", 0xffffffffu, E, E - 1},
+            {"ahead by 2^31-1", static_cast<uint32_t>(100 + HALF - 1), 2 * E + 100, 2 * E + 100 + HALF - 1},
+            {"behind by 2^31-1", static_cast<uint32_t>(100 - (HALF - 1)), 2 * E + 100, 2 * E + 100 - (HALF - 1)},
+            // 恰好相差2^31时两个方向无法区分，一律还原到ref之前
+            {"ahead by 2^31", static_cast<uint32_t>(100 + HALF), 2 * E + 100, 2 * E + 100 - HALF},
+            {"behind by 2^31", static_cast<uint32_t>(100 - HALF), 2 * E + 100, 2 * E + 100 - HALF},
+        };
+
+        bool ok = true;
+        for (auto& c : cases)
+        {
+            uint64_t got = seqExtend(c.seq, c.ref);
+            ok &= got == c.expected;
+            cout << c.name << ": seqExtend(" << c.seq << ", " << c.ref << ")=" << got
+                 << (got == c.expected ? " OK" : " MISMATCH") << endl;
+        }
+        cout << (ok ? "seq OK" : "seq MISMATCH") << endl;
+        return ok;
+    }
+
+    // 每条连接同时从同一端点发出同样的负载，各自发往一个服务端
+    void runEndpoint(SimNetwork& net, const SimLink& link, const vector<char>& payload, const string& arq,
+        uint32_t isn, const vector<double>& weights)
+    {
+        struct Flow
+        {
+            atomic<size_t> received{0};
+            uint64_t       digest = FNV_BASIS;
+            microseconds   completion{};
+            size_t         rank  = 0;  // 第几个发完
+            size_t         share = 0;  // 第一条连接发完时本连接已送达的字节数
+        };
+        size_t       count = weights.size();
+        vector<Flow> flows(count);
+        uint64_t     expected = fnv(FNV_BASIS, payload.data(), payload.size());
+
+        // 端点限速到瓶颈带宽以下，积压留在本端由加权公平排队按权重分配；链路不限速时端点也不限速
+        double rate = link.bandwidth / 8.0 * 0.9;
+
+        net.run([&]() {
+            RUDP_Endpoint endpoint(7777, &net);
+            endpoint.set_rate(rate);
+
+            vector<unique_ptr<RUDP_S>> servers;
+            vector<unique_ptr<RUDP_C>> clients;
+            for (size_t i = 0; i < count; ++i)
+            {
+                servers.emplace_back(new RUDP_S(8888 + i, &net));
+                clients.emplace_back(new RUDP_C(endpoint));
+                clients[i]->set_arq(arqMode(arq));
+                clients[i]->set_initial_seq(isn);
+                clients[i]->set_weight(weights[i]);
+            }
+
+            vector<thread> threads;
+            for (size_t i = 0; i < count; ++i)
+                threads.push_back(net.spawn([&, i]() {
+                    servers[i]->listen([&, i](RUDP_P& packet) {
+                        flows[i].received += packet.header.data_len;
+                        flows[i].digest = fnv(flows[i].digest, packet.body, packet.header.data_len);
+                    });
+                }));
+
+            mutex  mtx;
+            size_t finished = 0;
+            auto   start    = net.now();
+            for (size_t i = 0; i < count; ++i)
+                threads.push_back(net.spawn([&, i]() {
+                    if (!clients[i]->connect("127.0.0.1", 8888 + i))
+                    {
+                        cerr << "Failed to connect flow " << i << "." << endl;
+                        exit(1);
+                    }
+                    for (size_t off = 0; off < payload.size(); off += BODY_SIZE)
+                        clients[i]->send(payload.data() + off, min<size_t>(BODY_SIZE, payload.size() - off));
+                    clients[i]->flush();
+
+                    auto elapsed = duration_cast<microseconds>(net.now() - start);
+                    {
+                        lock_guard<mutex> lk(mtx);
+                        flows[i].completion = elapsed;
+                        flows[i].rank       = finished++;
+                        if (flows[i].rank == 0)
+                            for (auto& flow : flows) flow.share = flow.received;
+                    }
+                    clients[i]->disconnect();
+                }));
+            for (auto& t : threads) net.join(t);
+        });
+
+        size_t total = 0;
+        for (auto& flow : flows) total += flow.share;
+        bool ok = true;
+        for (size_t i = 0; i < count; ++i)
+        {
+            bool intact = flows[i].received == payload.size() && flows[i].digest == expected;
+            ok &= intact;
+            double share = round(1000.0 * flows[i].share / max<size_t>(1, total)) / 10;
+            cout << "flow=" << i << " weight=" << weights[i]
+                 << " completion_ms=" << flows[i].completion.count() / 1000.0 << " share=" << share
+                 << "% received=" << flows[i].received << " digest=" << hex << flows[i].digest << dec
+                 << (intact ? " OK" : " MISMATCH") << endl;
+        }
+
+        // 限速时权重大的连接应先发完，权重相同的不比较
+        bool ordered = true;
+        for (size_t i = 0; i < count; ++i)
+            for (size_t j = 0; j < count; ++j)
+                if (weights[i] > weights[j] && flows[i].rank > flows[j].rank) ordered = false;
+        cout << "order=";
+        for (size_t rank = 0; rank < count; ++rank)
+            for (size_t i = 0; i < count; ++i)
+                if (flows[i].rank == rank) cout << (rank ? "," : "") << i;
+        cout << (rate == 0 ? " unpaced" : ordered ? " by weight" : " NOT by weight") << endl;
+        cout << (ok && (rate == 0 || ordered) ? "endpoint OK" : "endpoint MISMATCH") << endl;
+    }
+}  // namespace
+
+/*
+ *  在确定性模拟链路上跑一次完整的传输(握手、发送、断开)，时间全部是虚拟的
+ *  用法: sim [loss%] [delay_ms] [bandwidth_mbps] [queue_kb] [size_kb] [seed] [sw|gbn|sr] [isn] [ecn_kb]
+ *  bandwidth_mbps与queue_kb为0表示不限；相同参数与种子的输出逐位一致
+ *  isn为客户端初始序号，如取4294967270可让传输中途跨过32位序号回绕
+ *  ecn_kb非0时瓶颈队列超过该值即给报文打CE标记，与只靠溢出丢包的情形对比排队时延与丢包
+ *  位置参数之后可跟场景：
+ *    seq                   不跑传输，只检查seqExtend在回绕点附近的边界用例
+ *    resume                断开后以session()导出的会话重连，再传一遍同样的负载，验证0-RTT恢复
+ *    endpoint [n] [w1,w2]  n条连接(默认2)经同一RUDP_Endpoint并发传输，权重缺省为1；链路限速时
+ *                          端点限速到其九成，检查各连接的摘要以及权重大者先完成
+ */
+int main(int argc, char* argv[])
+{
+    // 场景关键字之前的都是位置参数
+    int argn = 1;
+    set<string> scenarios = {"seq", "resume", "endpoint"};
+    while (argn < argc && !scenarios.count(argv[argn])) ++argn;
+    string         scenario = argn < argc ? argv[argn] : "";
+    vector<double> weights(argn + 1 < argc ? max(1, atoi(argv[argn + 1])) : 2, 1.0);
+    if (argn + 2 < argc)
+    {
+        istringstream list(argv[argn + 2]);
+        string        weight;
+        for (size_t i = 0; i < weights.size() && getline(list, weight, ','); ++i) weights[i] = atof(weight.c_str());
+    }
+    argc = argn;
+    if (scenario == "seq") return runSeqCases() ? 0 : 1;
+
+    double   loss      = argc > 1 ? atof(argv[1]) : 0;
+    int      delay_ms  = argc > 2 ? atoi(argv[2]) : 5;
+    double   bandwidth = argc > 3 ? atof(argv[3]) : 0;
+    size_t   queue_kb  = argc > 4 ? atoi(argv[4]) : 0;
+    size_t   size_kb   = argc > 5 ? atoi(argv[5]) : 4096;
+    uint64_t seed      = argc > 6 ? strtoull(argv[6], nullptr, 10) : 1;
+    string   arq       = argc > 7 ? argv[7] : "gbn";
+    uint32_t isn       = argc > 8 ? static_cast<uint32_t>(strtoul(argv[8], nullptr, 10)) : 0;
+    size_t   ecn_kb    = argc > 9 ? atoi(argv[9]) : 0;
+
+    SimLink link;
+    link.delay     = milliseconds(delay_ms);
+    link.loss      = loss / 100;
+    link.bandwidth = static_cast<uint64_t>(bandwidth * 1000000);
+    link.queue     = queue_kb * 1024;
+    link.ecn       = ecn_kb * 1024;
+
+    SimNetwork net(seed);
+    net.set_link(link);
+
+    // 负载内容也由种子决定，接收端按FNV-1a累计摘要用于校验
+    vector<char> payload(size_kb * 1024);
+    mt19937_64   gen(seed);
+    for (auto& byte : payload) byte = static_cast<char>(gen());
+
+    uint64_t expected = fnv(FNV_BASIS, payload.data(), payload.size());
+
+    auto wall_start = steady_clock::now();
+    if (scenario == "endpoint")
+    {
+        runEndpoint(net, link, payload, arq, isn, weights);
+        cout << "wall_ms=" << duration_cast<milliseconds>(steady_clock::now() - wall_start).count() << endl;
+        return 0;
+    }
+    net.run([&]() {
+        RUDP_S server(8888, &net);
+
+        // 服务端每轮重新listen，各轮的接收结果在join后统一输出
+        int                            rounds = scenario == "resume" ? 2 : 1;
+        vector<pair<size_t, uint64_t>> delivered(rounds);  // 各轮收到的字节数与摘要
+        vector<microseconds>           handshake(rounds);
+        vector<microseconds>           elapsed(rounds);
+        vector<RUDP_Stats>             stats(rounds);
+        thread                         server_thread = net.spawn([&]() {
+            for (auto& result : delivered)
+            {
+                result = {0, FNV_BASIS};
+                server.listen([&](RUDP_P& packet) {
+                    result.first += packet.header.data_len;
+                    result.second = fnv(result.second, packet.body, packet.header.data_len);
+                });
+            }
+        });
+
+        // 每轮一个新的客户端，重连时只带上一轮导出的会话
+        RUDP_Session session;
+        for (int round = 0; round < rounds; ++round)
+        {
+            RUDP_C client(7777, 20, &net);
+            client.set_arq(arqMode(arq));
+            client.set_initial_seq(isn);
+            if (round > 0) client.resume(session);
+
+            auto start = net.now();
+            if (!client.connect("127.0.0.1", 8888))
+            {
+                cerr << "Failed to connect." << endl;
+                exit(1);
+            }
+            handshake[round] = duration_cast<microseconds>(net.now() - start);
+
+            start = net.now();
+            for (size_t off = 0; off < payload.size(); off += BODY_SIZE)
+                client.send(payload.data() + off, min<size_t>(BODY_SIZE, payload.size() - off));
+            client.flush();
+            elapsed[round] = duration_cast<microseconds>(net.now() - start);
+
+            stats[round] = client.stats();
+            client.disconnect();
+            session = client.session();
+        }
+        net.join(server_thread);
+
+        SimStats sim = net.stats();
+        for (int round = 0; round < rounds; ++round)
+        {
+            // 0-RTT连接在发出SYN后立即返回，不等一个往返
+            if (round > 0)
+                cout << "resumed handshake_ms=" << handshake[round].count() / 1000.0
+                     << (handshake[round] < link.delay ? " 0-RTT" : " 1-RTT") << endl;
+            cout << "completion_ms=" << elapsed[round].count() / 1000.0 << endl;
+            cout << "goodput_mbps=" << payload.size() * 8.0 / max<int64_t>(1, elapsed[round].count()) << endl;
+            cout << "packets_sent=" << stats[round].packets_sent
+                 << " timeout_retransmits=" << stats[round].timeout_retransmits
+                 << " fast_retransmits=" << stats[round].fast_retransmits
+                 << " tail_probes=" << stats[round].tail_probes << " spurious=" << stats[round].spurious_retransmits
+                 << " undos=" << stats[round].cwnd_undos << " ecn_reductions=" << stats[round].ecn_reductions
+                 << " srtt_ms=" << stats[round].srtt_ms << endl;
+            if (round == rounds - 1)
+                cout << "link delivered=" << sim.delivered << " lost=" << sim.lost << " overflow=" << sim.overflow
+                     << " ce_marked=" << sim.ce_marked << " max_queue_kb=" << sim.max_queue / 1024
+                     << " events=" << sim.events << endl;
+            auto [received, digest] = delivered[round];
+            cout << "received=" << received << " digest=" << hex << digest << dec
+                 << (received == payload.size() && digest == expected ? " OK" : " MISMATCH") << endl;
+        }
+    });
+
+    cout << "wall_ms=" << duration_cast<milliseconds>(steady_clock::now() - wall_start).count() << endl;
+}
@@ -1,13 +1,25 @@
 #include <net/rudp/rudp.h>
+#include <net/rudp/rudp_endpoint.h>
 #include <common/lock.h>
 #include <random>
 #include <iostream>
 #include <thread>
 #include <cassert>
 #include <iomanip>
+#include <cstring>
 #include <common/log.h>
+#include <fstream>
+#ifdef __linux__
+#include <sched.h>
+#endif
 using namespace std;
 
+#ifdef MSG_DONTWAIT
+#define RECV_NOWAIT MSG_DONTWAIT
+#else
+#define RECV_NOWAIT 0  // 没有按次非阻塞标志的平台上延迟模式退化为阻塞收包
+#endif
+
 using ms     = chrono::milliseconds;
 ms check_gap = ms(CHECK_GAP);
 
@@ -18,8 +30,10 @@ void printRUDP(RUDP_P& p)
     cout << "body: " << p.body << endl;
 }
 
-RUDP::RUDP(int local_port)
-    : _statu(RUDP_STATUS::CLOSED),
+RUDP::RUDP(int local_port, RUDP_Env* env, RUDP_Endpoint* endpoint)
+    : _env(env ? env : &RUDP_Env::system()),
+      _endpoint(endpoint),
+      _statu(RUDP_STATUS::CLOSED),
       _port(local_port),
       _sockfd(INVALID_SOCKET),
       _connect_id(0),
@@ -30,9 +44,40 @@ RUDP::RUDP(int local_port)
       _alpha(0.125),
       _beta(0.25),
       _rto(std::chrono::milliseconds(GUESS_RTT + 4 * (GUESS_RTT/2))), // 初始化RTO
+      _sock_buf(0),
+      _delivery_rate(0),
+      _kernel_drops(0),
+      _reported_drops(0),
+      _shm_mode(false),
+      _stats_dumping(false),
+      _trace(*_env),
+      _latency_mode(false),
+      _latency_cpu(-1),
+      _ecn(true),
       _receiving(false),
       _wakeup(false)
 {
+    memset(&_local_addr, 0, sizeof(_local_addr));
+    _local_addr.sin_family      = AF_INET;
+    _local_addr.sin_addr.s_addr = INADDR_ANY;
+    _local_addr.sin_port        = htons(_port);
+    _publish_rtt(_rtt, _dev_rtt);
+
+    if (_endpoint)
+    {
+        // 收发都经由端点，端口与环境取自端点
+        _sock_buf = DEFAULT_SOCK_BUF;
+        return;
+    }
+
+    if (_env->simulated())
+    {
+        // 模拟环境中端口即地址，由环境负责收发
+        _env->bind(_port);
+        _sock_buf = DEFAULT_SOCK_BUF;
+        return;
+    }
+
     _sockfd = socket(AF_INET, SOCK_DGRAM, 0);
 
     if (_sockfd == INVALID_SOCKET)
@@ -49,10 +94,12 @@ RUDP::RUDP(int local_port)
         exit(EXIT_FAILURE);
     }
 
-    memset(&_local_addr, 0, sizeof(_local_addr));
-    _local_addr.sin_family      = AF_INET;
-    _local_addr.sin_addr.s_addr = INADDR_ANY;
-    _local_addr.sin_port        = htons(_port);
+    _set_sock_buf(DEFAULT_SOCK_BUF);
+    set_ecn(_ecn);
+#ifdef SO_RXQ_OVFL
+    // 让内核在每个数据报上附带接收队列溢出计数
+    setsockopt(_sockfd, SOL_SOCKET, SO_RXQ_OVFL, (const char*)&opt, sizeof(opt));
+#endif
 
     if (::bind(_sockfd, (const struct sockaddr*)&_local_addr, sizeof(_local_addr)) == SOCKET_ERROR)
     {
@@ -61,6 +108,385 @@ RUDP::RUDP(int local_port)
         exit(EXIT_FAILURE);
     }
 }
-RUDP::~RUDP() {}
+RUDP::~RUDP()
+{
+    if (_env->simulated() && !_endpoint) _env->unbind(_port);
+}
+
+int RUDP::getBoundPort() const { return _port; }
+
+bool RUDP::localFastpath() const { return _shm_mode; }
+
+uint32_t RUDP::kernelDrops() const { return _kernel_drops; }
+
+bool RUDP::_set_sock_buf(size_t bytes)
+{
+    if (_env->simulated() || _endpoint)
+    {
+        _sock_buf = bytes;
+        return true;
+    }
+
+    int  size = static_cast<int>(bytes);
+    bool ok   = true;
+#ifdef SO_RCVBUFFORCE
+    // 有CAP_NET_ADMIN时可突破rmem_max/wmem_max限制，否则退回普通选项
+    if (setsockopt(_sockfd, SOL_SOCKET, SO_RCVBUFFORCE, (const char*)&size, sizeof(size)) < 0)
+#endif
+        ok &= setsockopt(_sockfd, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size)) == 0;
+#ifdef SO_SNDBUFFORCE
+    if (setsockopt(_sockfd, SOL_SOCKET, SO_SNDBUFFORCE, (const char*)&size, sizeof(size)) < 0)
+#endif
+        ok &= setsockopt(_sockfd, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size)) == 0;
+
+    _sock_buf = bytes;
+    return ok;
+}
+
+void RUDP::_autotune_sock_buf(ms rtt, double delivery_rate)
+{
+    _delivery_rate = delivery_rate;
+    RUDP_Counters::set(_counters.delivery_rate, delivery_rate);
+
+    // BDP = RTT × 交付速率，预留两倍余量吸收突发；只增不减
+    double bdp    = delivery_rate * rtt.count() / 1000.0;
+    size_t target = min(static_cast<size_t>(MAX_SOCK_BUF), static_cast<size_t>(2 * bdp));
+    if (target <= _sock_buf) return;
+
+    _set_sock_buf(target);
+}
+
+void RUDP::_publish_rtt(ms srtt, ms rttvar)
+{
+    RUDP_Counters::set(_counters.srtt_ms, static_cast<uint32_t>(srtt.count()));
+    RUDP_Counters::set(_counters.rttvar_ms, static_cast<uint32_t>(rttvar.count()));
+    RUDP_Counters::set(_counters.rto_ms, static_cast<uint32_t>(_rto.count()));
+}
+
+int RUDP::_recv_packet(RUDP_P& packet, sockaddr_in* from, bool* ce)
+{
+    return _recv_into([&](size_t&) -> void* { return &packet; }, false, from, ce);
+}
+
+PacketBuf RUDP::_recv_buffer(sockaddr_in* from, bool* ce)
+{
+    PacketBuf buf;
+    // 多留一个字节，交付时可在负载后补'\0'(如printRUDP)
+    int ret = _recv_into(
+        [&](size_t& len) -> void* {
+            buf = PacketBuf::alloc(max(len + 1, sizeof(RUDP_H)));
+            return buf.get();
+        },
+        true, from, ce);
+    // 唤醒用的短报文与声明长度超出实际数据的报文不交给上层，之后按data_len访问body不会越界
+    if (ret < static_cast<int>(sizeof(RUDP_H)) || lenInByte(*buf) > static_cast<size_t>(ret)) return PacketBuf();
+    return buf;
+}
+
+int RUDP::_recv_into(const function<void*(size_t&)>& place, bool sized, sockaddr_in* from, bool* ce)
+{
+    sockaddr_in tmp_addr;
+    bool        tmp_ce;
+    if (!from) from = &tmp_addr;
+    if (!ce) ce = &tmp_ce;
+    *ce = false;
+
+    // 端点的收包线程已计数，这里只取出分给本连接的报文
+    if (_endpoint) return _endpoint->_take(this, place, sized, from, ce);
+
+    if (_env->simulated())
+    {
+        uint8_t tos = 0;
+        int     len = sized ? _env->peek_size(_port) : static_cast<int>(sizeof(RUDP_P));
+        if (len < 0) return -1;
+        size_t n   = static_cast<size_t>(len);
+        void*  dst = place(n);
+        int    ret = _env->recv_from(_port, dst, n, from, &tos);
+        *ce        = (tos & ECN_MASK) == ECN_CE;
+        if (ret >= static_cast<int>(sizeof(RUDP_H)))
+        {
+            RUDP_Counters::add(_counters.packets_received);
+            RUDP_Counters::add(_counters.bytes_received, ret);
+        }
+        return ret;
+    }
+
+    if (_uring.valid())
+    {
+        uint32_t drops = _kernel_drops;
+        uint8_t  tos   = 0;
+        int      ret   = _uring.recv(place, from, drops, &tos);
+        _kernel_drops  = drops;
+        *ce            = (tos & ECN_MASK) == ECN_CE;
+        if (ret >= static_cast<int>(sizeof(RUDP_H)))
+        {
+            RUDP_Counters::add(_counters.packets_received);
+            RUDP_Counters::add(_counters.bytes_received, ret);
+        }
+        return ret;
+    }
+
+    // 延迟模式下不进入睡眠，队列为空时让出CPU后立即重试
+    int    flags = _latency_mode ? RECV_NOWAIT : 0;
+    int    ret;
+    size_t len = sizeof(RUDP_P);
+#ifdef MSG_TRUNC
+    // 先窥视数据报长度再按长度分配，数据报仍留在队列中
+    if (sized)
+    {
+        while ((ret = recv(_sockfd, nullptr, 0, MSG_PEEK | MSG_TRUNC | flags)) < 0 && flags &&
+               (errno == EAGAIN || errno == EWOULDBLOCK))
+            this_thread::yield();
+        if (ret < 0) return ret;
+        len = min(static_cast<size_t>(ret), sizeof(RUDP_P));
+    }
+#endif
+    void* dst = place(len);
+
+#ifdef SO_RXQ_OVFL
+    iovec  iov{dst, len};
+    char   ctrl[CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_name       = from;
+    msg.msg_namelen    = sizeof(sockaddr_in);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    while ((ret = recvmsg(_sockfd, &msg, flags)) < 0 && flags && (errno == EAGAIN || errno == EWOULDBLOCK))
+        this_thread::yield();
+    if (ret < 0) return ret;
+    if (ret >= static_cast<int>(sizeof(RUDP_H)))
+    {
+        RUDP_Counters::add(_counters.packets_received);
+        RUDP_Counters::add(_counters.bytes_received, ret);
+    }
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+            uint32_t drops;
+            memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+            _kernel_drops = drops;
+        }
+        // IP_RECVTOS附带的TOS只有一个字节
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS)
+            *ce = (*CMSG_DATA(cmsg) & ECN_MASK) == ECN_CE;
+    }
+    return ret;
+#else
+    socklen_t addr_len = sizeof(sockaddr_in);
+    char*     data     = static_cast<char*>(dst);
+    while ((ret = recvfrom(_sockfd, data, static_cast<int>(len), flags, (struct sockaddr*)from, &addr_len)) < 0 &&
+           flags && (errno == EAGAIN || errno == EWOULDBLOCK))
+        this_thread::yield();
+    if (ret >= static_cast<int>(sizeof(RUDP_H)))
+    {
+        RUDP_Counters::add(_counters.packets_received);
+        RUDP_Counters::add(_counters.bytes_received, ret);
+    }
+    return ret;
+#endif
+}
+
+int RUDP::_send_to(const RUDP_P& packet, const sockaddr_in& to, bool more)
+{
+    if (_endpoint)
+    {
+        PacketBuf buf = PacketBuf::alloc(lenInByte(packet));
+        memcpy(buf.get(), &packet, lenInByte(packet));
+        return _send_to(buf, to, more);
+    }
+
+    int ret;
+    if (_env->simulated())
+        ret = _env->send_to(_port, &packet, lenInByte(packet), to, _ecn ? ECN_ECT0 : 0);
+    else if (_uring.valid())
+        ret = _uring.send(&packet, lenInByte(packet), to, more);
+    else
+        ret = sendto(
+            _sockfd, (const char*)&packet, lenInByte(packet), 0, (const struct sockaddr*)&to, sizeof(sockaddr_in));
+    _count_sent(packet, ret);
+    return ret;
+}
+
+int RUDP::_send_to(const PacketBuf& packet, const sockaddr_in& to, bool more)
+{
+    if (!_endpoint) return _send_to(*packet, to, more);
+
+    // 交给端点排队即视为发出，实际上线时刻由端点的调度决定
+    _endpoint->_submit(this, packet, to);
+    int ret = static_cast<int>(lenInByte(*packet));
+    _count_sent(*packet, ret);
+    return ret;
+}
+
+void RUDP::_count_sent(const RUDP_P& packet, int ret)
+{
+    if (ret > 0)
+    {
+        RUDP_Counters::add(_counters.packets_sent);
+        RUDP_Counters::add(_counters.bytes_sent, ret);
+        _trace.record(TraceEvent::PACKET_SENT,
+            packet.header.seq_num,
+            0,
+            0,
+            static_cast<uint8_t>(packet.header.flags),
+            static_cast<uint16_t>(packet.header.data_len));
+    }
+}
+
+void RUDP::_flush_sends()
+{
+    if (_uring.valid()) _uring.flush();
+}
+
+bool RUDP::set_io_backend(IoBackend backend)
+{
+    if (backend == IoBackend::SYSCALL)
+    {
+        _uring.close();
+        return true;
+    }
+    return !_env->simulated() && _uring.open(_sockfd);
+}
+
+IoBackend RUDP::io_backend() const { return _uring.valid() ? IoBackend::IO_URING : IoBackend::SYSCALL; }
+
+bool RUDP::set_latency_mode(bool enabled, int cpu)
+{
+    _latency_mode = enabled;
+    _latency_cpu  = enabled ? cpu : -1;
+    if (_env->simulated()) return !enabled;  // 虚拟时钟下不能自旋，只保留立即确认与直接处理
+
+    bool ok = true;
+#ifdef SO_BUSY_POLL
+    // 超过net.core.busy_read需要CAP_NET_ADMIN，失败时只靠用户态自旋
+    int usec = enabled ? BUSY_POLL_US : 0;
+    ok &= setsockopt(_sockfd, SOL_SOCKET, SO_BUSY_POLL, (const char*)&usec, sizeof(usec)) == 0;
+#else
+    ok &= !enabled;
+#endif
+#ifdef __linux__
+    ok &= cpu < static_cast<int>(thread::hardware_concurrency());
+#else
+    ok &= cpu < 0;
+#endif
+    return ok;
+}
+
+bool RUDP::set_ecn(bool enabled)
+{
+    _ecn = enabled;
+    if (_env->simulated()) return true;
+
+#ifdef IP_RECVTOS
+    // 接收侧始终读取TOS：对端发出的ECT报文被标记后需要回显，与本端是否发出ECT无关
+    int tos = enabled ? ECN_ECT0 : 0;
+    int on  = 1;
+    return setsockopt(_sockfd, IPPROTO_IP, IP_TOS, (const char*)&tos, sizeof(tos)) == 0 &&
+           setsockopt(_sockfd, IPPROTO_IP, IP_RECVTOS, (const char*)&on, sizeof(on)) == 0;
+#else
+    return !enabled;
+#endif
+}
+
+void RUDP::_pin_to_core()
+{
+    if (!_latency_mode || _latency_cpu < 0 || _env->simulated()) return;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(_latency_cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+void RUDP::_idle_wait()
+{
+    if (_latency_mode && !_env->simulated())
+        this_thread::yield();
+    else
+        _env->sleep_for(check_gap);
+}
+
+void RUDP::_send_to_self(const char* data, int len)
+{
+    if (_endpoint)
+    {
+        // 等端点的线程退出对本连接的回调，再唤醒阻塞在取包上的线程
+        _endpoint->_quiesce();
+        _endpoint->_wake(this);
+        return;
+    }
+
+    sockaddr_in loopback_addr;
+    memset(&loopback_addr, 0, sizeof(loopback_addr));
+    loopback_addr.sin_family      = AF_INET;
+    loopback_addr.sin_port        = htons(_port);
+    loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    if (_env->simulated())
+        _env->send_to(_port, data, len, loopback_addr);
+    else
+        sendto(_sockfd, data, len, 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
+}
 
-int RUDP::getBoundPort() const { return _port; }
\ No newline at end of file
+RUDP_Stats RUDP::stats() const
+{
+    RUDP_Stats stats{};
+    _counters.fill(stats);
+    stats.kernel_drops = _kernel_drops;
+    return stats;
+}
+
+void RUDP::start_stats_dump(const string& path, ms interval, StatsFormat format)
+{
+    stop_stats_dump();
+
+    _stats_dumping = true;
+    _stats_thread  = _env->spawn([this, path, interval, format]() {
+        ofstream out(path, ios::app);
+        if (!out.is_open())
+        {
+            cerr << "Failed to open stats file: " << path << endl;
+            return;
+        }
+        if (format == StatsFormat::CSV && out.tellp() == 0) out << "time_ms," << RUDP_Stats::csvHeader() << endl;
+
+        auto next = _env->now();
+        while (_stats_dumping)
+        {
+            // 按check_gap小步睡眠，保证stop能及时返回
+            _env->sleep_for(check_gap);
+            if (_env->now() < next) continue;
+            next += interval;
+
+            auto time_ms = chrono::duration_cast<ms>(chrono::system_clock::now().time_since_epoch()).count();
+            if (format == StatsFormat::JSON)
+                out << "{\"time_ms\":" << time_ms << ",\"stats\":" << stats().toJson() << "}" << endl;
+            else
+                out << time_ms << ',' << stats().toCsv() << endl;
+        }
+    });
+}
+
+void RUDP::stop_stats_dump()
+{
+    _stats_dumping = false;
+    if (_stats_thread.joinable()) _env->join(_stats_thread);
+}
+
+void RUDP::enable_trace(bool enabled) { _trace.enable(enabled); }
+
+bool RUDP::dump_trace(const string& path) const { return _trace.dump(path); }
+
+uint32_t RUDP::_take_kernel_drops()
+{
+    uint32_t drops  = _kernel_drops;
+    uint32_t fresh  = drops - _reported_drops;
+    _reported_drops = drops;
+    return fresh;
+}
\ No newline at end of file
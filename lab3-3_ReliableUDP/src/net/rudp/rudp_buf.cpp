@@ -0,0 +1,125 @@
+#include <net/rudp/rudp_buf.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+using namespace std;
+
+// 缓冲区头部紧挨着报文数据，slab按块大小连续切分
+struct PacketBuf::Block
+{
+    atomic<uint32_t> refs;
+    uint32_t         cls;
+    Block*           next;  // 空闲时串成链表
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+PacketBuf::PacketBuf(const PacketBuf& other) : _block(other._block)
+{
+    if (_block) _block->refs.fetch_add(1, memory_order_relaxed);
+}
+
+PacketBuf::PacketBuf(PacketBuf&& other) noexcept : _block(other._block) { other._block = nullptr; }
+
+PacketBuf& PacketBuf::operator=(const PacketBuf& other)
+{
+    if (other._block) other._block->refs.fetch_add(1, memory_order_relaxed);
+    _release();
+    _block = other._block;
+    return *this;
+}
+
+PacketBuf& PacketBuf::operator=(PacketBuf&& other) noexcept
+{
+    if (this != &other)
+    {
+        _release();
+        _block       = other._block;
+        other._block = nullptr;
+    }
+    return *this;
+}
+
+PacketBuf::~PacketBuf() { _release(); }
+
+PacketBuf PacketBuf::alloc(size_t bytes) { return PacketPool::instance().alloc(bytes); }
+
+RUDP_P* PacketBuf::get() const { return _block ? reinterpret_cast<RUDP_P*>(_block->data()) : nullptr; }
+
+size_t PacketBuf::capacity() const { return _block ? PacketPool::_class_capacity(_block->cls) : 0; }
+
+void PacketBuf::_release()
+{
+    if (_block && _block->refs.fetch_sub(1, memory_order_acq_rel) == 1) PacketPool::instance()._recycle(_block);
+    _block = nullptr;
+}
+
+PacketPool::PacketPool() : _reserved(0), _in_use(0) { fill(begin(_free), end(_free), nullptr); }
+
+// 进程退出时仍可能有静态对象持有句柄，池本身不析构
+PacketPool& PacketPool::instance()
+{
+    static PacketPool* pool = new PacketPool();
+    return *pool;
+}
+
+size_t PacketPool::_class_capacity(size_t cls)
+{
+    return cls + 1 < PKT_CLASSES ? static_cast<size_t>(PKT_MIN_CLASS) << cls : sizeof(RUDP_P);
+}
+
+void PacketPool::_grow(size_t cls)
+{
+    size_t align      = alignof(max_align_t);
+    size_t block_size = (sizeof(PacketBuf::Block) + _class_capacity(cls) + align - 1) / align * align;
+    size_t count      = max<size_t>(1, PKT_SLAB_SIZE / block_size);
+    char*  slab       = static_cast<char*>(::operator new(count * block_size));
+    _slabs.push_back(slab);
+    _reserved += count * block_size;
+
+    for (size_t i = count; i-- > 0;)
+    {
+        PacketBuf::Block* block = new (slab + i * block_size) PacketBuf::Block();
+        block->cls   = static_cast<uint32_t>(cls);
+        block->next  = _free[cls];
+        _free[cls]   = block;
+    }
+}
+
+void PacketPool::_recycle(PacketBuf::Block* block)
+{
+    lock_guard<mutex> lock(_mtx);
+    block->next       = _free[block->cls];
+    _free[block->cls] = block;
+    --_in_use;
+}
+
+PacketBuf PacketPool::alloc(size_t bytes)
+{
+    size_t cls = 0;
+    while (cls + 1 < PKT_CLASSES && _class_capacity(cls) < bytes) ++cls;
+
+    PacketBuf::Block* block;
+    {
+        lock_guard<mutex> lock(_mtx);
+        if (!_free[cls]) _grow(cls);
+        block      = _free[cls];
+        _free[cls] = block->next;
+        ++_in_use;
+    }
+    block->refs.store(1, memory_order_relaxed);
+    new (block->data()) RUDP_H();
+    return PacketBuf(block);
+}
+
+size_t PacketPool::reserved() const
+{
+    lock_guard<mutex> lock(_mtx);
+    return _reserved;
+}
+
+size_t PacketPool::in_use() const
+{
+    lock_guard<mutex> lock(_mtx);
+    return _in_use;
+}
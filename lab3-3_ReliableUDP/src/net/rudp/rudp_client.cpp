@@ -1,23 +1,19 @@
 #include <net/rudp/rudp.h>
+#include <net/rudp/rudp_endpoint.h>
 #include <common/lock.h>
 #include <random>
 #include <iostream>
 #include <thread>
 #include <cassert>
 #include <iomanip>
+#include <cstring>
 #include <common/log.h>
 using namespace std;
 
-#define SEND(rudp_packet)                                                                             \
-    {                                                                                                 \
-        sendto(_sockfd,                                                                               \
-            (const char*)&rudp_packet,                                                                \
-            lenInByte(rudp_packet),                                                                   \
-            0,                                                                                        \
-            (const struct sockaddr*)&_remote_addr,                                                    \
-            sizeof(sockaddr_in));                                                                     \
-        _send_buffer[rudp_packet.header.seq_num] = {                                                  \
-            rudp_packet, chrono::time_point_cast<chrono::milliseconds>(chrono::steady_clock::now())}; \
+#define SEND(seq, rudp_packet)                                                       \
+    {                                                                                \
+        _send_to(rudp_packet, _remote_addr);                                         \
+        _send_buffer[seq] = {rudp_packet, chrono::time_point_cast<ms>(_env->now())}; \
     }
 
 using ms = chrono::milliseconds;
@@ -35,13 +31,48 @@ namespace
 #define CLOG_WARN(...) LOG_WARN(client_log, __VA_ARGS__)
 #define CLOG_ERR(...) LOG_ERR(client_log, __VA_ARGS__)
 
-RUDP_C::RUDP_C(int port, size_t /*w_s*/)
-    : RUDP(port), _cwnd(1.0), _ssthresh(64.0), _fast_recovery(false), _ca_running(false), _base(0), _resending(false)
+RUDP_C::RUDP_C(int port, size_t w_s, RUDP_Env* env) : RUDP_C(port, w_s, env, nullptr) {}
+
+RUDP_C::RUDP_C(RUDP_Endpoint& endpoint, size_t w_s) : RUDP_C(endpoint.port(), w_s, endpoint.env(), &endpoint)
+{
+    endpoint._attach(this);
+}
+
+RUDP_C::RUDP_C(int port, size_t w_s, RUDP_Env* env, RUDP_Endpoint* endpoint)
+    : RUDP(port, env, endpoint),
+      _cwnd(1.0),
+      _ssthresh(64.0),
+      _max_cwnd(MAX_CWND),
+      _fast_recovery(false),
+      _cc(CongestionControl::RENO),
+      _arq(ArqMode::GO_BACK_N),
+      _fixed_window(static_cast<uint32_t>(max<size_t>(1, w_s))),
+      _ca_running(false),
+      _ca_active(false),
+      _base(0),
+      _isn(0),
+      _resending(false),
+      _shm_enabled(false),
+      _compress_enabled(false),
+      _compress(false),
+      _compress_skip(0),
+      _compress_backoff(0),
+      _tx_counter(0),
+      _zero_rtt(false),
+      _last_ack_time{},
+      _tlp_pending(false),
+      _dup_ack_seen(false),
+      _ecn_recover(0),
+      _peer_ack(0),
+      _skip_to(0)
 {}
 
 RUDP_C::~RUDP_C()
 {
+    stop_stats_dump();
+    _uring.close();
     if (_sockfd != INVALID_SOCKET) CLOSE_SOCKET(_sockfd);
+    if (_endpoint) _endpoint->_detach(this);
 }
 
 void RUDP_C::clear_statu()
@@ -57,26 +88,33 @@ void RUDP_C::clear_statu()
     if (_resending)
     {
         _resending = false;
-        _resend_thread.join();
+        if (_resend_thread.joinable()) _env->join(_resend_thread);
+        if (_endpoint) _endpoint->_quiesce();
     }
     if (_receiving)
     {
         _receiving = false;
-
-        sockaddr_in loopback_addr;
-        ZeroMemory(&loopback_addr, sizeof(loopback_addr));
-        loopback_addr.sin_family      = AF_INET;
-        loopback_addr.sin_port        = htons(_port);
-        loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-
-        sendto(_sockfd, "", 0, 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
-        _receive_thread.join();
+        _send_to_self("", 0);
+        if (_receive_thread.joinable()) _env->join(_receive_thread);
     }
+    if (_endpoint) _endpoint->_unroute(this);
     _send_buffer.clear();
+    _paths.clear();
+    _peer_ack    = 0;
+    _skip_to     = 0;
+    _undo        = {};
+    _ecn_recover = 0;
+    _shm_ring.release();
+    _shm_mode = false;
+    _compress = false;
     _stop_congestion_avoidance_thread();
     _fast_recovery = false;
     _cwnd          = 1.0;
     _ssthresh      = 64.0;
+    _trace_cwnd();
+
+    lock_guard<mutex> lk(_reply_mtx);
+    _replies.clear();
 }
 
 void RUDP_C::_enter_slow_start()
@@ -85,7 +123,9 @@ void RUDP_C::_enter_slow_start()
     _fast_recovery = false;
     _cwnd          = 1.0;
     CLOG("Enter Slow Start: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
-    _stop_congestion_avoidance_thread();
+    _trace.record(TraceEvent::STATE_CHANGE, _base, 0, 0, static_cast<uint8_t>(CcState::SLOW_START));
+    _trace_cwnd();
+    _ca_active = false;
 }
 
 void RUDP_C::_enter_congestion_avoidance()
@@ -93,17 +133,21 @@ void RUDP_C::_enter_congestion_avoidance()
     // 进入拥塞避免阶段
     _fast_recovery = false;
     CLOG("Enter Congestion Avoidance: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
-    _start_congestion_avoidance_thread();
+    _trace.record(TraceEvent::STATE_CHANGE, _base, 0, 0, static_cast<uint8_t>(CcState::CONGESTION_AVOIDANCE));
+    _ca_active = true;
 }
 
 void RUDP_C::_enter_fast_recovery()
 {
     // 进入快恢复阶段
+    _undo_begin(_undo, _cwnd, _ssthresh);
     _fast_recovery = true;
     _ssthresh      = max(2.0, _cwnd / 2.0);
-    _cwnd          = _ssthresh + 3.0;
+    _cwnd          = min(_ssthresh + 3.0, _max_cwnd);
     CLOG("Enter Fast Recovery: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
-    _stop_congestion_avoidance_thread();
+    _trace.record(TraceEvent::STATE_CHANGE, _base, 0, 0, static_cast<uint8_t>(CcState::FAST_RECOVERY));
+    _trace_cwnd();
+    _ca_active = false;
 }
 
 void RUDP_C::_on_new_ack_in_fast_recovery()
@@ -112,17 +156,21 @@ void RUDP_C::_on_new_ack_in_fast_recovery()
     _fast_recovery = false;
     _cwnd          = _ssthresh;
     CLOG("Exit Fast Recovery, into Congestion Avoidance: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
+    _trace_cwnd();
     _enter_congestion_avoidance();
 }
 
 void RUDP_C::_on_timeout()
 {
     // 超时处理：回到慢启动
+    _undo_begin(_undo, _cwnd, _ssthresh);
     _ssthresh      = max(2.0, _cwnd / 2.0);
     _cwnd          = 1.0;
     _fast_recovery = false;
     CLOG_WARN("Timeout: cwnd=", _cwnd, ", ssthresh=", _ssthresh, ", enter Slow Start.");
-    _stop_congestion_avoidance_thread();
+    _trace.record(TraceEvent::STATE_CHANGE, _base, 0, 0, static_cast<uint8_t>(CcState::SLOW_START));
+    _trace_cwnd();
+    _ca_active = false;
 }
 
 void RUDP_C::_adjust_cwnd_on_ack(uint32_t acked_seq_diff)
@@ -135,27 +183,47 @@ void RUDP_C::_adjust_cwnd_on_ack(uint32_t acked_seq_diff)
 
     if (_cwnd < _ssthresh)
     {
-        _cwnd += acked_seq_diff;
+        _cwnd = min(_cwnd + acked_seq_diff, _max_cwnd);
         CLOG("Slow Start: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
+        _trace_cwnd();
         if (_cwnd >= _ssthresh) _enter_congestion_avoidance();
     }
 }
 
+void RUDP_C::_trace_cwnd(uint8_t path)
+{
+    double ssthresh = _ssthresh;
+    if (_selective())
+    {
+        _trace.record(TraceEvent::CWND_CHANGE, _base, _paths[path].cwnd, _paths[path].ssthresh, path);
+        // 逐路径维护窗口时汇总各路径
+        ssthresh = 0;
+        for (auto& p : _paths) ssthresh += p.ssthresh;
+    }
+    else
+        _trace.record(TraceEvent::CWND_CHANGE, _base, _cwnd, _ssthresh);
+    RUDP_Counters::set(_counters.cwnd, static_cast<double>(current_window()));
+    RUDP_Counters::set(_counters.ssthresh, ssthresh);
+}
+
 void RUDP_C::_start_congestion_avoidance_thread()
 {
     if (!_ca_running)
     {
         _ca_running = true;
-        _ca_thread  = thread(&RUDP_C::_congestion_avoidance_handler, this);
+        // 挂在端点上时由端点的定时线程每个RTT调用一次_ca_tick
+        if (!_endpoint) _ca_thread = _env->spawn([this]() { _congestion_avoidance_handler(); });
     }
 }
 
 void RUDP_C::_stop_congestion_avoidance_thread()
 {
+    _ca_active = false;
     if (_ca_running)
     {
         _ca_running = false;
-        if (_ca_thread.joinable()) { _ca_thread.join(); }
+        if (_ca_thread.joinable()) { _env->join(_ca_thread); }
+        if (_endpoint) _endpoint->_quiesce();
     }
 }
 
@@ -163,220 +231,672 @@ void RUDP_C::_congestion_avoidance_handler()
 {
     while (_ca_running)
     {
-        this_thread::sleep_for(_rtt);
+        _env->sleep_for(_rtt);
         if (!_ca_running) break;
-        if (_send_buffer.empty()) continue;
-        if (!_fast_recovery && _statu == RUDP_STATUS::ESTABLISHED && _cwnd >= _ssthresh)
+        _ca_tick();
+    }
+}
+
+void RUDP_C::_ca_tick()
+{
+    if (!_ca_active || _send_buffer.empty()) return;
+    if (!_fast_recovery && _statu == RUDP_STATUS::ESTABLISHED && _cwnd >= _ssthresh && _cwnd < _max_cwnd)
+    {
+        _cwnd += 1.0;
+        CLOG("Congestion Avoidance increment: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
+        _trace_cwnd();
+    }
+}
+
+RUDP_Path::RUDP_Path(const sockaddr_in& addr)
+    : addr(addr), cwnd(1.0), ssthresh(64.0), srtt(GUESS_RTT), rttvar(GUESS_RTT / 2), inflight(0), recover(0),
+      rack_order(0)
+{}
+
+bool RUDP_C::_multipath() const { return _paths.size() > 1; }
+
+// 选择重传与多路径共用逐包确认、逐包计时的路径机制，单路径时_paths只有握手路径
+bool RUDP_C::_selective() const { return !_paths.empty(); }
+
+int RUDP_C::_pick_path(bool ignore_window) const
+{
+    int best = -1;
+    for (size_t i = 0; i < _paths.size(); ++i)
+    {
+        const RUDP_Path& path = _paths[i];
+        if (!ignore_window && path.inflight >= max(1u, static_cast<uint32_t>(path.cwnd))) continue;
+        if (best < 0 || path.srtt < _paths[best].srtt) best = static_cast<int>(i);
+    }
+    return best;
+}
+
+void RUDP_C::_transmit(uint64_t seq, entry& ent, uint8_t path)
+{
+    ent.path      = path;
+    ent.send_time = chrono::time_point_cast<ms>(_env->now());
+    ent.tx_order  = ++_tx_counter;
+    ent.dup_sacks = 0;
+    ++_paths[path].inflight;
+
+    _send_to(ent.packet, _paths[path].addr);
+}
+
+void RUDP_C::_mp_on_delivered(entry& ent)
+{
+    RUDP_Path& path = _paths[ent.path];
+    if (path.inflight) --path.inflight;
+    path.rack_order = max(path.rack_order, ent.tx_order);
+    _trace.record(TraceEvent::PACKET_ACKED, ent.packet->header.seq_num, 0, 0, ent.path);
+
+    // Karn算法：重传过的报文不参与RTT采样
+    if (!ent.retransmitted)
+    {
+        auto sample = chrono::time_point_cast<ms>(_env->now()) - ent.send_time;
+        auto err    = sample - path.srtt;
+        path.srtt += ms(static_cast<long>(_alpha * err.count()));
+        path.rttvar += ms(static_cast<long>(_beta * (abs(err.count()) - path.rttvar.count())));
+        _counters.recordRtt(sample);
+        _trace.record(TraceEvent::RTT_SAMPLE,
+            ent.packet->header.seq_num,
+            static_cast<float>(sample.count()),
+            static_cast<float>(path.srtt.count()),
+            ent.path);
+        // 统计的RTT取0号路径
+        if (ent.path == 0) _publish_rtt(path.srtt, path.rttvar);
+    }
+
+    if (path.cwnd < path.ssthresh)
+        path.cwnd += 1.0;
+    else
+        path.cwnd += 1.0 / path.cwnd;
+    path.cwnd = min(path.cwnd, _max_cwnd);
+    _trace_cwnd(ent.path);
+}
+
+void RUDP_C::_mp_on_loss(uint64_t seq, entry& ent, bool timeout)
+{
+    RUDP_Path& lost_on = _paths[ent.path];
+    if (lost_on.inflight) --lost_on.inflight;
+    _trace.record(TraceEvent::PACKET_LOST, seq, 0, 0, ent.path);
+
+    // 同一窗口内的多个丢包只降一次窗
+    if (seq >= lost_on.recover)
+    {
+        _undo_begin(lost_on.undo, lost_on.cwnd, lost_on.ssthresh);
+        lost_on.ssthresh = max(2.0, lost_on.cwnd / 2.0);
+        lost_on.cwnd     = timeout ? 1.0 : lost_on.ssthresh;
+        lost_on.recover  = _seq_num;
+        CLOG_WARN("[",
+            statuStr(_statu),
+            "] Path ",
+            static_cast<int>(ent.path),
+            timeout ? " timeout" : " loss",
+            " at seq=",
+            seq,
+            ": cwnd=",
+            lost_on.cwnd,
+            ", ssthresh=",
+            lost_on.ssthresh);
+        _trace_cwnd(ent.path);
+    }
+
+    // 重传走当前RTT最小的路径，不受窗口限制
+    _undo_track(lost_on.undo, seq);
+    RUDP_Counters::add(timeout ? _counters.timeout_retransmits : _counters.fast_retransmits);
+    ent.retransmitted = true;
+    _transmit(seq, ent, static_cast<uint8_t>(_pick_path(true)));
+    CLOG("[", statuStr(_statu), "] Resend packet seq=", seq, " on path ", static_cast<int>(ent.path));
+}
+
+void RUDP_C::_mp_on_ack(RUDP_P& ack)
+{
+    WriteGuard guard   = _send_buffer_lock.write();
+    uint64_t   ack_num = seqExtend(ack.header.ack_num, _base);
+    auto       now_ms  = chrono::time_point_cast<ms>(_env->now());
+    _last_ack_time     = now_ms;
+    if (ack_num > _peer_ack)
+        _peer_ack = ack_num;
+    else if (!CHK_DUP(ack))
+        RUDP_Counters::add(_counters.dup_acks);
+
+    // ECE回显归到被回显报文所走的路径，须在累计确认删除该报文前查找
+    if (CHK_ECE(ack) && ack.header.data_len == sizeof(uint32_t))
+    {
+        uint32_t marked_seq;
+        memcpy(&marked_seq, ack.body, sizeof(marked_seq));
+        auto it = _send_buffer.find(seqExtend(marked_seq, _base));
+        if (it != _send_buffer.end()) _on_ece(it->first, it->second.path);
+    }
+
+    // 累计确认
+    while (_base < ack_num && !_send_buffer.empty())
+    {
+        auto it = _send_buffer.find(_base);
+        if (it != _send_buffer.end())
         {
-            _cwnd += 1.0;
-            CLOG("Congestion Avoidance increment: cwnd=", _cwnd, ", ssthresh=", _ssthresh);
+            if (!it->second.sacked) _mp_on_delivered(it->second);
+            _send_buffer.erase(it);
+            _tlp_pending = false;
         }
+        ++_base;
     }
+
+    // 逐包确认：ACK体回显了触发它的报文序号
+    if (ack.header.data_len != sizeof(uint32_t)) return;
+
+    uint32_t sacked_seq;
+    memcpy(&sacked_seq, ack.body, sizeof(sacked_seq));
+    if (CHK_DUP(ack)) _on_dsack(seqExtend(sacked_seq, _base));
+    auto it = _send_buffer.find(seqExtend(sacked_seq, _base));
+    if (it == _send_buffer.end() || it->second.sacked) return;
+
+    entry& sacked = it->second;
+    sacked.sacked = true;
+    _tlp_pending  = false;
+    _mp_on_delivered(sacked);
+
+    // 同一路径内先发后至才算丢包，跨路径的乱序不计；三次逐包确认或RACK时间条件满足其一即重传
+    for (auto& [seq, ent] : _send_buffer)
+    {
+        if (ent.sacked || ent.path != sacked.path || ent.tx_order > sacked.tx_order) continue;
+        if (++ent.dup_sacks == 3 || _rack_lost(ent, now_ms)) _mp_on_loss(seq, ent, false);
+    }
+}
+
+void RUDP_C::_undo_begin(RUDP_Undo& undo, double cwnd, double ssthresh)
+{
+    // 上一轮重传尚未全部确认时并入同一轮，保留最初的窗口
+    if (undo.high != 0 && _base < undo.high) return;
+    undo = {cwnd, ssthresh, _base, _base, 0};
+}
+
+void RUDP_C::_undo_track(RUDP_Undo& undo, uint64_t seq)
+{
+    if (undo.high == 0 || seq < undo.low) return;
+    ++undo.retrans;
+    undo.high = max(undo.high, seq + 1);
+}
+
+void RUDP_C::_on_dsack(uint64_t seq)
+{
+    // 调用方需持有_send_buffer_lock写锁
+    RUDP_Counters::add(_counters.spurious_retransmits);
+
+    int        path = -1;
+    RUDP_Undo* undo = &_undo;
+    for (size_t i = 0; i < _paths.size(); ++i)
+    {
+        undo = &_paths[i].undo;
+        path = static_cast<int>(i);
+        if (undo->retrans && seq >= undo->low && seq < undo->high) break;
+    }
+    if (!undo->retrans || seq < undo->low || seq >= undo->high || --undo->retrans) return;
+
+    // 本轮每个重传都有一份原始报文先到达了，丢包是延迟突增或乱序造成的误判
+    // 选择重传下只恢复ssthresh，由慢启动回升，避免突增尚未结束时一次灌满路径队列再次超时
+    double& cwnd     = path < 0 ? _cwnd : _paths[path].cwnd;
+    double& ssthresh = path < 0 ? _ssthresh : _paths[path].ssthresh;
+    if (path < 0) cwnd = max(cwnd, undo->cwnd);
+    ssthresh = max(ssthresh, undo->ssthresh);
+    CLOG_WARN("[",
+        statuStr(_statu),
+        "] Retransmissions in [",
+        undo->low,
+        ", ",
+        undo->high,
+        ") were spurious, undo: cwnd=",
+        cwnd,
+        ", ssthresh=",
+        ssthresh);
+    undo->high = 0;
+    RUDP_Counters::add(_counters.cwnd_undos);
+
+    if (path >= 0)
+    {
+        _trace_cwnd(static_cast<uint8_t>(path));
+        return;
+    }
+    _fast_recovery = false;
+    _trace_cwnd();
+    if (_cwnd >= _ssthresh) _enter_congestion_avoidance();
+}
+
+// ECE回显：途中队列已超过标记阈值但尚未丢包，只降窗不重传，同一窗口内至多降一次
+void RUDP_C::_on_ece(uint64_t seq, int path)
+{
+    if (!_ecn) return;
+
+    uint64_t& recover  = path < 0 ? _ecn_recover : _paths[path].recover;
+    double&   cwnd     = path < 0 ? _cwnd : _paths[path].cwnd;
+    double&   ssthresh = path < 0 ? _ssthresh : _paths[path].ssthresh;
+    if (seq < recover || (path < 0 && _fast_recovery)) return;
+
+    ssthresh = max(2.0, cwnd / 2.0);
+    cwnd     = ssthresh;
+    recover  = _seq_num;
+    RUDP_Counters::add(_counters.ecn_reductions);
+    CLOG("[", statuStr(_statu), "] ECN echo at seq=", seq, ": cwnd=", cwnd, ", ssthresh=", ssthresh);
+
+    if (path >= 0)
+    {
+        _trace_cwnd(static_cast<uint8_t>(path));
+        return;
+    }
+    _trace_cwnd();
+    if (!_ca_active) _enter_congestion_avoidance();
+}
+
+// RACK：同一路径上晚于它发出的报文已被确认，且自发出起超过sRTT加乱序窗口(sRTT/4)仍未确认，判为丢失
+bool RUDP_C::_rack_lost(const entry& ent, time_point now) const
+{
+    const RUDP_Path& path = _paths[ent.path];
+    return ent.tx_order < path.rack_order && now - ent.send_time > path.srtt + max(path.srtt / 4, ms(1));
+}
+
+void RUDP_C::_go_back_n(time_point now)
+{
+    // 调用方需持有_send_buffer_lock写锁
+    for (auto& [seq_num, ent] : _send_buffer)
+    {
+        if (_expired(ent, now)) continue;
+        _send_to(ent.packet, _remote_addr, true);
+        _undo_track(_undo, seq_num);
+        RUDP_Counters::add(_counters.fast_retransmits);
+        ent.send_time = now;
+    }
+    _flush_sends();
+}
+
+void RUDP_C::_tail_probe(time_point now)
+{
+    // 调用方需持有_send_buffer_lock写锁
+    // 尾部报文凑不齐重复ACK，丢了只能等RTO。最后一次发送或收到ACK后约2个sRTT仍无进展时，
+    // 重发最后一个未确认的报文：它的确认让RACK或重复ACK识别出之前的丢包，丢的若正是它则直接补上
+    if (_tlp_pending) return;
+    for (auto it = _send_buffer.rbegin(); it != _send_buffer.rend(); ++it)
+    {
+        entry& ent = it->second;
+        if (ent.sacked || _expired(ent, now)) continue;
+
+        ms srtt = _selective() ? _paths[ent.path].srtt : _rtt;
+        ms pto  = max(2 * srtt, 2 * check_gap);
+        if (now - max(ent.send_time, _last_ack_time) <= pto) return;
+
+        _tlp_pending = true;
+        _undo_track(_selective() ? _paths[ent.path].undo : _undo, it->first);
+        RUDP_Counters::add(_counters.tail_probes);
+        _trace.record(TraceEvent::PROBE_SENT, it->first, static_cast<float>(pto.count()), 0, ent.path);
+        CLOG("[", statuStr(_statu), "] Tail loss probe after ", pto.count(), "ms, resend seq=", it->first);
+        if (_selective())
+        {
+            // 探测不代表丢包，不降窗
+            if (_paths[ent.path].inflight) --_paths[ent.path].inflight;
+            ent.retransmitted = true;
+            _transmit(it->first, ent, static_cast<uint8_t>(_pick_path(true)));
+        }
+        else
+        {
+            _send_to(ent.packet, _remote_addr);
+            ent.send_time = now;
+        }
+        return;
+    }
+}
+
+bool RUDP_C::_expired(const entry& ent, time_point now) { return ent.deadline != time_point{} && now > ent.deadline; }
+
+void RUDP_C::_skip_expired(ms rto)
+{
+    // 调用方需持有_send_buffer_lock写锁
+    auto     now_ms  = chrono::time_point_cast<ms>(_env->now());
+    uint64_t skip_to = _base;
+    while (true)
+    {
+        auto it = _send_buffer.find(skip_to);
+        if (it == _send_buffer.end() || !_expired(it->second, now_ms)) break;
+
+        entry& ent = it->second;
+        if (_selective() && !ent.sacked && _paths[ent.path].inflight) --_paths[ent.path].inflight;
+        _send_buffer.erase(it);
+        ++skip_to;
+    }
+
+    if (skip_to != _base)
+    {
+        CLOG_WARN("[", statuStr(_statu), "] Abandon expired packets [", _base, ", ", skip_to, "), send forward skip.");
+        _base    = skip_to;
+        _skip_to = skip_to;
+        _send_forward_skip();
+    }
+    else if (_skip_to > _peer_ack && now_ms - _skip_sent > rto)
+    {
+        // 跳过通知未被确认，按RTO重发
+        _send_forward_skip();
+    }
+}
+
+void RUDP_C::_send_forward_skip()
+{
+    PacketBuf fsk_packet          = PacketBuf::alloc(sizeof(RUDP_H));
+    fsk_packet->header.connect_id = _connect_id;
+    fsk_packet->header.seq_num    = _skip_to - 1;  // 被放弃的序号，不会被误当作逐包确认
+    fsk_packet->header.ack_num    = _skip_to;
+    SET_FSK(*fsk_packet);
+    genCheckSum(*fsk_packet);
+
+    _send_to(fsk_packet, _remote_addr);
+    _skip_sent = chrono::time_point_cast<ms>(_env->now());
 }
 
 void RUDP_C::_resend_handler()
 {
     while (_resending)
     {
+        _resend_tick();
+        _env->sleep_for(check_gap);
+    }
+}
+
+void RUDP_C::_resend_tick()
+{
+    ms rto;
+    {
+        ReadGuard guard = _rto_lock.read();
+        rto             = _rto;
+    }
+
+    WriteGuard guard = _send_buffer_lock.write();
+    _skip_expired(rto);
+    if (!_send_buffer.empty())
+    {
+        auto     now_ms       = chrono::time_point_cast<ms>(_env->now());
+        uint64_t seq_to_check = _base;
+        auto     it           = _send_buffer.find(seq_to_check);
+        if (_selective())
         {
-            ms rto;
+            // 选择重传：逐包按所在路径的RTO判定超时，只重传超时报文
+            for (auto& [seq_num, ent] : _send_buffer)
             {
-                ReadGuard guard = _rto_lock.read();
-                rto             = _rto;
+                const RUDP_Path& path = _paths[ent.path];
+                ms path_rto = max(path.srtt + 4 * path.rttvar, 2 * check_gap);
+                if (ent.sacked || _expired(ent, now_ms)) continue;
+                if (now_ms - ent.send_time > path_rto)
+                {
+                    _trace.record(TraceEvent::RTO_FIRED,
+                        seq_num,
+                        static_cast<float>(path_rto.count()),
+                        0,
+                        ent.path);
+                    _mp_on_loss(seq_num, ent, true);
+                }
+                else if (_rack_lost(ent, now_ms))
+                {
+                    // 确认到达时乱序窗口尚未过去的报文，由这里的定时检查补判
+                    _trace.record(TraceEvent::PACKET_LOST, seq_num, 0, 0, ent.path);
+                    _mp_on_loss(seq_num, ent, false);
+                }
             }
-
-            WriteGuard guard = _send_buffer_lock.write();
-            if (!_send_buffer.empty())
+        }
+        else if (it != _send_buffer.end())
+        {
+            if (now_ms - it->second.send_time > rto)
             {
-                auto     now_ms       = chrono::time_point_cast<ms>(chrono::steady_clock::now());
-                uint32_t seq_to_check = _base;
-                auto     it           = _send_buffer.find(seq_to_check);
-                if (it != _send_buffer.end())
+                // 超时
+                _trace.record(TraceEvent::RTO_FIRED, seq_to_check, static_cast<float>(rto.count()));
+                _on_timeout();
+                CLOG_WARN("[",
+                    statuStr(_statu),
+                    "] Timeout at seq=",
+                    seq_to_check,
+                    ", resend all unacked packets starting from base.");
+
+                for (auto& [seq_num, ent] : _send_buffer)
                 {
-                    auto& [packet, last_send_time] = it->second;
-                    if (now_ms - last_send_time > rto)
-                    {
-                        // 超时
-                        _on_timeout();
-                        CLOG_WARN("[",
-                            statuStr(_statu),
-                            "] Timeout at seq=",
-                            seq_to_check,
-                            ", resend all unacked packets starting from base.");
-
-                        for (auto& [seq_num, ent] : _send_buffer)
-                        {
-                            auto& [p, t] = ent;
-                            sendto(_sockfd,
-                                (const char*)&p,
-                                lenInByte(p),
-                                0,
-                                (const struct sockaddr*)&_remote_addr,
-                                sizeof(sockaddr_in));
-                            t = now_ms;  // 更新发送时间
-                            CLOG("[", statuStr(_statu), "] Resend packet seq=", seq_num);
-                        }
-                    }
+                    if (_expired(ent, now_ms)) continue;
+                    _send_to(ent.packet, _remote_addr, true);
+                    _undo_track(_undo, seq_num);
+                    RUDP_Counters::add(_counters.timeout_retransmits);
+                    ent.send_time = now_ms;  // 更新发送时间
+                    CLOG("[", statuStr(_statu), "] Resend packet seq=", seq_num);
                 }
+                _flush_sends();
+            }
+            else if (_dup_ack_seen && !_fast_recovery && !_expired(it->second, now_ms) &&
+                     now_ms - it->second.send_time > _rtt + max(_rtt / 4, ms(1)))
+            {
+                // RACK：已有后发的报文到达，base过了一个RTT加乱序窗口仍未确认，不必等满3个重复ACK
+                _trace.record(TraceEvent::PACKET_LOST, seq_to_check);
+                CLOG_WARN("[",
+                    statuStr(_statu),
+                    "] RACK detects loss at seq=",
+                    seq_to_check,
+                    ", resend all unacked packets starting from base.");
+                _enter_fast_recovery();
+                _go_back_n(now_ms);
             }
         }
-        this_thread::sleep_for(check_gap);
+        _tail_probe(now_ms);
     }
 }
 
 void RUDP_C::_receive_handler()
 {
-    RUDP_P      recv_buffer;
-    socklen_t   addr_len = sizeof(sockaddr_in);
-    sockaddr_in tmp_addr;
-    size_t      cnt = 0;
-
-    uint32_t last_ack_seq  = 0;
-    int      dup_ack_count = 0;
+    RUDP_P recv_buffer;
 
+    _pin_to_core();
     while (_receiving)
     {
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
+        _recv_packet(recv_buffer);
 
         if (!_receiving) break;
 
-        if (!checkCheckSum(recv_buffer))
-        {
-            CLOG_WARN("[", statuStr(_statu), "] Received corrupted packet (wrong checksum). Dropping.");
-            continue;
-        }
+        if (uint32_t drops = _take_kernel_drops())
+            CLOG_WARN("[", statuStr(_statu), "] Kernel receive queue overflow, ", drops, " datagrams dropped locally.");
 
-        if (recv_buffer.header.connect_id != _connect_id)
-        {
-            CLOG_WARN("[",
-                statuStr(_statu),
-                "] Received packet with unexpected connect_id=",
-                recv_buffer.header.connect_id,
-                ", expected=",
-                _connect_id,
-                ". Dropping.");
-            continue;
-        }
+        _on_packet(recv_buffer);
+    }
+}
 
-        CLOG("[",
+void RUDP_C::_on_packet(RUDP_P& packet)
+{
+    if (!checkCheckSum(packet))
+    {
+        CLOG_WARN("[", statuStr(_statu), "] Received corrupted packet (wrong checksum). Dropping.");
+        return;
+    }
+
+    if (packet.header.connect_id != _connect_id)
+    {
+        CLOG_WARN("[",
             statuStr(_statu),
-            "] Received packet: connect_id=",
-            recv_buffer.header.connect_id,
-            ", seq=",
-            recv_buffer.header.seq_num,
-            ", ack=",
-            recv_buffer.header.ack_num,
-            ", flags=",
-            flagsToStr(recv_buffer),
-            ", data_len=",
-            recv_buffer.header.data_len);
+            "] Received packet with unexpected connect_id=",
+            packet.header.connect_id,
+            ", expected=",
+            _connect_id,
+            ". Dropping.");
+        return;
+    }
 
-        uint32_t acked_seq = recv_buffer.header.ack_num - 1;
+    CLOG("[",
+        statuStr(_statu),
+        "] Received packet: connect_id=",
+        packet.header.connect_id,
+        ", seq=",
+        packet.header.seq_num,
+        ", ack=",
+        packet.header.ack_num,
+        ", flags=",
+        flagsToStr(packet),
+        ", data_len=",
+        packet.header.data_len);
 
-        uint32_t acked_seq_diff = acked_seq - last_ack_seq;
-        if (acked_seq_diff)
-        {
-            dup_ack_count = 0;
-            last_ack_seq  = acked_seq;
-        }
-        else
-            ++dup_ack_count;
+    if (CHK_SYN(packet) && CHK_ACK(packet))
+    {
+        _on_syn_ack(packet);
+        return;
+    }
+
+    // 应用应答不携带确认信息
+    if (CHK_APP(packet))
+    {
+        lock_guard<mutex> lk(_reply_mtx);
+        if (_replies.size() >= REPLY_QUEUE_DEPTH) _replies.pop_front();
+        _replies.emplace_back(packet.header.msg_type, vector<char>(packet.body, packet.body + packet.header.data_len));
+        _env->notify_all(_reply_cv);
+        return;
+    }
+
+    if (_selective())
+    {
+        _mp_on_ack(packet);
+        return;
+    }
 
-        bool                 do_rtt_update = false;
-        chrono::milliseconds sample_rtt(0);
+    uint64_t ack_num   = seqExtend(packet.header.ack_num, _base);
+    uint64_t acked_seq = ack_num - 1;
+    if (ack_num > _peer_ack) _peer_ack = ack_num;
+
+    if (CHK_DUP(packet) && packet.header.data_len == sizeof(uint32_t))
+    {
+        uint32_t dup_seq;
+        memcpy(&dup_seq, packet.body, sizeof(dup_seq));
+        WriteGuard guard = _send_buffer_lock.write();
+        _on_dsack(seqExtend(dup_seq, _base));
+    }
+    if (CHK_ECE(packet)) _on_ece(acked_seq, -1);
+
+    // 重复到达触发的ACK不说明有后发的报文到达，不计入重复ACK
+    uint64_t acked_seq_diff = acked_seq - _ack_state.last_ack_seq;
+    if (acked_seq_diff)
+    {
+        _ack_state.dup_ack_count = 0;
+        _ack_state.last_ack_seq  = acked_seq;
+        _dup_ack_seen            = false;
+    }
+    else if (!CHK_DUP(packet))
+    {
+        ++_ack_state.dup_ack_count;
+        RUDP_Counters::add(_counters.dup_acks);
+        _dup_ack_seen = true;
+    }
+
+    bool                 do_rtt_update = false;
+    chrono::milliseconds sample_rtt(0);
+    uint32_t             newly_acked = 0;
+    {
+        WriteGuard guard = _send_buffer_lock.write();
+        _last_ack_time   = chrono::time_point_cast<ms>(_env->now());
+        while (_base <= acked_seq && !_send_buffer.empty())
         {
-            WriteGuard guard = _send_buffer_lock.write();
-            while (_base <= acked_seq && !_send_buffer.empty())
+            auto it = _send_buffer.find(_base);
+            if (it != _send_buffer.end())
             {
-                auto it = _send_buffer.find(_base);
-                if (it != _send_buffer.end())
+                if (++_ack_state.cnt % 5 == 0)
                 {
-                    if (++cnt % 5 == 0)
-                    {
-                        auto send_time = it->second.second;
-                        auto now_ms    = chrono::time_point_cast<ms>(chrono::steady_clock::now());
-                        sample_rtt     = now_ms - send_time;
-                        do_rtt_update  = true;
-                    }
-
-                    _send_buffer.erase(it);
+                    auto send_time = it->second.send_time;
+                    auto now_ms    = chrono::time_point_cast<ms>(_env->now());
+                    sample_rtt     = now_ms - send_time;
+                    do_rtt_update  = true;
                 }
-                ++_base;
+
+                _ack_state.acked_bytes += it->second.packet->header.data_len;
+                _trace.record(TraceEvent::PACKET_ACKED, _base);
+                _send_buffer.erase(it);
+                _tlp_pending = false;
+                ++newly_acked;
             }
+            ++_base;
         }
+    }
+
+    if (do_rtt_update && sample_rtt.count() > 0)
+    {
+        auto err = chrono::duration_cast<ms>(sample_rtt - _rtt);
+        _rtt += ms(static_cast<long>(_alpha * err.count()));
+        auto abs_err = ms(abs(err.count()));
+        _dev_rtt += ms(static_cast<long>(_beta * (abs_err.count() - _dev_rtt.count())));
+        _counters.recordRtt(sample_rtt);
+        _trace.record(TraceEvent::RTT_SAMPLE,
+            acked_seq,
+            static_cast<float>(sample_rtt.count()),
+            static_cast<float>(_rtt.count()));
 
-        if (do_rtt_update && sample_rtt.count() > 0)
         {
-            auto err = chrono::duration_cast<ms>(sample_rtt - _rtt);
-            _rtt += ms(static_cast<long>(_alpha * err.count()));
-            auto abs_err = ms(abs(err.count()));
-            _dev_rtt += ms(static_cast<long>(_beta * (abs_err.count() - _dev_rtt.count())));
+            WriteGuard guard = _rto_lock.write();
+            _rto             = _rtt + 4 * _dev_rtt;
+        }
+        _publish_rtt(_rtt, _dev_rtt);
 
-            {
-                WriteGuard guard = _rto_lock.write();
-                _rto             = _rtt + 4 * _dev_rtt;
-            }
+        CLOG("[",
+            statuStr(_statu),
+            "] RTT sample: ",
+            sample_rtt.count(),
+            "ms, updated RTT=",
+            _rtt.count(),
+            "ms, DevRTT=",
+            _dev_rtt.count(),
+            "ms, RTO=",
+            _rto.count(),
+            "ms");
+    }
 
+    auto elapsed = chrono::duration_cast<ms>(_env->now() - _ack_state.rate_start);
+    if (elapsed >= max(_rtt, check_gap))
+    {
+        size_t old_buf = _sock_buf;
+        _autotune_sock_buf(_rtt, _ack_state.acked_bytes * 1000.0 / elapsed.count());
+        if (_sock_buf != old_buf)
             CLOG("[",
                 statuStr(_statu),
-                "] RTT sample: ",
-                sample_rtt.count(),
-                "ms, updated RTT=",
+                "] Delivery rate ",
+                _delivery_rate,
+                " B/s, RTT=",
                 _rtt.count(),
-                "ms, DevRTT=",
-                _dev_rtt.count(),
-                "ms, RTO=",
-                _rto.count(),
-                "ms");
-        }
+                "ms, socket buffer grows to ",
+                _sock_buf,
+                " bytes");
+        _ack_state.acked_bytes = 0;
+        _ack_state.rate_start  = _env->now();
+    }
 
-        // 拥塞控制处理
-        if (acked_seq_diff)
-            _adjust_cwnd_on_ack(acked_seq_diff);
-        else
+    // 拥塞控制处理
+    // 只有前向跳过推进的确认不代表新交付的数据，不增窗
+    if (acked_seq_diff)
+    {
+        if (newly_acked) _adjust_cwnd_on_ack(newly_acked);
+    }
+    else
+    {
+        // RACK可能已在定时检查中先行重传并进入快恢复
+        if (_ack_state.dup_ack_count == 3 && !_fast_recovery)
         {
-            if (dup_ack_count == 3)
-            {
-                CLOG_WARN(
-                    "[", statuStr(_statu), "] 3 duplicate ACKs detected for ack_seq=", acked_seq, ", fast retransmit.");
-
-                {
-                    WriteGuard guard  = _send_buffer_lock.write();
-                    auto       now_ms = chrono::time_point_cast<ms>(chrono::steady_clock::now());
-                    for (auto& [seq_num, ent] : _send_buffer)
-                    {
-                        auto& [p, t] = ent;
-                        sendto(_sockfd,
-                            (const char*)&p,
-                            lenInByte(p),
-                            0,
-                            (const struct sockaddr*)&_remote_addr,
-                            sizeof(sockaddr_in));
-                        t = now_ms;
-                    }
-                }
+            CLOG_WARN(
+                "[", statuStr(_statu), "] 3 duplicate ACKs detected for ack_seq=", acked_seq, ", fast retransmit.");
+            _trace.record(TraceEvent::PACKET_LOST, acked_seq + 1);
 
+            {
+                WriteGuard guard = _send_buffer_lock.write();
                 _enter_fast_recovery();
+                _go_back_n(chrono::time_point_cast<ms>(_env->now()));
             }
         }
     }
 }
 
-void RUDP_C::_wakeup_handler()
+void RUDP_C::_start_receiving()
 {
-    sockaddr_in loopback_addr;
-    ZeroMemory(&loopback_addr, sizeof(loopback_addr));
-    loopback_addr.sin_family      = AF_INET;
-    loopback_addr.sin_port        = htons(_port);
-    loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-    string      fake              = "fake";
-    const char* fake_c            = fake.c_str();
-    int         len               = static_cast<int>(fake.length());
+    _ack_state            = AckState();
+    _ack_state.rate_start = _env->now();
+    _receiving            = true;
+    if (!_endpoint) _receive_thread = _env->spawn([this]() { _receive_handler(); });
+}
 
+void RUDP_C::_wakeup_handler()
+{
     while (_wakeup)
     {
-        this_thread::sleep_for(ms(2000));
-        sendto(_sockfd, fake_c, len, 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
+        _env->sleep_for(ms(2000));
+        _send_to_self("fake", 4);
     }
 }
 
@@ -388,36 +908,93 @@ bool RUDP_C::connect(const char* remote_ip, int remote_port)
         return false;
     }
 
-    _resending     = true;
-    _resend_thread = thread(&RUDP_C::_resend_handler, this);
-    CLOG(" Start resend thread.");
+    // 挂在端点上时由端点的定时线程检查超时，收包线程按connect_id分派
+    _resending = true;
+    if (!_endpoint)
+    {
+        _resend_thread = _env->spawn([this]() { _resend_handler(); });
+        CLOG(" Start resend thread.");
+    }
 
     _remote_addr.sin_family      = AF_INET;
     _remote_addr.sin_port        = htons(remote_port);
     _remote_addr.sin_addr.s_addr = inet_addr(remote_ip);
 
     _connect_id = dist(gen);
+    while (_endpoint && !_endpoint->_route(this, _connect_id)) _connect_id = dist(gen);
+    _seq_num = SEQ_EPOCH + _isn;
+    _counters.reset();
     CLOG(" Enter connect mode, generate connect_id=", _connect_id);
 
-    RUDP_P syn_packet;
-    syn_packet.header.connect_id = _connect_id;
-    syn_packet.header.seq_num    = _seq_num++;
-    SET_SYN(syn_packet);
-    genCheckSum(syn_packet);
+    _paths.clear();
+    if (!_extra_paths.empty() || _arq == ArqMode::SELECTIVE_REPEAT)
+    {
+        _paths.emplace_back(_remote_addr);
+        for (auto& addr : _extra_paths) _paths.emplace_back(addr);
+        CLOG(" Selective repeat enabled with ", _paths.size(), " path(s).");
+    }
+
+    // 选择重传的逐路径状态要等握手确定，共享内存要等对端接受，这两种情况仍走完整握手
+    if (!_same_server(_remote_addr)) _session = RUDP_Session();
+    _zero_rtt = _session.has_token && !_selective() && !_shm_enabled;
+
+    uint64_t  syn_seq    = _seq_num++;
+    PacketBuf syn_packet = PacketBuf::alloc(sizeof(RUDP_H) + max(sizeof(RUDP_TOKEN), sizeof(RUDP_SHM_OFFER)));
+
+    syn_packet->header.connect_id = _connect_id;
+    syn_packet->header.seq_num    = syn_seq;
+    SET_SYN(*syn_packet);
+    if (_multipath())
+        SET_MP(*syn_packet);
+    else if (_selective())
+        SET_SR(*syn_packet);
+    else if (_arq == ArqMode::STOP_AND_WAIT)
+        SET_SW(*syn_packet);
+    if (_zero_rtt)
+    {
+        memcpy(syn_packet->body, &_session.token, sizeof(RUDP_TOKEN));
+        syn_packet->header.data_len = sizeof(RUDP_TOKEN);
+        SET_RES(*syn_packet);
+        _session.has_token = false;
+    }
+    else if (_shm_enabled && !_env->simulated() && _shm_ring.create())
+    {
+        // 附带共享内存提议，由服务端判断是否同一主机
+        RUDP_SHM_OFFER offer;
+        _shm_ring.fillOffer(offer);
+        memcpy(syn_packet->body, &offer, sizeof(offer));
+        syn_packet->header.data_len = sizeof(offer);
+        SET_SHM(*syn_packet);
+    }
+    if (_compress_enabled) SET_CMP(*syn_packet);
+    genCheckSum(*syn_packet);
     {
         WriteGuard guard = _send_buffer_lock.write();
-        SEND(syn_packet);
+        SEND(syn_seq, syn_packet);
+    }
+
+    if (_zero_rtt)
+    {
+        // 0-RTT：不等SYN_ACK直接进入ESTABLISHED，SYN留在发送缓冲区中由超时重传保证送达
+        _statu    = RUDP_STATUS::ESTABLISHED;
+        _base     = syn_seq;
+        _compress = _compress_enabled && _session.compress;
+        CLOG("[", statuStr(_statu), "] Send SYN with resumption token to ", remote_ip, ":", remote_port, ", 0-RTT.");
+
+        _start_receiving();
+        _enter_slow_start();
+        _apply_session();
+        _start_congestion_avoidance_thread();
+        return true;
     }
 
     _statu = RUDP_STATUS::SYN_SENT;
     CLOG("[", statuStr(_statu), "] Send SYN packet to ", remote_ip, ":", remote_port, ". Change status to SYN_SENT.");
 
-    RUDP_P      recv_packet;
-    socklen_t   addr_len = sizeof(sockaddr_in);
-    sockaddr_in tmp_addr;
+    RUDP_P recv_packet;
     while (true)
     {
-        recvfrom(_sockfd, (char*)&recv_packet, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
+        _recv_packet(recv_packet);
 
         if (!checkCheckSum(recv_packet))
         {
@@ -441,19 +1018,35 @@ bool RUDP_C::connect(const char* remote_ip, int remote_port)
                 recv_packet.header.ack_num,
                 ". Change status to ESTABLISHED.");
 
-            _statu = RUDP_STATUS::ESTABLISHED;
-            RUDP_P ack_packet;
-            ack_packet.header.connect_id = _connect_id;
-            ack_packet.header.seq_num    = _seq_num++;
-            ack_packet.header.ack_num    = recv_packet.header.seq_num + 1;
-            SET_ACK(ack_packet);
-            SET_SYN(ack_packet);
-            genCheckSum(ack_packet);
+            _statu    = RUDP_STATUS::ESTABLISHED;
+            _shm_mode = CHK_SHM(recv_packet) && _shm_ring.valid();
+            if (_shm_mode) { CLOG(" Peer accepted shared memory fast path, data bypasses UDP."); }
+            else
+                _shm_ring.release();
+
+            // 共享内存通道不经过链路，无需压缩
+            _compress         = _compress_enabled && CHK_CMP(recv_packet) && !_shm_mode;
+            _compress_skip    = 0;
+            _compress_backoff = 0;
+            if (_compress) { CLOG(" Peer accepted payload compression."); }
+            _store_token(recv_packet);
+
+            uint64_t  ack_seq    = _seq_num++;
+            PacketBuf ack_packet = PacketBuf::alloc(sizeof(RUDP_H));
+
+            ack_packet->header.connect_id = _connect_id;
+            ack_packet->header.seq_num    = ack_seq;
+            ack_packet->header.ack_num    = recv_packet.header.seq_num + 1;
+            SET_ACK(*ack_packet);
+            SET_SYN(*ack_packet);
+            genCheckSum(*ack_packet);
 
             {
+                // 握手ACK占用一个序号，base指向它才能在丢失时被超时重传
                 WriteGuard guard = _send_buffer_lock.write();
-                _send_buffer.erase(recv_packet.header.seq_num);
-                SEND(ack_packet);
+                _send_buffer.erase(syn_seq);
+                _base = ack_seq;
+                SEND(ack_seq, ack_packet);
             }
 
             CLOG(" Now established, send ACK packet.");
@@ -468,13 +1061,12 @@ bool RUDP_C::connect(const char* remote_ip, int remote_port)
         return false;
     }
 
-    _receiving      = true;
-    _receive_thread = thread(&RUDP_C::_receive_handler, this);
-    CLOG(" Start receive thread.");
+    _start_receiving();
+    CLOG(" Start receiving.");
 
     while (true)
     {
-        this_thread::sleep_for(check_gap);
+        _env->sleep_for(check_gap);
         {
             ReadGuard guard = _send_buffer_lock.read();
             if (_send_buffer.empty()) break;
@@ -482,11 +1074,89 @@ bool RUDP_C::connect(const char* remote_ip, int remote_port)
     }
 
     _base = _seq_num;
-    // 初始进入慢启动
+    // 初始进入慢启动，拥塞避免线程在整个连接期间运行，只在拥塞避免阶段增窗
     _enter_slow_start();
+    _apply_session();
+    _start_congestion_avoidance_thread();
     return true;
 }
 
+bool RUDP_C::_same_server(const sockaddr_in& addr) const
+{
+    return _session.server.sin_addr.s_addr == addr.sin_addr.s_addr && _session.server.sin_port == addr.sin_port;
+}
+
+void RUDP_C::_store_token(RUDP_P& syn_ack)
+{
+    if (syn_ack.header.data_len != sizeof(RUDP_TOKEN)) return;
+    memcpy(&_session.token, syn_ack.body, sizeof(RUDP_TOKEN));
+    _session.server    = _remote_addr;
+    _session.has_token = true;
+    _session.compress  = CHK_CMP(syn_ack);
+}
+
+void RUDP_C::_apply_session()
+{
+    if (_session.srtt.count() == 0) return;
+
+    // RTT直接沿用；窗口只取上次的一半，路径状况可能已经变化
+    _rtt     = _session.srtt;
+    _dev_rtt = _session.rttvar;
+    {
+        WriteGuard guard = _rto_lock.write();
+        _rto             = _rtt + 4 * _dev_rtt;
+    }
+    _publish_rtt(_rtt, _dev_rtt);
+    _ssthresh = max(2.0, _session.ssthresh);
+    _cwnd     = clamp(_session.cwnd / 2, 1.0, _max_cwnd);
+    for (auto& path : _paths)
+    {
+        path.srtt     = _session.srtt;
+        path.rttvar   = _session.rttvar;
+        path.ssthresh = _ssthresh;
+        path.cwnd     = max(1.0, _cwnd / _paths.size());
+    }
+    CLOG(" Resume path parameters: RTT=", _rtt.count(), "ms, cwnd=", _cwnd, ", ssthresh=", _ssthresh);
+    _trace_cwnd();
+    if (_cwnd >= _ssthresh) _enter_congestion_avoidance();
+}
+
+void RUDP_C::_on_syn_ack(RUDP_P& syn_ack)
+{
+    _store_token(syn_ack);
+    if (!_zero_rtt) return;
+
+    {
+        WriteGuard guard = _send_buffer_lock.write();
+        uint64_t   syn   = seqExtend(syn_ack.header.ack_num, _base) - 1;
+        if (_send_buffer.erase(syn) && _base == syn) ++_base;
+    }
+    if (CHK_RES(syn_ack)) return;
+
+    // 令牌被拒，服务端停在SYN_RCVD：补发不占序号的握手ACK，此前的数据报文随后超时重传
+    PacketBuf ack_packet          = PacketBuf::alloc(sizeof(RUDP_H));
+    ack_packet->header.connect_id = _connect_id;
+    ack_packet->header.seq_num    = syn_ack.header.ack_num - 1;
+    ack_packet->header.ack_num    = syn_ack.header.seq_num + 1;
+    SET_ACK(*ack_packet);
+    genCheckSum(*ack_packet);
+    _send_to(ack_packet, _remote_addr);
+    CLOG_WARN("[", statuStr(_statu), "] Resumption token rejected, complete the handshake.");
+}
+
+RUDP_Session RUDP_C::session() const
+{
+    RUDP_Session session = _session;
+    bool         paths   = !_paths.empty();
+    session.srtt         = paths ? _paths[0].srtt : _rtt;
+    session.rttvar       = paths ? _paths[0].rttvar : _dev_rtt;
+    session.ssthresh     = paths ? _paths[0].ssthresh : _ssthresh;
+    session.cwnd         = current_window();
+    return session;
+}
+
+void RUDP_C::resume(const RUDP_Session& session) { _session = session; }
+
 bool RUDP_C::disconnect()
 {
     if (_statu != RUDP_STATUS::ESTABLISHED)
@@ -498,54 +1168,39 @@ bool RUDP_C::disconnect()
     // 停止拥塞控制线程
     _stop_congestion_avoidance_thread();
 
-    while (true)
-    {
-        {
-            ReadGuard guard = _send_buffer_lock.read();
-            if (_send_buffer.empty()) break;
-        }
-        this_thread::sleep_for(check_gap);
-    }
+    flush();
 
-    _receiving            = false;
-    SOCKET      send_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    sockaddr_in loopback_addr;
-    ZeroMemory(&loopback_addr, sizeof(loopback_addr));
-    loopback_addr.sin_family      = AF_INET;
-    loopback_addr.sin_port        = htons(_port);
-    loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-    string fake                   = "fake";
+    _receiving = false;
     cout << " Sent interrupt packet to stop receiving." << endl;
-    sendto(send_sock, fake.c_str(), (int)fake.length(), 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
-    closesocket(send_sock);
-    if (_receive_thread.joinable()) { _receive_thread.join(); }
+    _send_to_self("fake", 4);
+    if (_receive_thread.joinable()) { _env->join(_receive_thread); }
+
+    uint64_t  fin_seq    = _seq_num++;
+    PacketBuf fin_packet = PacketBuf::alloc(sizeof(RUDP_H));
 
-    RUDP_P fin_packet;
-    fin_packet.header.connect_id = _connect_id;
-    fin_packet.header.seq_num    = _seq_num++;
-    SET_FIN(fin_packet);
-    genCheckSum(fin_packet);
+    fin_packet->header.connect_id = _connect_id;
+    fin_packet->header.seq_num    = fin_seq;
+    SET_FIN(*fin_packet);
+    genCheckSum(*fin_packet);
 
     {
         WriteGuard guard = _send_buffer_lock.write();
-        SEND(fin_packet);
+        SEND(fin_seq, fin_packet);
     }
     CLOG("[",
         statuStr(_statu),
         "] Send FIN packet seq=",
-        fin_packet.header.seq_num,
+        fin_packet->header.seq_num,
         " to ",
         inet_ntoa(_remote_addr.sin_addr),
         ". Change status to FIN_WAIT.");
 
     _statu = RUDP_STATUS::FIN_WAIT;
 
-    RUDP_P      recv_buffer;
-    socklen_t   addr_len = sizeof(sockaddr_in);
-    sockaddr_in tmp_addr;
+    RUDP_P recv_buffer;
     while (true)
     {
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
+        _recv_packet(recv_buffer);
 
         if (!checkCheckSum(recv_buffer))
         {
@@ -557,7 +1212,7 @@ bool RUDP_C::disconnect()
             CLOG_WARN("[", statuStr(_statu), "] Wrong connect_id in FIN_WAIT. Dropping.");
             continue;
         }
-        if (recv_buffer.header.ack_num != _seq_num)
+        if (recv_buffer.header.ack_num != static_cast<uint32_t>(_seq_num))
         {
             CLOG_WARN("[", statuStr(_statu), "] Received packet with wrong ack_num during FIN_WAIT. Dropping.");
             continue;
@@ -571,21 +1226,17 @@ bool RUDP_C::disconnect()
         CLOG("[", statuStr(_statu), "] Received FIN_ACK packet seq=", recv_buffer.header.seq_num);
 
         _resending = false;
-        if (_resend_thread.joinable()) _resend_thread.join();
-        _send_buffer.erase(recv_buffer.header.ack_num - 1);
-
-        CLR_FLAGS(fin_packet);
-        fin_packet.header.seq_num = _seq_num++;
-        fin_packet.header.ack_num = recv_buffer.header.seq_num + 1;
-        SET_ACK(fin_packet);
-        genCheckSum(fin_packet);
-
-        sendto(_sockfd,
-            (const char*)&fin_packet,
-            lenInByte(fin_packet),
-            0,
-            (const struct sockaddr*)&_remote_addr,
-            sizeof(sockaddr_in));
+        if (_resend_thread.joinable()) _env->join(_resend_thread);
+        if (_endpoint) _endpoint->_quiesce();
+        _send_buffer.erase(fin_seq);
+
+        CLR_FLAGS(*fin_packet);
+        fin_packet->header.seq_num = _seq_num++;
+        fin_packet->header.ack_num = recv_buffer.header.seq_num + 1;
+        SET_ACK(*fin_packet);
+        genCheckSum(*fin_packet);
+
+        _send_to(fin_packet, _remote_addr);
         _statu = RUDP_STATUS::CLOSE_WAIT;
         CLOG(" Change status to CLOSE_WAIT.");
         break;
@@ -598,18 +1249,18 @@ bool RUDP_C::disconnect()
     }
 
     auto timeout    = ms(2000);  // 2s超时
-    auto start_time = chrono::high_resolution_clock::now();
-    auto now        = chrono::high_resolution_clock::now();
+    auto start_time = _env->now();
+    auto now        = _env->now();
     _wakeup         = true;
-    _wakeup_thread  = thread(&RUDP_C::_wakeup_handler, this);
+    _wakeup_thread  = _env->spawn([this]() { _wakeup_handler(); });
 
     cout << " Wait for 2s to close connection." << endl;
     while (true)
     {
-        now = chrono::high_resolution_clock::now();
+        now = _env->now();
         if (chrono::duration_cast<ms>(now - start_time) > timeout) break;
 
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
+        _recv_packet(recv_buffer);
 
         CLOG("[",
             statuStr(_statu),
@@ -622,23 +1273,165 @@ bool RUDP_C::disconnect()
             ", flags=",
             flagsToStr(recv_buffer),
             ". Resend ACK packet ",
-            fin_packet.header.seq_num);
+            fin_packet->header.seq_num);
 
-        sendto(_sockfd,
-            (const char*)&fin_packet,
-            lenInByte(fin_packet),
-            0,
-            (const struct sockaddr*)&_remote_addr,
-            sizeof(sockaddr_in));
+        _send_to(fin_packet, _remote_addr);
     }
 
     _wakeup = false;
-    if (_wakeup_thread.joinable()) _wakeup_thread.join();
+    if (_wakeup_thread.joinable()) _env->join(_wakeup_thread);
+
+    _shm_ring.release();
+    _shm_mode = false;
+    if (_endpoint) _endpoint->_unroute(this);
+    return true;
+}
+
+uint32_t RUDP_C::current_window() const
+{
+    if (_arq == ArqMode::STOP_AND_WAIT && !_selective()) return 1;
+    if (_cc == CongestionControl::FIXED) return _fixed_window;
+    if (!_selective()) return static_cast<uint32_t>(_cwnd);
+
+    double sum = 0;
+    for (auto& path : _paths) sum += path.cwnd;
+    return static_cast<uint32_t>(sum);
+}
+
+void RUDP_C::add_path(const char* remote_ip, int remote_port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(remote_port);
+    addr.sin_addr.s_addr = inet_addr(remote_ip);
+    _extra_paths.push_back(addr);
+}
+
+void RUDP_C::set_local_fastpath(bool enabled) { _shm_enabled = enabled; }
+
+void RUDP_C::set_compression(bool enabled) { _compress_enabled = enabled; }
+
+void RUDP_C::set_weight(double weight)
+{
+    if (_endpoint) _endpoint->_set_weight(this, weight);
+}
+
+bool RUDP_C::_compress_body(const char* buffer, size_t buffer_size, RUDP_P& packet)
+{
+    if (!_compress) return false;
+    RUDP_Counters::add(_counters.compress_in, buffer_size);
+
+    bool compressed = false;
+    if (_compress_skip)
+        --_compress_skip;
+    else if (buffer_size >= COMPRESS_MIN_SIZE)
+    {
+        // 至少省下1/8才值得让接收方解压
+        auto   start = chrono::steady_clock::now();
+        size_t len   = lzCompress(buffer, buffer_size, packet.body, buffer_size - buffer_size / 8);
+        RUDP_Counters::add(_counters.compress_us,
+            chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+
+        if (len)
+        {
+            compressed             = true;
+            _compress_backoff      = 0;
+            packet.header.data_len = len;
+            SET_CMP(packet);
+        }
+        else
+        {
+            // 数据不可压缩：暂停一段再试，连续失败时加倍暂停长度
+            _compress_backoff = min<uint32_t>(max<uint32_t>(1, _compress_backoff * 2), COMPRESS_MAX_SKIP);
+            _compress_skip    = _compress_backoff;
+        }
+    }
+
+    if (compressed)
+        RUDP_Counters::add(_counters.compress_out, packet.header.data_len);
+    else
+    {
+        RUDP_Counters::add(_counters.compress_out, buffer_size);
+        RUDP_Counters::add(_counters.compress_bypassed);
+    }
+    return compressed;
+}
+
+void RUDP_C::set_max_window(uint32_t max_window)
+{
+    _max_cwnd = max(1.0, static_cast<double>(max_window));
+    _cwnd     = min(_cwnd, _max_cwnd);
+    _trace_cwnd();
+}
+
+void RUDP_C::set_congestion_control(CongestionControl cc) { _cc = cc; }
+
+void RUDP_C::set_arq(ArqMode arq) { _arq = arq; }
+
+void RUDP_C::set_initial_seq(uint32_t isn) { _isn = isn; }
+
+void RUDP_C::flush()
+{
+    // 共享内存通道：等待对端消费完全部报文
+    while (_shm_mode && !_shm_ring.drained()) _idle_wait();
+
+    while (true)
+    {
+        {
+            ReadGuard guard = _send_buffer_lock.read();
+            if (_send_buffer.empty()) break;
+        }
+        _idle_wait();
+    }
+}
 
+bool RUDP_C::recv_reply(uint16_t& type, vector<char>& data, ms timeout)
+{
+    unique_lock<mutex> lk(_reply_mtx);
+    auto               deadline = _env->now() + timeout;
+    while (_replies.empty())
+    {
+        if (_env->now() >= deadline) return false;
+        _env->wait_until(lk, _reply_cv, deadline);
+    }
+    type = _replies.front().first;
+    data = std::move(_replies.front().second);
+    _replies.pop_front();
     return true;
 }
 
-void RUDP_C::send(const char* buffer, size_t buffer_size)
+void RUDP_C::send(const char* buffer, size_t buffer_size, ms lifetime)
+{
+    _send(nullptr, 0, buffer, buffer_size, lifetime, 0, 0);
+}
+
+void RUDP_C::send_message(uint16_t type, const char* buffer, size_t buffer_size, ms lifetime)
+{
+    size_t off = 0;
+    do {
+        size_t len = min<size_t>(BODY_SIZE, buffer_size - off);
+        send_fragment(type, buffer + off, len, off == 0, off + len == buffer_size, lifetime);
+        off += len;
+    } while (off < buffer_size);
+}
+
+void RUDP_C::send_fragment(uint16_t type, const char* buffer, size_t buffer_size, bool first, bool last, ms lifetime)
+{
+    send_fragment(type, nullptr, 0, buffer, buffer_size, first, last, lifetime);
+}
+
+void RUDP_C::send_fragment(uint16_t type, const char* head, size_t head_size, const char* buffer, size_t buffer_size,
+    bool first, bool last, ms lifetime)
+{
+    RUDP_H header;
+    if (first) SET_MSB_H(header);
+    if (last) SET_MSE_H(header);
+    _send(head, head_size, buffer, buffer_size, lifetime, header.flags, type);
+}
+
+void RUDP_C::_send(const char* head, size_t head_size, const char* buffer, size_t buffer_size, ms lifetime,
+    uint16_t flags, uint16_t msg_type)
 {
     if (_statu != RUDP_STATUS::ESTABLISHED)
     {
@@ -646,37 +1439,103 @@ void RUDP_C::send(const char* buffer, size_t buffer_size)
         return;
     }
 
+    // 一个报文容纳不下：共享内存槽位会越界，data_len也只有16位；大消息由send_message拆分
+    if (head_size + buffer_size > BODY_SIZE)
+    {
+        CLOG_ERR(" Payload of ", head_size + buffer_size, " bytes exceeds BODY_SIZE (", BODY_SIZE, "). Dropped.");
+        return;
+    }
+
+    if (_shm_mode)
+    {
+        // 直接在共享内存槽位中构造报文，可靠有序，无需校验和与重传
+        RUDP_P& packet           = _shm_ring.acquire();
+        packet.header            = RUDP_H();
+        packet.header.connect_id = _connect_id;
+        packet.header.seq_num    = _seq_num++;
+        packet.header.data_len   = head_size + buffer_size;
+        packet.header.msg_type   = msg_type;
+        packet.header.flags      = flags;
+        if (head_size) memcpy(packet.body, head, head_size);
+        memcpy(packet.body + head_size, buffer, buffer_size);
+        _shm_ring.publish();
+        return;
+    }
+
+    int path = 0;
     while (true)
     {
         {
             ReadGuard guard = _send_buffer_lock.read();
+            // 选择重传：选RTT最小且窗口有余量的路径；总在途量仍受窗口上限约束
+            // FIXED时总在途量取固定窗口，不再看各路径的cwnd
+            if (_selective())
+            {
+                bool   fixed = _cc == CongestionControl::FIXED;
+                double limit = fixed ? _fixed_window : _max_cwnd;
+                if (_seq_num - _base < limit && (path = _pick_path(fixed)) >= 0) break;
+            }
             // 使用cwnd控制发送窗口
-            if (_seq_num < _base + current_window()) break;
+            else if (_seq_num < _base + current_window())
+                break;
         }
-        this_thread::sleep_for(check_gap);
+        _idle_wait();
     }
 
-    RUDP_P packet;
-    packet.header.connect_id = _connect_id;
-    packet.header.seq_num    = _seq_num++;
-    packet.header.data_len   = buffer_size;
-    memcpy(packet.body, buffer, buffer_size);
-    genCheckSum(packet);
+    // 按负载长度分配，发送缓冲区只持有句柄，重传时不再整包拷贝
+    uint64_t  seq    = _seq_num++;
+    PacketBuf packet = PacketBuf::alloc(sizeof(RUDP_H) + head_size + buffer_size);
+
+    packet->header.connect_id = _connect_id;
+    packet->header.seq_num    = seq;
+    packet->header.data_len   = head_size + buffer_size;
+    packet->header.msg_type   = msg_type;
+    packet->header.flags      = flags;
+
+    // 压缩需要连续的输入，两段负载只在压缩时先拼接，否则各自直接拷入报文
+    vector<char> joined;
+    if (head_size && _compress)
+    {
+        joined.reserve(head_size + buffer_size);
+        joined.insert(joined.end(), head, head + head_size);
+        joined.insert(joined.end(), buffer, buffer + buffer_size);
+        buffer      = joined.data();
+        buffer_size = joined.size();
+        head_size   = 0;
+    }
+    if (!_compress_body(buffer, buffer_size, *packet))
+    {
+        if (head_size) memcpy(packet->body, head, head_size);
+        memcpy(packet->body + head_size, buffer, buffer_size);
+    }
+    genCheckSum(*packet);
 
     {
         WriteGuard guard = _send_buffer_lock.write();
-        SEND(packet);
+        if (_selective())
+        {
+            auto& ent  = _send_buffer[seq];
+            ent.packet = packet;
+            _transmit(seq, ent, path);
+        }
+        else
+            SEND(seq, packet);
+        if (lifetime.count() > 0)
+        {
+            entry& ent   = _send_buffer[seq];
+            ent.deadline = ent.send_time + lifetime;
+        }
     }
 
     CLOG("[",
         statuStr(_statu),
         "] Send packet: connect_id=",
-        packet.header.connect_id,
+        packet->header.connect_id,
         ", seq=",
-        packet.header.seq_num,
+        packet->header.seq_num,
         ", data_len=",
-        packet.header.data_len,
+        packet->header.data_len,
         ", checksum=0x",
-        hex,
-        packet.header.checksum);
+        &hex,
+        packet->header.checksum);
 }
\ No newline at end of file
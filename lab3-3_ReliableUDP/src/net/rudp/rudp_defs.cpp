@@ -2,7 +2,7 @@
 #include <iostream>
 using namespace std;
 
-RUDP_H::RUDP_H() : seq_num(0), ack_num(0), data_len(0), flags(0), checksum(0) {}
+RUDP_H::RUDP_H() : seq_num(0), ack_num(0), data_len(0), msg_type(0), flags(0), checksum(0) {}
 
 uint16_t lenInByte(const RUDP_P& packet) { return sizeof(RUDP_H) + packet.header.data_len; }
 
@@ -57,6 +57,18 @@ std::string flagsToStr(const RUDP_P& p)
     if (CHK_SYN(p)) f += "SYN ";
     if (CHK_ACK(p)) f += "ACK ";
     if (CHK_FIN(p)) f += "FIN ";
+    if (CHK_SHM(p)) f += "SHM ";
+    if (CHK_MP(p)) f += "MP ";
+    if (CHK_FSK(p)) f += "FSK ";
+    if (CHK_SW(p)) f += "SW ";
+    if (CHK_SR(p)) f += "SR ";
+    if (CHK_CMP(p)) f += "CMP ";
+    if (CHK_MSB(p)) f += "MSB ";
+    if (CHK_MSE(p)) f += "MSE ";
+    if (CHK_RES(p)) f += "RES ";
+    if (CHK_DUP(p)) f += "DUP ";
+    if (CHK_ECE(p)) f += "ECE ";
+    if (CHK_APP(p)) f += "APP ";
     if (f.empty()) f = "NONE";
     return f;
 }
@@ -67,6 +79,7 @@ ostream& operator<<(ostream& os, const RUDP_H& header)
        << "seq_num: " << header.seq_num << '\n'
        << "ack_num: " << header.ack_num << '\n'
        << "data_len: " << header.data_len << '\n'
+       << "msg_type: " << header.msg_type << '\n'
        << "flags: 0x" << hex << header.flags << dec << " (";
 
     bool first = true;
@@ -90,6 +103,66 @@ ostream& operator<<(ostream& os, const RUDP_H& header)
         os << (first ? "" : ", ") << "RST";
         first = false;
     }
+    if (CHK_SHM_H(header))
+    {
+        os << (first ? "" : ", ") << "SHM";
+        first = false;
+    }
+    if (CHK_MP_H(header))
+    {
+        os << (first ? "" : ", ") << "MP";
+        first = false;
+    }
+    if (CHK_FSK_H(header))
+    {
+        os << (first ? "" : ", ") << "FSK";
+        first = false;
+    }
+    if (CHK_SW_H(header))
+    {
+        os << (first ? "" : ", ") << "SW";
+        first = false;
+    }
+    if (CHK_SR_H(header))
+    {
+        os << (first ? "" : ", ") << "SR";
+        first = false;
+    }
+    if (CHK_CMP_H(header))
+    {
+        os << (first ? "" : ", ") << "CMP";
+        first = false;
+    }
+    if (CHK_MSB_H(header))
+    {
+        os << (first ? "" : ", ") << "MSB";
+        first = false;
+    }
+    if (CHK_MSE_H(header))
+    {
+        os << (first ? "" : ", ") << "MSE";
+        first = false;
+    }
+    if (CHK_RES_H(header))
+    {
+        os << (first ? "" : ", ") << "RES";
+        first = false;
+    }
+    if (CHK_DUP_H(header))
+    {
+        os << (first ? "" : ", ") << "DUP";
+        first = false;
+    }
+    if (CHK_ECE_H(header))
+    {
+        os << (first ? "" : ", ") << "ECE";
+        first = false;
+    }
+    if (CHK_APP_H(header))
+    {
+        os << (first ? "" : ", ") << "APP";
+        first = false;
+    }
     if (first) os << "NONE";
 
     os << ")\n"
@@ -0,0 +1,244 @@
+#include <net/rudp/rudp_endpoint.h>
+#include <net/rudp/rudp.h>
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+// 端点自己的套接字：沿用RUDP的建套接字、ECN与模拟端口绑定，只开放收发接口
+class RUDP_Endpoint::Socket : public RUDP
+{
+  public:
+    Socket(int port, RUDP_Env* env) : RUDP(port, env) {}
+    virtual ~Socket() override
+    {
+        if (_sockfd != INVALID_SOCKET) CLOSE_SOCKET(_sockfd);
+    }
+
+    using RUDP::_recv_buffer;
+    using RUDP::_send_to;
+    using RUDP::_send_to_self;
+
+  private:
+    virtual void clear_statu() override {}
+    virtual void _wakeup_handler() override {}
+};
+
+RUDP_Endpoint::RUDP_Endpoint(int port, RUDP_Env* env)
+    : _env(env ? env : &RUDP_Env::system()),
+      _port(port),
+      _socket(new Socket(port, _env)),
+      _virtual_time(0),
+      _rate(0),
+      _next_tx{},
+      _running(true)
+{
+    _rx_thread    = _env->spawn([this]() { _rx_loop(); });
+    _timer_thread = _env->spawn([this]() { _timer_loop(); });
+    _tx_thread    = _env->spawn([this]() { _tx_loop(); });
+}
+
+RUDP_Endpoint::~RUDP_Endpoint()
+{
+    {
+        lock_guard<mutex> lk(_mtx);
+        _running = false;
+        _env->notify_all(_tx_cv);
+    }
+    _socket->_send_to_self("", 0);
+    _env->join(_rx_thread);
+    _env->join(_timer_thread);
+    _env->join(_tx_thread);
+}
+
+int RUDP_Endpoint::port() const { return _port; }
+
+RUDP_Env* RUDP_Endpoint::env() const { return _env; }
+
+void RUDP_Endpoint::set_rate(double bytes_per_sec)
+{
+    lock_guard<mutex> lk(_mtx);
+    _rate = max(0.0, bytes_per_sec);
+    _env->notify_all(_tx_cv);
+}
+
+size_t RUDP_Endpoint::connections() const
+{
+    lock_guard<mutex> lk(_mtx);
+    return _flows.size();
+}
+
+void RUDP_Endpoint::_rx_loop()
+{
+    while (_running)
+    {
+        sockaddr_in from;
+        bool        ce;
+        PacketBuf   packet = _socket->_recv_buffer(&from, &ce);
+        if (!_running) break;
+        if (!packet) continue;
+
+        lock_guard<mutex> loop(_loop_mtx);
+        auto              it = _routes.find(packet->header.connect_id);
+        if (it == _routes.end()) continue;  // 不属于任何连接的报文直接丢弃
+
+        RUDP_C* conn = it->second;
+        RUDP_Counters::add(conn->_counters.packets_received);
+        RUDP_Counters::add(conn->_counters.bytes_received, lenInByte(*packet));
+        if (conn->_receiving)
+        {
+            conn->_on_packet(*packet);
+            continue;
+        }
+
+        lock_guard<mutex> lk(_mtx);
+        Flow&             flow = _flows.at(conn);
+        flow.inbox.emplace_back(std::move(packet), from, ce);
+        _env->notify_all(flow.cv);
+    }
+}
+
+void RUDP_Endpoint::_timer_loop()
+{
+    while (_running)
+    {
+        {
+            lock_guard<mutex> loop(_loop_mtx);
+            auto              now = _env->now();
+            for (auto& [key, flow] : _flows)
+            {
+                RUDP_C* conn = flow.conn;
+                if (conn->_resending) conn->_resend_tick();
+
+                // 与独立的拥塞避免线程一样，开始后每隔一个RTT增窗一次
+                if (!conn->_ca_running)
+                    flow.ca_due = {};
+                else if (flow.ca_due == RUDP_Env::time_point{})
+                    flow.ca_due = now + conn->_rtt;
+                else if (now >= flow.ca_due)
+                {
+                    conn->_ca_tick();
+                    flow.ca_due = now + conn->_rtt;
+                }
+            }
+        }
+        _env->sleep_for(check_gap);
+    }
+}
+
+void RUDP_Endpoint::_tx_loop()
+{
+    unique_lock<mutex> lk(_mtx);
+    while (_running)
+    {
+        if (_queue.empty())
+        {
+            _env->wait_until(lk, _tx_cv, RUDP_Env::time_point::max());
+            continue;
+        }
+
+        auto now = _env->now();
+        if (_rate > 0 && now < _next_tx)
+        {
+            _env->wait_until(lk, _tx_cv, _next_tx);
+            continue;
+        }
+
+        // 自计时公平排队：取完成标签最小的报文，系统虚拟时间推进到该标签
+        auto    it      = _queue.begin();
+        Pending pending = std::move(it->second);
+        _virtual_time   = it->first;
+        _queue.erase(it);
+
+        size_t len = lenInByte(*pending.packet);
+        if (_rate > 0)
+            _next_tx = max(_next_tx, now) +
+                       chrono::duration_cast<RUDP_Env::clock::duration>(chrono::duration<double>(len / _rate));
+
+        lk.unlock();
+        _socket->_send_to(*pending.packet, pending.to);
+        lk.lock();
+    }
+}
+
+void RUDP_Endpoint::_attach(RUDP_C* conn)
+{
+    lock_guard<mutex> loop(_loop_mtx);
+    lock_guard<mutex> lk(_mtx);
+    _flows[conn].conn = conn;
+}
+
+void RUDP_Endpoint::_detach(RUDP_C* conn)
+{
+    lock_guard<mutex> loop(_loop_mtx);
+    lock_guard<mutex> lk(_mtx);
+    for (auto it = _routes.begin(); it != _routes.end();)
+        it = it->second == conn ? _routes.erase(it) : next(it);
+    _flows.erase(conn);
+}
+
+bool RUDP_Endpoint::_route(RUDP_C* conn, uint32_t connect_id)
+{
+    lock_guard<mutex> loop(_loop_mtx);
+    return _routes.emplace(connect_id, conn).second;
+}
+
+void RUDP_Endpoint::_unroute(RUDP_C* conn)
+{
+    lock_guard<mutex> loop(_loop_mtx);
+    lock_guard<mutex> lk(_mtx);
+    for (auto it = _routes.begin(); it != _routes.end();)
+        it = it->second == conn ? _routes.erase(it) : next(it);
+    _flows.at(conn).inbox.clear();
+}
+
+void RUDP_Endpoint::_set_weight(RUDP_C* conn, double weight)
+{
+    lock_guard<mutex> lk(_mtx);
+    _flows.at(conn).weight = max(weight, 1e-3);
+}
+
+void RUDP_Endpoint::_submit(const RUDP* conn, const PacketBuf& packet, const sockaddr_in& to)
+{
+    lock_guard<mutex> lk(_mtx);
+    Flow&             flow  = _flows.at(conn);
+    double            start = max(_virtual_time, flow.last_finish);
+    flow.last_finish        = start + lenInByte(*packet) / flow.weight;
+    _queue.emplace(flow.last_finish, Pending{packet, to});
+    _env->notify_all(_tx_cv);
+}
+
+int RUDP_Endpoint::_take(
+    const RUDP* conn, const function<void*(size_t&)>& place, bool sized, sockaddr_in* from, bool* ce)
+{
+    unique_lock<mutex> lk(_mtx);
+    Flow&              flow = _flows.at(conn);
+    while (flow.inbox.empty()) _env->wait_until(lk, flow.cv, RUDP_Env::time_point::max());
+    auto [packet, addr, mark] = std::move(flow.inbox.front());
+    flow.inbox.pop_front();
+    lk.unlock();
+
+    *from      = addr;
+    *ce        = mark;
+    size_t len = packet ? lenInByte(*packet) : 0;
+    size_t cap = sized ? len : sizeof(RUDP_P);
+    void*  dst = place(cap);
+    if (!packet)
+    {
+        memset(dst, 0, min(cap, sizeof(RUDP_H)));
+        return 0;
+    }
+    memcpy(dst, packet.get(), min(len, cap));
+    return static_cast<int>(len);
+}
+
+void RUDP_Endpoint::_wake(const RUDP* conn)
+{
+    lock_guard<mutex> lk(_mtx);
+    Flow&             flow = _flows.at(conn);
+    flow.inbox.emplace_back(PacketBuf(), sockaddr_in{}, false);
+    _env->notify_all(flow.cv);
+}
+
+// 空临界区：收包与定时线程对连接的回调都在_loop_mtx内，拿到锁即说明进行中的回调已结束，
+// 之后它们会看到连接已清掉的_receiving/_resending/_ca_running
+void RUDP_Endpoint::_quiesce() { lock_guard<mutex> loop(_loop_mtx); }
@@ -0,0 +1,32 @@
+#include <net/rudp/rudp_env.h>
+using namespace std;
+
+namespace
+{
+    class SystemEnv : public RUDP_Env
+    {
+      public:
+        bool simulated() const override { return false; }
+
+        time_point now() override { return clock::now(); }
+        void       sleep_for(clock::duration dur) override { this_thread::sleep_for(dur); }
+
+        thread spawn(function<void()> fn) override { return thread(std::move(fn)); }
+        void   join(thread& t) override { t.join(); }
+
+        void wait_until(unique_lock<mutex>& lk, condition_variable& cv, time_point deadline) override
+        {
+            if (deadline == time_point::max())
+                cv.wait(lk);
+            else
+                cv.wait_until(lk, deadline);
+        }
+        void notify_all(condition_variable& cv) override { cv.notify_all(); }
+    };
+}  // namespace
+
+RUDP_Env& RUDP_Env::system()
+{
+    static SystemEnv env;
+    return env;
+}
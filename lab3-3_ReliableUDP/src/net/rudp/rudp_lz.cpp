@@ -0,0 +1,178 @@
+#include <net/rudp/rudp_lz.h>
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+namespace
+{
+    constexpr size_t LAST_LITERALS = 5;  // 结尾固定留作字面量，匹配不会延伸到这里
+    constexpr size_t MAX_OFFSET    = 65535;
+
+    uint32_t read32(const uint8_t* p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint32_t hash32(uint32_t v) { return (v * 2654435761u) >> (32 - LZ_HASH_BITS); }
+
+    // 长度扩展字段占用的字节数
+    size_t extLen(size_t n) { return n >= 15 ? (n - 15) / 255 + 1 : 0; }
+
+    uint8_t* writeExt(uint8_t* op, size_t n)
+    {
+        for (n -= 15; n >= 255; n -= 255) *op++ = 255;
+        *op++ = static_cast<uint8_t>(n);
+        return op;
+    }
+
+    // 写一个序列，match_len为0表示只有字面量的最后一个序列；空间不足返回nullptr
+    uint8_t* writeSequence(
+        uint8_t* op, uint8_t* oend, const uint8_t* lit, size_t lit_len, size_t offset, size_t match_len)
+    {
+        size_t ml   = match_len ? match_len - LZ_MIN_MATCH : 0;
+        size_t need = 1 + extLen(lit_len) + lit_len + (match_len ? 2 + extLen(ml) : 0);
+        if (need > static_cast<size_t>(oend - op)) return nullptr;
+
+        *op++ = static_cast<uint8_t>((min<size_t>(lit_len, 15) << 4) | min<size_t>(ml, 15));
+        if (lit_len >= 15) op = writeExt(op, lit_len);
+        memcpy(op, lit, lit_len);
+        op += lit_len;
+
+        if (match_len)
+        {
+            *op++ = static_cast<uint8_t>(offset & 0xff);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            if (ml >= 15) op = writeExt(op, ml);
+        }
+        return op;
+    }
+
+    // 读取长度扩展字段，越界返回false
+    bool readExt(const uint8_t*& ip, const uint8_t* end, size_t& n)
+    {
+        uint8_t b;
+        do {
+            if (ip >= end) return false;
+            b = *ip++;
+            n += b;
+        } while (b == 255);
+        return true;
+    }
+}  // namespace
+
+size_t lzCompress(const char* src, size_t len, char* dst, size_t cap)
+{
+    const uint8_t* base   = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* ip     = base;
+    const uint8_t* anchor = base;
+    const uint8_t* end    = base + len;
+    uint8_t*       op     = reinterpret_cast<uint8_t*>(dst);
+    uint8_t*       oend   = op + cap;
+
+    if (len >= LZ_MIN_MATCH + LAST_LITERALS)
+    {
+        uint32_t table[1 << LZ_HASH_BITS] = {};
+        const uint8_t* limit = end - LAST_LITERALS;
+
+        while (ip + LZ_MIN_MATCH <= limit)
+        {
+            uint32_t       seq = read32(ip);
+            uint32_t       h   = hash32(seq);
+            const uint8_t* ref = base + table[h];
+            table[h]           = static_cast<uint32_t>(ip - base);
+
+            // 表项可能来自哈希冲突，需核对实际内容
+            if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET || read32(ref) != seq)
+            {
+                ++ip;
+                continue;
+            }
+
+            const uint8_t* m = ip + LZ_MIN_MATCH;
+            const uint8_t* r = ref + LZ_MIN_MATCH;
+            while (m < limit && *m == *r)
+            {
+                ++m;
+                ++r;
+            }
+
+            op = writeSequence(op, oend, anchor, ip - anchor, ip - ref, m - ip);
+            if (!op) return 0;
+            ip = anchor = m;
+        }
+    }
+
+    op = writeSequence(op, oend, anchor, end - anchor, 0, 0);
+    if (!op) return 0;
+    return op - reinterpret_cast<uint8_t*>(dst);
+}
+
+long lzDecompress(const char* src, size_t len, char* dst, size_t cap)
+{
+    const uint8_t* ip   = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end  = ip + len;
+    uint8_t*       base = reinterpret_cast<uint8_t*>(dst);
+    uint8_t*       op   = base;
+    uint8_t*       oend = base + cap;
+
+    while (ip < end)
+    {
+        uint8_t token   = *ip++;
+        size_t  lit_len = token >> 4;
+        if (lit_len == 15 && !readExt(ip, end, lit_len)) return -1;
+        if (lit_len > static_cast<size_t>(end - ip) || lit_len > static_cast<size_t>(oend - op)) return -1;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        // 最后一个序列只有字面量
+        if (ip == end) break;
+
+        if (end - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - base)) return -1;
+
+        size_t match_len = token & 15;
+        if (match_len == 15 && !readExt(ip, end, match_len)) return -1;
+        match_len += LZ_MIN_MATCH;
+        if (match_len > static_cast<size_t>(oend - op)) return -1;
+
+        // 匹配可能与输出重叠(如offset=1的游程)，逐字节复制
+        const uint8_t* ref = op - offset;
+        for (size_t i = 0; i < match_len; ++i) op[i] = ref[i];
+        op += match_len;
+    }
+    return op - base;
+}
+
+long lzDecompressedLen(const char* src, size_t len)
+{
+    const uint8_t* ip  = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end = ip + len;
+    size_t         out = 0;
+
+    while (ip < end)
+    {
+        uint8_t token   = *ip++;
+        size_t  lit_len = token >> 4;
+        if (lit_len == 15 && !readExt(ip, end, lit_len)) return -1;
+        if (lit_len > static_cast<size_t>(end - ip)) return -1;
+        ip += lit_len;
+        out += lit_len;
+
+        if (ip == end) break;
+
+        if (end - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > out) return -1;
+
+        size_t match_len = token & 15;
+        if (match_len == 15 && !readExt(ip, end, match_len)) return -1;
+        out += match_len + LZ_MIN_MATCH;
+    }
+    return static_cast<long>(out);
+}
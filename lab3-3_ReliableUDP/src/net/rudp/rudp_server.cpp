@@ -5,6 +5,7 @@
 #include <thread>
 #include <cassert>
 #include <iomanip>
+#include <cstring>
 #include <common/log.h>
 using namespace std;
 
@@ -20,9 +21,12 @@ namespace
 #define SLOG_WARN(...) LOG_WARN(server_log, __VA_ARGS__)
 #define SLOG_ERR(...) LOG_ERR(server_log, __VA_ARGS__)
 
-RUDP_S::RUDP_S(int port) : RUDP(port) {}
+RUDP_S::RUDP_S(int port, RUDP_Env* env) : RUDP(port, env), _arq(ArqMode::GO_BACK_N), _ack_delay(10), _shm_delivered(0)
+{}
 RUDP_S::~RUDP_S()
 {
+    stop_stats_dump();
+    _uring.close();
     if (_sockfd != INVALID_SOCKET) CLOSE_SOCKET(_sockfd);
 }
 
@@ -39,42 +43,67 @@ void RUDP_S::clear_statu()
     if (_receiving)
     {
         _receiving = false;
-
-        sockaddr_in loopback_addr;
-        ZeroMemory(&loopback_addr, sizeof(loopback_addr));
-        loopback_addr.sin_family      = AF_INET;
-        loopback_addr.sin_port        = htons(_port);
-        loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-
-        string fake = "fake";
-
-        sendto(
-            _sockfd, fake.c_str(), (int)fake.length(), 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
-        _receive_thread.join();
+        _send_to_self("fake", 4);
+        _env->join(_receive_thread);
     }
-    if (_receive_thread.joinable()) _receive_thread.join();
+    if (_receive_thread.joinable()) _env->join(_receive_thread);
 }
 
-void RUDP_S::_receive_handler(callback cb)
+void RUDP_S::_receive_handler(buffer_callback cb)
 {
-    size_t left_packet = 0;
-    size_t cnt         = 0;
-    RUDP_P send_buffer;
+    size_t      left_packet = 0;
+    size_t      cnt         = 0;
+    PacketBuf   recv_packet;
+    sockaddr_in recv_from;
+    bool        recv_ce = false;
 
-    map<uint32_t, RUDP_P> oOO_buffer;
-    ReWrLock              oOO_lock;
+    map<uint64_t, PacketBuf> oOO_buffer;  // 乱序报文只缓存句柄
+    ReWrLock                 oOO_lock;
 
     // 延迟ACK相关变量
     mutex                ack_mutex;
     condition_variable   ack_cv;
     bool                 ack_timer_running = false;
     bool                 ack_needed        = false;
+    bool                 ce_pending        = false;  // 上次确认后收到过CE标记的报文，下一个ACK带ECE
     thread               ack_thread;
     bool                 stop_ack_thread = false;
-    chrono::milliseconds ack_delay(10);  // 10ms延迟ACK时间
+    chrono::milliseconds ack_delay = _latency_mode ? ms(0) : _ack_delay;  // 延迟模式下逐包立即确认
     uint32_t             last_answered_ack = 0;
     uint32_t             ack_times         = 0;
 
+    // 压缩报文在交付或缓存前解压到按原始长度分配的新缓冲区，回调看到的总是原始负载
+    auto inflate = [&](PacketBuf& packet) {
+        auto start = chrono::steady_clock::now();
+        long len   = lzDecompressedLen(packet->body, packet->header.data_len);
+        if (len < 0 || len > static_cast<long>(BODY_SIZE)) return false;
+        PacketBuf out = PacketBuf::alloc(sizeof(RUDP_H) + len + 1);
+        out->header   = packet->header;
+        len           = lzDecompress(packet->body, packet->header.data_len, out->body, len);
+        RUDP_Counters::add(
+            _counters.decompress_us, chrono::duration_cast<us>(chrono::steady_clock::now() - start).count());
+        if (len < 0) return false;
+        out->header.data_len = len;
+        packet               = std::move(out);
+        return true;
+    };
+
+    // 确认报文只有报头加回显的序号，不必占用整个RUDP_P
+    auto new_ack = [&]() {
+        PacketBuf ack          = PacketBuf::alloc(sizeof(RUDP_H) + sizeof(uint32_t));
+        ack->header.connect_id = _connect_id;
+        ack->header.seq_num    = _seq_num++;
+        ack->header.ack_num    = _ack_num;
+        SET_ACK(*ack);
+        if (ce_pending) SET_ECE(*ack);
+        ce_pending = false;
+        return ack;
+    };
+
+    // 交付速率测量，配合握手RTT自动调整接收缓冲区
+    size_t delivered_bytes = 0;
+    auto   rate_start      = _env->now();
+
     auto ack_sender = [&]() {
         unique_lock<mutex> lk(ack_mutex);
         while (!stop_ack_thread)
@@ -82,61 +111,52 @@ void RUDP_S::_receive_handler(callback cb)
             if (!ack_needed)
             {
                 // 没有需要发送的ACK，等待有新的ACK需要发送
-                ack_cv.wait(lk, [&]() { return ack_needed || stop_ack_thread; });
+                while (!ack_needed && !stop_ack_thread) _env->wait_until(lk, ack_cv, RUDP_Env::time_point::max());
             }
             else
             {
                 // 已有需要发送的ACK，开始延迟计时
-                auto deadline   = chrono::steady_clock::now() + ack_delay;
-                bool no_new_ack = ack_cv.wait_until(lk, deadline, [&]() { return !ack_needed || stop_ack_thread; });
-                // no_new_ack == false 表示超时了，没有新的包推动ack_needed清空
+                auto deadline = _env->now() + ack_delay;
+                while (ack_needed && !stop_ack_thread && _env->now() < deadline)
+                    _env->wait_until(lk, ack_cv, deadline);
+                // 仍需发送说明超时了，没有新的包推动ack_needed清空
                 if (!stop_ack_thread && ack_needed)
                 {
                     // 超时未有新包到来，发送ACK
                     ack_needed = false;
                     // 发送ACK包
-                    RUDP_P send_buffer;
-                    send_buffer.header.connect_id = _connect_id;
-                    send_buffer.header.seq_num    = _seq_num++;
-                    send_buffer.header.ack_num    = _ack_num;
-                    SET_ACK(send_buffer);
-                    genCheckSum(send_buffer);
-                    sendto(_sockfd,
-                        (const char*)&send_buffer,
-                        lenInByte(send_buffer),
-                        0,
-                        (const struct sockaddr*)&_remote_addr,
-                        sizeof(sockaddr_in));
+                    PacketBuf send_buffer = new_ack();
+                    genCheckSum(*send_buffer);
+                    _send_to(*send_buffer, _remote_addr);
                     SLOG("[", statuStr(_statu), "] Delayed ACK sent: ack_num=", _ack_num);
                 }
             }
         }
     };
-    ack_thread = thread(ack_sender);
+    ack_thread = _env->spawn(ack_sender);
 
-    auto trigger_ack = [&](bool immediate = false) {
+    // duplicate为真表示触发本次ACK的报文此前已收到过，发送方据此识别不必要的重传
+    auto trigger_ack = [&](bool immediate = false, bool duplicate = false) {
         lock_guard<mutex> lk(ack_mutex);
-        if (immediate)
+        if (immediate || ack_delay.count() == 0)
         {
-            ack_needed = false;
-            RUDP_P send_buffer;
-            send_buffer.header.connect_id = _connect_id;
-            send_buffer.header.seq_num    = _seq_num++;
-            send_buffer.header.ack_num    = _ack_num;
-            SET_ACK(send_buffer);
-            genCheckSum(send_buffer);
-            sendto(_sockfd,
-                (const char*)&send_buffer,
-                lenInByte(send_buffer),
-                0,
-                (const struct sockaddr*)&_remote_addr,
-                sizeof(sockaddr_in));
+            ack_needed            = false;
+            PacketBuf send_buffer = new_ack();
+            if (duplicate) SET_DUP(*send_buffer);
+            if (_arq == ArqMode::SELECTIVE_REPEAT || duplicate)
+            {
+                // 选择重传：回显触发本次ACK的序号，并沿该报文到达的路径返回
+                memcpy(send_buffer->body, &recv_packet->header.seq_num, sizeof(uint32_t));
+                send_buffer->header.data_len = sizeof(uint32_t);
+            }
+            genCheckSum(*send_buffer);
+            _send_to(*send_buffer, _arq == ArqMode::SELECTIVE_REPEAT ? recv_from : _remote_addr);
             SLOG("[", statuStr(_statu), "] Immediate ACK sent: ack_num=", _ack_num);
         }
         else if (!ack_needed)
         {
             ack_needed = true;
-            ack_cv.notify_all();
+            _env->notify_all(ack_cv);
         }
     };
 
@@ -147,14 +167,14 @@ void RUDP_S::_receive_handler(callback cb)
             auto it = oOO_buffer.find(_ack_num);
             if (it != oOO_buffer.end())
             {
-                RUDP_P& packet = it->second;
-                SLOG("[",
-                    statuStr(_statu),
-                    "] Deliver queued packet seq=",
-                    packet.header.seq_num,
-                    ", now ack_num=",
-                    _ack_num + 1);
-                cb(packet);
+                // 空句柄表示该报文已提前交付，只推进序号
+                const PacketBuf& packet = it->second;
+                SLOG("[", statuStr(_statu), "] Deliver queued packet seq=", it->first, ", now ack_num=", _ack_num + 1);
+                if (packet)
+                {
+                    cb(packet);
+                    delivered_bytes += packet->header.data_len;
+                }
                 oOO_buffer.erase(it);
                 ++_ack_num;
                 ++cnt;
@@ -166,38 +186,45 @@ void RUDP_S::_receive_handler(callback cb)
 
     while (true)
     {
-        if (left_packet == 0)
+        if (_latency_mode)
         {
+            // 延迟模式：由本线程直接收包，不经接收队列
+            recv_packet = _recv_buffer(&recv_from, &recv_ce);
+            if (uint32_t drops = _take_kernel_drops())
+                SLOG_WARN(
+                    "[", statuStr(_statu), "] Kernel receive queue overflow, ", drops, " datagrams dropped locally.");
+            if (!recv_packet) continue;
+        }
+        else
+        {
+            if (left_packet == 0)
             {
                 ReadGuard guard = _recv_queue_lock.read();
                 left_packet     = _recv_queue.size();
             }
-        }
-        if (left_packet == 0)
-        {
-            this_thread::sleep_for(check_gap);
-            continue;
-        }
+            if (left_packet == 0)
+            {
+                _env->sleep_for(check_gap);
+                continue;
+            }
 
-        --left_packet;
-        RUDP_P recv_packet;
-        {
-            WriteGuard guard = _recv_queue_lock.write();
-            recv_packet      = _recv_queue.front();
+            --left_packet;
+            WriteGuard guard                     = _recv_queue_lock.write();
+            tie(recv_packet, recv_from, recv_ce) = std::move(_recv_queue.front());
             _recv_queue.pop_front();
         }
 
-        if (!checkCheckSum(recv_packet))
+        if (!checkCheckSum(*recv_packet))
         {
             SLOG_WARN("[", statuStr(_statu), "] Received corrupted packet (wrong checksum). Dropping.");
             continue;
         }
-        if (recv_packet.header.connect_id != _connect_id)
+        if (recv_packet->header.connect_id != _connect_id)
         {
             SLOG_WARN("[",
                 statuStr(_statu),
                 "] Received packet with unexpected connect_id=",
-                recv_packet.header.connect_id,
+                recv_packet->header.connect_id,
                 ", expected=",
                 _connect_id,
                 ". Dropping.");
@@ -207,43 +234,77 @@ void RUDP_S::_receive_handler(callback cb)
         SLOG("[",
             statuStr(_statu),
             "] Received packet: connect_id=",
-            recv_packet.header.connect_id,
+            recv_packet->header.connect_id,
             ", seq=",
-            recv_packet.header.seq_num,
+            recv_packet->header.seq_num,
             ", ack=",
-            recv_packet.header.ack_num,
+            recv_packet->header.ack_num,
             ", flags=",
-            flagsToStr(recv_packet),
+            flagsToStr(*recv_packet),
             ", data_len=",
-            recv_packet.header.data_len);
+            recv_packet->header.data_len);
 
         // FIN处理
-        if (CHK_FIN(recv_packet))
+        if (CHK_FIN(*recv_packet))
         {
             SLOG("[",
                 statuStr(_statu),
                 "] Received FIN packet seq=",
-                recv_packet.header.seq_num,
+                recv_packet->header.seq_num,
                 ", ack_num=",
-                recv_packet.header.ack_num,
+                recv_packet->header.ack_num,
                 ". Prepare to close.");
-            _ack_num   = recv_packet.header.seq_num + 1;
+            // FIN排在共享内存上的全部报文之后，先让它们交付完，此后_ack_num只由本线程修改
+            _stop_shm();
+            _ack_num   = seqExtend(recv_packet->header.seq_num, _ack_num) + 1;
             _receiving = false;
-
-            sockaddr_in loopback_addr;
-            ZeroMemory(&loopback_addr, sizeof(loopback_addr));
-            loopback_addr.sin_family      = AF_INET;
-            loopback_addr.sin_port        = htons(_port);
-            loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-            string      fake              = "fake";
-            const char* fake_c            = fake.c_str();
-            int         len               = (int)fake.length();
-            sendto(_sockfd, fake_c, len, 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
+            if (!_latency_mode) _send_to_self("fake", 4);
 
             break;
         }
 
-        uint32_t seq_num = recv_packet.header.seq_num;
+        // 前向跳过：发送方已放弃[_ack_num, skip_to)中未送达的报文
+        if (CHK_FSK(*recv_packet))
+        {
+            uint64_t skip_to = seqExtend(recv_packet->header.ack_num, _ack_num);
+            if (skip_to > _ack_num)
+            {
+                SLOG("[", statuStr(_statu), "] Forward skip from ack_num=", _ack_num, " to ", skip_to);
+                {
+                    // 已缓存的报文照常交付，缺失的直接跳过
+                    WriteGuard guard(oOO_lock.write());
+                    for (auto it = oOO_buffer.begin(); it != oOO_buffer.end() && it->first < skip_to;)
+                    {
+                        if (it->second)
+                        {
+                            cb(it->second);
+                            delivered_bytes += it->second->header.data_len;
+                        }
+                        it = oOO_buffer.erase(it);
+                    }
+                }
+                _ack_num = skip_to;
+                deliver_in_order();
+            }
+            trigger_ack(true);
+            continue;
+        }
+
+        // 途中拥塞的标记记到下一个ACK上回显，延迟确认合并的多个报文只回显一次
+        if (recv_ce)
+        {
+            RUDP_Counters::add(_counters.ce_received);
+            lock_guard<mutex> lk(ack_mutex);
+            ce_pending = true;
+        }
+
+        uint64_t seq_num = seqExtend(recv_packet->header.seq_num, _ack_num);
+
+        if (CHK_CMP(*recv_packet) && seq_num >= _ack_num && !inflate(recv_packet))
+        {
+            SLOG_WARN("[", statuStr(_statu), "] Failed to decompress packet seq=", seq_num, ". Dropping.");
+            continue;
+        }
 
         if (seq_num < _ack_num)
         {
@@ -255,7 +316,7 @@ void RUDP_S::_receive_handler(callback cb)
                 " (current ack_num=",
                 _ack_num,
                 "), resend ACK immediately");
-            trigger_ack(true);
+            trigger_ack(true, true);
         }
         else if (seq_num == _ack_num)
         {
@@ -266,16 +327,41 @@ void RUDP_S::_receive_handler(callback cb)
                 ". Deliver and ack_num=",
                 _ack_num + 1);
             cb(recv_packet);
+            delivered_bytes += recv_packet->header.data_len;
             ++_ack_num;
             deliver_in_order();
-            trigger_ack(false);
+            trigger_ack(_arq != ArqMode::GO_BACK_N || recv_ce);
+
+            auto elapsed = chrono::duration_cast<ms>(_env->now() - rate_start);
+            if (elapsed >= max(_rtt, check_gap))
+            {
+                size_t old_buf = _sock_buf;
+                _autotune_sock_buf(_rtt, delivered_bytes * 1000.0 / elapsed.count());
+                if (_sock_buf != old_buf)
+                    SLOG("[",
+                        statuStr(_statu),
+                        "] Delivery rate ",
+                        _delivery_rate,
+                        " B/s, RTT=",
+                        _rtt.count(),
+                        "ms, socket buffer grows to ",
+                        _sock_buf,
+                        " bytes");
+                delivered_bytes = 0;
+                rate_start      = _env->now();
+            }
         }
         else
         {
+            bool duplicate;
             {
+                // 应用接手的报文不占重排缓冲区，只留空句柄占住序号
                 WriteGuard guard(oOO_lock.write());
-                oOO_buffer.insert({seq_num, recv_packet});
+                auto [it, inserted] = oOO_buffer.emplace(seq_num, PacketBuf());
+                duplicate           = !inserted;
+                if (inserted && !(_early && _early(recv_packet))) it->second = recv_packet;
             }
+            RUDP_Counters::add(_counters.out_of_order);
 
             SLOG("[",
                 statuStr(_statu),
@@ -284,88 +370,104 @@ void RUDP_S::_receive_handler(callback cb)
                 " (expecting ",
                 _ack_num,
                 "), immediate ACK to signal sender.");
-            trigger_ack(true);
+            trigger_ack(true, duplicate);
         }
-
-        memset(&recv_packet, 0, sizeof(RUDP_H));
     }
 
     {
         lock_guard<mutex> lk(ack_mutex);
         stop_ack_thread = true;
-        ack_cv.notify_all();
+        _env->notify_all(ack_cv);
     }
-    ack_thread.join();
+    _env->join(ack_thread);
 }
 
 void RUDP_S::_wakeup_handler()
 {
-    sockaddr_in loopback_addr;
-    ZeroMemory(&loopback_addr, sizeof(loopback_addr));
-    loopback_addr.sin_family      = AF_INET;
-    loopback_addr.sin_port        = htons(_port);
-    loopback_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-    string      fake              = "fake";
-    const char* fake_c            = fake.c_str();
-    int         len               = (int)fake.length();
-
     while (_wakeup)
     {
-        this_thread::sleep_for(ms(GUESS_RTT * 2));
-        sendto(_sockfd, fake_c, len, 0, (const struct sockaddr*)&loopback_addr, sizeof(sockaddr_in));
+        _env->sleep_for(ms(GUESS_RTT * 2));
+        _send_to_self("fake", 4);
     }
 }
 
 void RUDP_S::_listen()
 {
-    RUDP_P    recv_buffer;
-    socklen_t addr_len = sizeof(sockaddr_in);
-
     while (true)
     {
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&_remote_addr, &addr_len);
+        PacketBuf recv_buffer = _recv_buffer(&_remote_addr);
+        if (!recv_buffer) continue;
 
-        if (!checkCheckSum(recv_buffer))
+        if (!checkCheckSum(*recv_buffer))
         {
             SLOG_WARN("[", statuStr(_statu), "] Received corrupted packet in LISTEN state. Dropping.");
             continue;
         }
 
-        if (!CHK_SYN(recv_buffer))
+        if (!CHK_SYN(*recv_buffer))
         {
             SLOG_WARN("[", statuStr(_statu), "] Received packet without SYN in LISTEN state. Dropping.");
             continue;
         }
 
-        if (CHK_ACK(recv_buffer))
+        if (CHK_ACK(*recv_buffer))
         {
             SLOG_WARN("[", statuStr(_statu), "] Received ACK packet in LISTEN state. Dropping.");
             continue;
         }
 
-        _connect_id = recv_buffer.header.connect_id;
+        _connect_id = recv_buffer->header.connect_id;
+        _counters.reset();
         SLOG("[",
             statuStr(_statu),
             "] Received SYN packet: connect_id=",
             _connect_id,
             ", seq=",
-            recv_buffer.header.seq_num,
+            recv_buffer->header.seq_num,
             ". Sending SYN_ACK.");
 
-        RUDP_P send_buffer;
-        send_buffer.header.connect_id = _connect_id;
-        send_buffer.header.seq_num    = _seq_num++;
-        send_buffer.header.ack_num    = recv_buffer.header.seq_num + 1;
-        SET_SYN(send_buffer);
-        SET_ACK(send_buffer);
-        genCheckSum(send_buffer);
-
-        sendto(_sockfd,
-            (const char*)&send_buffer,
-            lenInByte(send_buffer),
-            0,
-            (const struct sockaddr*)&_remote_addr,
-            sizeof(sockaddr_in));
+        PacketBuf send_buffer          = PacketBuf::alloc(sizeof(RUDP_H) + sizeof(RUDP_TOKEN));
+        send_buffer->header.connect_id = _connect_id;
+        send_buffer->header.seq_num    = _seq_num++;
+        send_buffer->header.ack_num    = recv_buffer->header.seq_num + 1;
+        SET_SYN(*send_buffer);
+        SET_ACK(*send_buffer);
+
+        // 选择重传(含多路径)需要逐包确认来定位丢包；停等协议每个报文都立即确认
+        if (CHK_MP(*recv_buffer) || CHK_SR(*recv_buffer))
+            _arq = ArqMode::SELECTIVE_REPEAT;
+        else if (CHK_SW(*recv_buffer))
+            _arq = ArqMode::STOP_AND_WAIT;
+        else
+            _arq = ArqMode::GO_BACK_N;
+
+        // 对端在同一主机且能映射其memfd时接受共享内存通道，否则照常走UDP
+        _shm_mode = CHK_SHM(*recv_buffer) && recv_buffer->header.data_len == sizeof(RUDP_SHM_OFFER) &&
+                    _shm_ring.attach(*reinterpret_cast<RUDP_SHM_OFFER*>(recv_buffer->body));
+        if (_shm_mode)
+        {
+            SET_SHM(*send_buffer);
+            SLOG("[", statuStr(_statu), "] Peer is co-located, accept shared memory fast path.");
+        }
+        // 总是接受压缩，数据报文是否压缩由发送方逐个标记
+        if (CHK_CMP(*recv_buffer)) SET_CMP(*send_buffer);
+
+        // 令牌绑定对端地址且只能兑现一次，有效时跳过SYN_RCVD，SYN之后的数据报文可直接交付
+        uint64_t now_ms  = chrono::duration_cast<ms>(_env->now().time_since_epoch()).count();
+        bool     resumed = CHK_RES(*recv_buffer) && !_shm_mode &&
+                       recv_buffer->header.data_len == sizeof(RUDP_TOKEN) &&
+                       _tokens.redeem(*reinterpret_cast<RUDP_TOKEN*>(recv_buffer->body),
+                           _remote_addr.sin_addr.s_addr,
+                           now_ms);
+        if (resumed) SET_RES(*send_buffer);
+        RUDP_TOKEN token = _tokens.issue(_remote_addr.sin_addr.s_addr, now_ms);
+        memcpy(send_buffer->body, &token, sizeof(token));
+        send_buffer->header.data_len = sizeof(token);
+        genCheckSum(*send_buffer);
+
+        _send_to(*send_buffer, _remote_addr);
+        _syn_ack      = send_buffer;
+        _syn_ack_time = _env->now();
 
         SLOG("[",
             statuStr(_statu),
@@ -374,6 +476,14 @@ void RUDP_S::_listen()
             ":",
             ntohs(_remote_addr.sin_port));
 
+        if (resumed)
+        {
+            _statu   = RUDP_STATUS::ESTABLISHED;
+            _ack_num = SEQ_EPOCH + recv_buffer->header.seq_num + 1;
+            SLOG(" Resumption token accepted, change status to ESTABLISHED (0-RTT).");
+            break;
+        }
+
         _statu = RUDP_STATUS::SYN_RCVD;
         SLOG(" Change status to SYN_RCVD.");
         break;
@@ -382,98 +492,142 @@ void RUDP_S::_listen()
 
 void RUDP_S::_syn_rcvd()
 {
-    RUDP_P      recv_buffer;
-    sockaddr_in tmp_addr;
-    socklen_t   addr_len = sizeof(sockaddr_in);
-
     while (true)
     {
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
+        PacketBuf recv_buffer = _recv_buffer();
+        if (!recv_buffer) continue;
 
-        if (!checkCheckSum(recv_buffer))
+        if (!checkCheckSum(*recv_buffer))
         {
             SLOG_WARN("[", statuStr(_statu), "] Received corrupted packet in SYN_RCVD. Dropping.");
             continue;
         }
 
-        if (recv_buffer.header.connect_id != _connect_id)
+        if (recv_buffer->header.connect_id != _connect_id)
         {
             SLOG_WARN("[", statuStr(_statu), "] Wrong connect_id in SYN_RCVD. Dropping.");
             continue;
         }
 
-        if (CHK_ACK(recv_buffer))
+        if (!CHK_ACK(*recv_buffer))
+        {
+            // SYN重传或令牌被拒后的0-RTT数据：SYN_ACK可能丢失，重发一次
+            SLOG("[", statuStr(_statu), "] Received non-ACK packet in SYN_RCVD, resend SYN_ACK.");
+            _send_to(*_syn_ack, _remote_addr);
+            continue;
+        }
+
+        if (CHK_ACK(*recv_buffer))
         {
             SLOG("[",
                 statuStr(_statu),
                 "] Received ACK packet: seq=",
-                recv_buffer.header.seq_num,
+                recv_buffer->header.seq_num,
                 ", ack=",
-                recv_buffer.header.ack_num,
+                recv_buffer->header.ack_num,
                 ". Connection established.");
             _statu   = RUDP_STATUS::ESTABLISHED;
-            _ack_num = recv_buffer.header.seq_num + 1;
-
-            SLOG(" Connection established, change status to ESTABLISHED.");
-
-            RUDP_P ack_packet;
-            ack_packet.header.connect_id = _connect_id;
-            ack_packet.header.seq_num    = _seq_num++;
-            ack_packet.header.ack_num    = recv_buffer.header.seq_num + 1;
-            SET_ACK(ack_packet);
-            genCheckSum(ack_packet);
-            sendto(_sockfd,
-                (const char*)&ack_packet,
-                lenInByte(ack_packet),
-                0,
-                (const struct sockaddr*)&_remote_addr,
-                sizeof(sockaddr_in));
+            _ack_num = SEQ_EPOCH + recv_buffer->header.seq_num + 1;
+
+            // 以SYN_ACK到最终ACK的间隔作为初始RTT，用于缓冲区调优
+            _rtt = max(ms(1), chrono::duration_cast<ms>(_env->now() - _syn_ack_time));
+            _counters.recordRtt(_rtt);
+            _publish_rtt(_rtt, _dev_rtt);
+
+            SLOG(" Connection established, change status to ESTABLISHED. Handshake RTT=", _rtt.count(), "ms");
+
+            PacketBuf ack_packet          = PacketBuf::alloc(sizeof(RUDP_H));
+            ack_packet->header.connect_id = _connect_id;
+            ack_packet->header.seq_num    = _seq_num++;
+            ack_packet->header.ack_num    = recv_buffer->header.seq_num + 1;
+            SET_ACK(*ack_packet);
+            genCheckSum(*ack_packet);
+            _send_to(*ack_packet, _remote_addr);
 
             break;
         }
     }
 }
 
-void RUDP_S::_established(callback cb)
+void RUDP_S::_established(const buffer_callback& cb, const callback& shm_cb)
 {
-    RUDP_P      recv_buffer;
-    sockaddr_in tmp_addr;
-    socklen_t   addr_len = sizeof(sockaddr_in);
-
-    _receiving      = true;
-    _receive_thread = thread(&RUDP_S::_receive_handler, this, cb);
-    do {
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
-        {
-            WriteGuard guard = _recv_queue_lock.write();
-            _recv_queue.push_back(recv_buffer);
-        }
-    } while (_receiving);
+    PacketBuf   recv_buffer;
+    sockaddr_in recv_from;
+    bool        recv_ce;
+
+    _receiving = true;
+    if (!_latency_mode) _receive_thread = _env->spawn([this, cb]() { _receive_handler(cb); });
+    if (_shm_mode)
+    {
+        // 数据经共享内存按序到达，直接交付；UDP只用于连接管理
+        _shm_delivered = 0;
+        _shm_thread    = _env->spawn([this, shm_cb]() {
+            while (_shm_ring.consume([&](RUDP_P& packet) {
+                shm_cb(packet);
+                ++_shm_delivered;
+            }));
+        });
+    }
+    if (_latency_mode)
+    {
+        // 收包与协议处理都在本线程完成，直到收到FIN
+        _pin_to_core();
+        _receive_handler(cb);
+    }
+    else
+    {
+        do {
+            recv_buffer = _recv_buffer(&recv_from, &recv_ce);
+            if (uint32_t drops = _take_kernel_drops())
+                SLOG_WARN(
+                    "[", statuStr(_statu), "] Kernel receive queue overflow, ", drops, " datagrams dropped locally.");
+            // 唤醒报文只用于让本循环检查_receiving，不入队
+            if (!recv_buffer) continue;
+            {
+                WriteGuard guard = _recv_queue_lock.write();
+                _recv_queue.emplace_back(std::move(recv_buffer), recv_from, recv_ce);
+            }
+        } while (_receiving);
 
-    _receive_thread.join();
+        _env->join(_receive_thread);
+    }
+
+    if (_shm_mode)
+    {
+        _stop_shm();
+        _shm_ring.release();
+        _shm_mode = false;
+    }
 
     _statu = RUDP_STATUS::FIN_RCVD;
-    SLOG(" Change status to FIN_RCVD.");
+    SLOG(" Change status to FIN_RCVD. Kernel drops in total: ", kernelDrops(), ", socket buffer: ", _sock_buf, " bytes");
+}
+
+void RUDP_S::_stop_shm()
+{
+    if (!_shm_thread.joinable()) return;
+    _shm_ring.close();
+    _env->join(_shm_thread);
+    _ack_num += _shm_delivered;
+    _shm_delivered = 0;
 }
 
 void RUDP_S::_fin_rcvd()
 {
-    RUDP_P fin_ack_p;
-    fin_ack_p.header.connect_id = _connect_id;
-    fin_ack_p.header.seq_num    = _seq_num++;
-    fin_ack_p.header.ack_num    = _ack_num;
-    SET_ACK(fin_ack_p);
-    SET_FIN(fin_ack_p);
-    genCheckSum(fin_ack_p);
-
-    RUDP_P      recv_buffer;
-    sockaddr_in tmp_addr;
-    socklen_t   addr_len = sizeof(sockaddr_in);
-
-    bool flag      = true;
-    _wakeup_thread = std::thread([&]() {
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+    PacketBuf fin_ack_p          = PacketBuf::alloc(sizeof(RUDP_H));
+    fin_ack_p->header.connect_id = _connect_id;
+    fin_ack_p->header.seq_num    = _seq_num++;
+    fin_ack_p->header.ack_num    = _ack_num;
+    SET_ACK(*fin_ack_p);
+    SET_FIN(*fin_ack_p);
+    genCheckSum(*fin_ack_p);
+
+    // 2s后结束等待；同时给自己发一个报文，避免最后的ACK丢失时一直阻塞在收包上
+    atomic<bool> flag = true;
+    _wakeup_thread    = _env->spawn([&]() {
+        _env->sleep_for(std::chrono::seconds(2));
         flag = false;
+        _send_to_self("fake", 4);
     });
 
     while (flag)
@@ -481,35 +635,34 @@ void RUDP_S::_fin_rcvd()
         SLOG("[",
             statuStr(_statu),
             "] Send FIN_ACK packet seq=",
-            fin_ack_p.header.seq_num,
+            fin_ack_p->header.seq_num,
             ", ack=",
-            fin_ack_p.header.ack_num);
+            fin_ack_p->header.ack_num);
 
-        sendto(_sockfd,
-            (const char*)&fin_ack_p,
-            lenInByte(fin_ack_p),
-            0,
-            (const struct sockaddr*)&_remote_addr,
-            sizeof(sockaddr_in));
+        _send_to(*fin_ack_p, _remote_addr);
 
-        recvfrom(_sockfd, (char*)&recv_buffer, sizeof(RUDP_P), 0, (struct sockaddr*)&tmp_addr, &addr_len);
+        PacketBuf recv_buffer = _recv_buffer();
+        if (!recv_buffer) continue;
 
-        if (!checkCheckSum(recv_buffer))
+        if (!checkCheckSum(*recv_buffer))
         {
             SLOG_WARN("[", statuStr(_statu), "] Corrupted packet after FIN sent. Dropping.");
             continue;
         }
 
-        if (recv_buffer.header.connect_id != _connect_id)
+        if (recv_buffer->header.connect_id != _connect_id)
         {
             SLOG_WARN("[", statuStr(_statu), "] Wrong connect_id after FIN sent. Dropping.");
             continue;
         }
 
-        if (CHK_ACK(recv_buffer) && !CHK_FIN(recv_buffer))
+        if (CHK_ACK(*recv_buffer) && !CHK_FIN(*recv_buffer))
         {
-            SLOG(
-                "[", statuStr(_statu), "] Received last ACK packet seq=", recv_buffer.header.seq_num, ", final close.");
+            SLOG("[",
+                statuStr(_statu),
+                "] Received last ACK packet seq=",
+                recv_buffer->header.seq_num,
+                ", final close.");
             _statu = RUDP_STATUS::CLOSED;
             SLOG(" Change status to CLOSED.");
             break;
@@ -522,10 +675,54 @@ void RUDP_S::_fin_rcvd()
         _statu = RUDP_STATUS::CLOSED;
     }
 
-    _wakeup_thread.join();
+    _env->join(_wakeup_thread);
+}
+
+void RUDP_S::set_ack_delay(ms delay) { _ack_delay = delay; }
+
+void RUDP_S::set_early_delivery(early_callback cb) { _early = std::move(cb); }
+
+void RUDP_S::reply(uint16_t type, const char* buffer, size_t buffer_size)
+{
+    if (_statu != RUDP_STATUS::ESTABLISHED || buffer_size > BODY_SIZE) return;
+
+    PacketBuf packet          = PacketBuf::alloc(sizeof(RUDP_H) + buffer_size);
+    packet->header.connect_id = _connect_id;
+    packet->header.data_len   = buffer_size;
+    packet->header.msg_type   = type;
+    SET_APP(*packet);
+    memcpy(packet->body, buffer, buffer_size);
+    genCheckSum(*packet);
+    _send_to(*packet, _remote_addr);
+    SLOG("[", statuStr(_statu), "] Reply sent: type=", type, ", data_len=", buffer_size);
+}
+
+void RUDP_S::listen(message_callback cb)
+{
+    listen([cb](RUDP_P& packet) {
+        cb(RUDP_Message{packet.header.msg_type,
+            {packet.body, packet.header.data_len},
+            CHK_MSB(packet) != 0,
+            CHK_MSE(packet) != 0});
+    });
 }
 
 void RUDP_S::listen(callback cb)
+{
+    _serve([cb](const PacketBuf& packet) { cb(*packet); }, cb);
+}
+
+void RUDP_S::listen(buffer_callback cb)
+{
+    // 共享内存槽位在回调返回后即被复用，只有这里需要把负载拷出到缓冲区
+    _serve(cb, [cb](RUDP_P& packet) {
+        PacketBuf copy = PacketBuf::alloc(lenInByte(packet) + 1);
+        memcpy(copy.get(), &packet, lenInByte(packet));
+        cb(copy);
+    });
+}
+
+void RUDP_S::_serve(const buffer_callback& cb, const callback& shm_cb)
 {
     _statu = RUDP_STATUS::LISTEN;
     SLOG(" Enter listen mode, change status to LISTEN.");
@@ -537,7 +734,7 @@ void RUDP_S::listen(callback cb)
             case RUDP_STATUS::CLOSED: return;
             case RUDP_STATUS::LISTEN: _listen(); break;
             case RUDP_STATUS::SYN_RCVD: _syn_rcvd(); break;
-            case RUDP_STATUS::ESTABLISHED: _established(cb); break;
+            case RUDP_STATUS::ESTABLISHED: _established(cb, shm_cb); break;
             case RUDP_STATUS::FIN_RCVD: _fin_rcvd(); break;
             default: assert(false);
         }
@@ -0,0 +1,222 @@
+#include <net/rudp/rudp_shm.h>
+#include <fstream>
+#include <random>
+#include <cstring>
+#include <new>
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#include <ctime>
+#endif
+using namespace std;
+
+namespace
+{
+#ifdef __linux__
+    void futexWait(atomic<uint32_t>* addr, uint32_t expected)
+    {
+        timespec ts{0, SHM_WAIT_US * 1000};
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected, &ts, nullptr, 0);
+    }
+
+    void futexWake(atomic<uint32_t>* addr)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+#endif
+
+    constexpr size_t CONTROL_SIZE = 4096;
+    constexpr size_t RING_SIZE    = CONTROL_SIZE + SHM_RING_SLOTS * sizeof(RUDP_P);
+    constexpr char   MEMFD_NAME[] = "rudp_shm";
+
+#ifdef __linux__
+    // 对端报价中的fd可能指向任意文件：只接受同一用户创建、已封住长度且足够大的rudp_shm内存文件，
+    // 否则映射后访问越过文件末尾的页会触发SIGBUS
+    bool isRing(int fd)
+    {
+        struct stat st;
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid()) return false;
+        if (st.st_size < static_cast<off_t>(RING_SIZE)) return false;
+        int seals = fcntl(fd, F_GET_SEALS);
+        if (seals < 0 || !(seals & F_SEAL_SHRINK)) return false;
+
+        char    link[64];
+        string  self   = "/proc/self/fd/" + to_string(fd);
+        string  prefix = string("/memfd:") + MEMFD_NAME;
+        ssize_t len    = readlink(self.c_str(), link, sizeof(link));
+        return len >= static_cast<ssize_t>(prefix.size()) && !memcmp(link, prefix.data(), prefix.size());
+    }
+#endif
+}  // namespace
+
+ShmRing::ShmRing() : _fd(-1), _base(nullptr), _size(0), _ctl(nullptr), _slots(nullptr) {}
+ShmRing::~ShmRing() { release(); }
+
+bool ShmRing::_map(int fd)
+{
+#ifdef __linux__
+    _size = RING_SIZE;
+    void* base = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) return false;
+
+    _fd    = fd;
+    _base  = base;
+    _ctl   = static_cast<Control*>(base);
+    _slots = reinterpret_cast<RUDP_P*>(static_cast<char*>(base) + CONTROL_SIZE);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShmRing::create()
+{
+#ifdef __linux__
+    release();
+
+    // 封住长度，对端attach时据此确认映射期间文件不会被截短
+    int fd = memfd_create(MEMFD_NAME, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) return false;
+    if (ftruncate(fd, RING_SIZE) < 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0 ||
+        !_map(fd))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    random_device rd;
+    new (_ctl) Control();
+    _ctl->magic = SHM_MAGIC;
+    _ctl->token = (static_cast<uint64_t>(rd()) << 32) | rd();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShmRing::attach(const RUDP_SHM_OFFER& offer)
+{
+#ifdef __linux__
+    release();
+
+    if (offer.magic != SHM_MAGIC) return false;
+    if (strncmp(offer.boot_id, bootId().c_str(), sizeof(offer.boot_id)) != 0) return false;
+
+    string path = "/proc/" + to_string(offer.pid) + "/fd/" + to_string(offer.fd);
+    int    fd   = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) return false;
+    if (!isRing(fd) || !_map(fd))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (_ctl->magic != SHM_MAGIC || _ctl->token != offer.token)
+    {
+        release();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ShmRing::fillOffer(RUDP_SHM_OFFER& offer) const
+{
+    memset(&offer, 0, sizeof(offer));
+    if (!valid()) return;
+
+#ifdef __linux__
+    offer.magic = SHM_MAGIC;
+    strncpy(offer.boot_id, bootId().c_str(), sizeof(offer.boot_id) - 1);
+    offer.pid   = getpid();
+    offer.fd    = _fd;
+    offer.token = _ctl->token;
+#endif
+}
+
+void ShmRing::release()
+{
+#ifdef __linux__
+    if (_base) munmap(_base, _size);
+    if (_fd >= 0) ::close(_fd);
+#endif
+    _fd    = -1;
+    _base  = nullptr;
+    _size  = 0;
+    _ctl   = nullptr;
+    _slots = nullptr;
+}
+
+bool ShmRing::valid() const { return _ctl != nullptr; }
+
+RUDP_P& ShmRing::acquire()
+{
+    uint32_t head = _ctl->head.load(memory_order_relaxed);
+    while (head - _ctl->tail.load(memory_order_acquire) >= SHM_RING_SLOTS)
+    {
+        _ctl->producer_waiting.store(1);
+        uint32_t tail = _ctl->tail.load();
+        if (head - tail < SHM_RING_SLOTS) break;
+#ifdef __linux__
+        futexWait(&_ctl->tail, tail);
+#endif
+    }
+    return _slots[head % SHM_RING_SLOTS];
+}
+
+void ShmRing::publish()
+{
+    _ctl->head.fetch_add(1, memory_order_release);
+#ifdef __linux__
+    if (_ctl->consumer_waiting.exchange(0)) futexWake(&_ctl->head);
+#endif
+}
+
+bool ShmRing::consume(const function<void(RUDP_P&)>& fn)
+{
+    uint32_t tail = _ctl->tail.load(memory_order_relaxed);
+    while (tail == _ctl->head.load(memory_order_acquire))
+    {
+        if (_ctl->closed) return false;
+        _ctl->consumer_waiting.store(1);
+        if (tail != _ctl->head.load()) break;
+#ifdef __linux__
+        futexWait(&_ctl->head, tail);
+#endif
+    }
+
+    fn(_slots[tail % SHM_RING_SLOTS]);
+
+    // 回调完成后才推进tail，drained()即意味着全部报文都已交付
+    _ctl->tail.store(tail + 1, memory_order_release);
+#ifdef __linux__
+    if (_ctl->producer_waiting.exchange(0)) futexWake(&_ctl->tail);
+#endif
+    return true;
+}
+
+void ShmRing::close()
+{
+    if (!valid()) return;
+    _ctl->closed = 1;
+#ifdef __linux__
+    futexWake(&_ctl->head);
+#endif
+}
+
+bool ShmRing::drained() const { return _ctl->head.load() == _ctl->tail.load(); }
+
+string ShmRing::bootId()
+{
+    ifstream file("/proc/sys/kernel/random/boot_id");
+    string   id;
+    getline(file, id);
+    return id;
+}
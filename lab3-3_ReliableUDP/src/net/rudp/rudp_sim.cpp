@@ -0,0 +1,313 @@
+#include <net/rudp/rudp_sim.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+namespace
+{
+    thread_local int sim_task = -1;  // 当前线程在模拟器中的任务号
+}  // namespace
+
+SimNetwork::SimNetwork(uint64_t seed)
+    : _now(chrono::seconds(1)), _running(-1), _event_seq(0), _rng(seed), _stats{}
+{}
+
+void SimNetwork::set_link(const SimLink& link) { _default_link = link; }
+
+void SimNetwork::set_link(int from_port, int to_port, const SimLink& link)
+{
+    _link_overrides[{from_port, to_port}] = link;
+}
+
+SimStats SimNetwork::stats() const { return _stats; }
+
+bool SimNetwork::simulated() const { return true; }
+
+int SimNetwork::_self() const
+{
+    assert(sim_task >= 0 && "SimNetwork primitive called outside of the simulation");
+    return sim_task;
+}
+
+void SimNetwork::run(const function<void()>& scenario)
+{
+    {
+        unique_lock<mutex> lk(_mtx);
+        sim_task = static_cast<int>(_tasks.size());
+        _tasks.emplace_back(make_unique<Task>());
+        _running = sim_task;
+    }
+
+    scenario();
+
+    unique_lock<mutex> lk(_mtx);
+    _tasks[sim_task]->done = true;
+    _running               = -1;
+    sim_task               = -1;
+}
+
+// 调用方持有_mtx：把执行权交给下一个任务，并等待自己再次被调度
+void SimNetwork::_block(unique_lock<mutex>& lk)
+{
+    int self = _self();
+    _running = _next();
+    _tasks[_running]->cv.notify_one();
+    _tasks[self]->cv.wait(lk, [&]() { return _running == self; });
+}
+
+// 取下一个可运行任务；没有时推进虚拟时钟处理事件，直到有任务被唤醒
+int SimNetwork::_next()
+{
+    while (_ready.empty())
+    {
+        if (_events.empty())
+        {
+            cerr << "SimNetwork: every task is blocked and no event is pending, simulation deadlocked at t="
+                 << chrono::duration_cast<chrono::milliseconds>(_now.time_since_epoch()).count() << "ms" << endl;
+            abort();
+        }
+
+        auto  it = _events.begin();
+        Event ev = std::move(it->second);
+        _now     = it->first.first;
+        _events.erase(it);
+        ++_stats.events;
+
+        if (ev.task >= 0)
+        {
+            if (_tasks[ev.task]->gen == ev.gen) _wake(ev.task);
+        }
+        else
+            _deliver(ev.port, std::move(ev.dgram));
+    }
+
+    int next = _ready.front();
+    _ready.pop_front();
+    return next;
+}
+
+void SimNetwork::_wake(int task)
+{
+    Task& t = *_tasks[task];
+    ++t.gen;
+    if (t.cv_wait)
+    {
+        auto range = _cv_waiters.equal_range(t.cv_wait);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == task)
+            {
+                _cv_waiters.erase(it);
+                break;
+            }
+        }
+        t.cv_wait = nullptr;
+    }
+    _ready.push_back(task);
+}
+
+void SimNetwork::_schedule(time_point at, Event&& ev) { _events.emplace(make_pair(at, _event_seq++), std::move(ev)); }
+
+void SimNetwork::_deliver(int port, Datagram&& dgram)
+{
+    auto it = _endpoints.find(port);
+    if (it == _endpoints.end()) return;
+
+    ++_stats.delivered;
+    Endpoint& ep = it->second;
+    ep.queue.push_back(std::move(dgram));
+    if (ep.waiter >= 0)
+    {
+        _wake(ep.waiter);
+        ep.waiter = -1;
+    }
+}
+
+RUDP_Env::time_point SimNetwork::now()
+{
+    lock_guard<mutex> lk(_mtx);
+    return _now;
+}
+
+void SimNetwork::sleep_for(clock::duration dur)
+{
+    unique_lock<mutex> lk(_mtx);
+    int                self = _self();
+    // 零时长睡眠也推进时钟，避免轮询循环在同一时刻空转
+    _schedule(_now + max<clock::duration>(dur, chrono::microseconds(1)), Event{self, _tasks[self]->gen, -1, {}});
+    _block(lk);
+}
+
+thread SimNetwork::spawn(function<void()> fn)
+{
+    unique_lock<mutex> lk(_mtx);
+    int                id = static_cast<int>(_tasks.size());
+    _tasks.emplace_back(make_unique<Task>());
+    _ready.push_back(id);
+
+    thread t([this, id, fn = std::move(fn)]() {
+        {
+            unique_lock<mutex> lk(_mtx);
+            sim_task = id;
+            _tasks[id]->cv.wait(lk, [&]() { return _running == id; });
+        }
+
+        fn();
+
+        unique_lock<mutex> lk(_mtx);
+        _tasks[id]->done = true;
+        for (int joiner : _tasks[id]->joiners) _wake(joiner);
+        _running = _next();
+        _tasks[_running]->cv.notify_one();
+    });
+    _thread_tasks[t.get_id()] = id;
+    return t;
+}
+
+void SimNetwork::join(thread& t)
+{
+    {
+        unique_lock<mutex> lk(_mtx);
+        auto               it = _thread_tasks.find(t.get_id());
+        if (it != _thread_tasks.end())
+        {
+            int id = it->second;
+            _thread_tasks.erase(it);
+            if (!_tasks[id]->done)
+            {
+                _tasks[id]->joiners.push_back(_self());
+                _block(lk);
+            }
+        }
+    }
+    // 任务已交出执行权，真实线程随即退出
+    t.join();
+}
+
+void SimNetwork::wait_until(unique_lock<mutex>& user_lk, condition_variable& cv, time_point deadline)
+{
+    unique_lock<mutex> lk(_mtx);
+    int                self = _self();
+    _tasks[self]->cv_wait   = &cv;
+    _cv_waiters.emplace(&cv, self);
+    if (deadline != time_point::max()) _schedule(max(deadline, _now), Event{self, _tasks[self]->gen, -1, {}});
+
+    user_lk.unlock();
+    _block(lk);
+    lk.unlock();
+    user_lk.lock();
+}
+
+void SimNetwork::notify_all(condition_variable& cv)
+{
+    lock_guard<mutex> lk(_mtx);
+    vector<int>       waiters;
+    auto              range = _cv_waiters.equal_range(&cv);
+    for (auto it = range.first; it != range.second; ++it) waiters.push_back(it->second);
+    for (int task : waiters) _wake(task);
+}
+
+void SimNetwork::bind(int port)
+{
+    lock_guard<mutex> lk(_mtx);
+    _endpoints[port] = Endpoint();
+}
+
+void SimNetwork::unbind(int port)
+{
+    lock_guard<mutex> lk(_mtx);
+    _endpoints.erase(port);
+}
+
+int SimNetwork::send_to(int port, const void* data, size_t len, const sockaddr_in& to, uint8_t tos)
+{
+    lock_guard<mutex> lk(_mtx);
+    int               dst   = ntohs(to.sin_port);
+    const char*       bytes = static_cast<const char*>(data);
+    Datagram          dgram{port, tos, vector<char>(bytes, bytes + len)};
+
+    // 发往自身的唤醒报文相当于本机回环
+    if (dst == port)
+    {
+        _deliver(dst, std::move(dgram));
+        return static_cast<int>(len);
+    }
+
+    auto           over = _link_overrides.find({port, dst});
+    const SimLink& link = over != _link_overrides.end() ? over->second : _default_link;
+
+    // 取53位构造[0,1)均匀数，不依赖标准库分布的具体实现
+    if (link.loss > 0 && static_cast<double>(_rng() >> 11) * 0x1.0p-53 < link.loss)
+    {
+        ++_stats.lost;
+        return static_cast<int>(len);
+    }
+
+    time_point& busy  = _link_busy[{port, dst}];
+    time_point  start = max(busy, _now);
+    if (link.bandwidth)
+    {
+        // 排在前面尚未发出的字节数即为当前队列长度
+        double backlog = chrono::duration<double>(start - _now).count() * link.bandwidth / 8;
+        if (link.queue && backlog + len > link.queue)
+        {
+            ++_stats.overflow;
+            return static_cast<int>(len);
+        }
+        _stats.max_queue = max(_stats.max_queue, static_cast<size_t>(backlog) + len);
+        // 排队超过阈值时给可感知ECN的报文打CE标记，提前通知发送方而不必等到溢出丢包
+        if (link.ecn && backlog > link.ecn && (tos & ECN_MASK))
+        {
+            dgram.tos = (tos & ~ECN_MASK) | ECN_CE;
+            ++_stats.ce_marked;
+        }
+        start += chrono::nanoseconds(len * 8 * 1000000000ull / link.bandwidth);
+    }
+    busy = start;
+
+    _schedule(start + link.delay, Event{-1, 0, dst, std::move(dgram)});
+    return static_cast<int>(len);
+}
+
+bool SimNetwork::_wait_datagram(unique_lock<mutex>& lk, int port)
+{
+    while (true)
+    {
+        auto it = _endpoints.find(port);
+        if (it == _endpoints.end()) return false;
+        if (!it->second.queue.empty()) return true;
+        it->second.waiter = _self();
+        _block(lk);
+    }
+}
+
+int SimNetwork::peek_size(int port)
+{
+    unique_lock<mutex> lk(_mtx);
+    if (!_wait_datagram(lk, port)) return -1;
+    return static_cast<int>(_endpoints[port].queue.front().data.size());
+}
+
+int SimNetwork::recv_from(int port, void* buf, size_t len, sockaddr_in* from, uint8_t* tos)
+{
+    unique_lock<mutex> lk(_mtx);
+    if (!_wait_datagram(lk, port)) return -1;
+
+    Endpoint& ep    = _endpoints[port];
+    Datagram  dgram = std::move(ep.queue.front());
+    ep.queue.pop_front();
+
+    size_t n = min(len, dgram.data.size());
+    memcpy(buf, dgram.data.data(), n);
+    if (tos) *tos = dgram.tos;
+    if (from)
+    {
+        memset(from, 0, sizeof(sockaddr_in));
+        from->sin_family      = AF_INET;
+        from->sin_port        = htons(dgram.from_port);
+        from->sin_addr.s_addr = inet_addr("127.0.0.1");
+    }
+    return static_cast<int>(n);
+}
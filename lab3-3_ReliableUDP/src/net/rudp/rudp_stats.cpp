@@ -0,0 +1,113 @@
+#include <net/rudp/rudp_stats.h>
+#include <sstream>
+using namespace std;
+
+void RUDP_Counters::recordRtt(chrono::milliseconds rtt)
+{
+    size_t   bucket = 0;
+    uint64_t value  = rtt.count() > 0 ? rtt.count() : 0;
+    while (value && bucket < RTT_HIST_BUCKETS - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+    add(rtt_hist[bucket]);
+}
+
+void RUDP_Counters::reset()
+{
+    bytes_sent           = 0;
+    bytes_received       = 0;
+    packets_sent         = 0;
+    packets_received     = 0;
+    timeout_retransmits  = 0;
+    fast_retransmits     = 0;
+    tail_probes          = 0;
+    spurious_retransmits = 0;
+    cwnd_undos           = 0;
+    ce_received          = 0;
+    ecn_reductions       = 0;
+    dup_acks             = 0;
+    out_of_order         = 0;
+    compress_in          = 0;
+    compress_out         = 0;
+    compress_bypassed    = 0;
+    compress_us          = 0;
+    decompress_us        = 0;
+    for (auto& bucket : rtt_hist) bucket = 0;
+}
+
+void RUDP_Counters::fill(RUDP_Stats& stats) const
+{
+    stats.bytes_sent           = bytes_sent.load(memory_order_relaxed);
+    stats.bytes_received       = bytes_received.load(memory_order_relaxed);
+    stats.packets_sent         = packets_sent.load(memory_order_relaxed);
+    stats.packets_received     = packets_received.load(memory_order_relaxed);
+    stats.timeout_retransmits  = timeout_retransmits.load(memory_order_relaxed);
+    stats.fast_retransmits     = fast_retransmits.load(memory_order_relaxed);
+    stats.tail_probes          = tail_probes.load(memory_order_relaxed);
+    stats.spurious_retransmits = spurious_retransmits.load(memory_order_relaxed);
+    stats.cwnd_undos           = cwnd_undos.load(memory_order_relaxed);
+    stats.ce_received          = ce_received.load(memory_order_relaxed);
+    stats.ecn_reductions       = ecn_reductions.load(memory_order_relaxed);
+    stats.dup_acks             = dup_acks.load(memory_order_relaxed);
+    stats.out_of_order         = out_of_order.load(memory_order_relaxed);
+    stats.compress_in          = compress_in.load(memory_order_relaxed);
+    stats.compress_out         = compress_out.load(memory_order_relaxed);
+    stats.compress_bypassed    = compress_bypassed.load(memory_order_relaxed);
+    stats.compress_us          = compress_us.load(memory_order_relaxed);
+    stats.decompress_us        = decompress_us.load(memory_order_relaxed);
+    stats.compress_ratio       = stats.compress_out ? static_cast<double>(stats.compress_in) / stats.compress_out : 0;
+    for (size_t i = 0; i < RTT_HIST_BUCKETS; ++i) stats.rtt_hist[i] = rtt_hist[i].load(memory_order_relaxed);
+    stats.cwnd          = cwnd.load(memory_order_relaxed);
+    stats.ssthresh      = ssthresh.load(memory_order_relaxed);
+    stats.srtt_ms       = srtt_ms.load(memory_order_relaxed);
+    stats.rttvar_ms     = rttvar_ms.load(memory_order_relaxed);
+    stats.rto_ms        = rto_ms.load(memory_order_relaxed);
+    stats.delivery_rate = delivery_rate.load(memory_order_relaxed);
+}
+
+string RUDP_Stats::toJson() const
+{
+    ostringstream oss;
+    oss << "{\"bytes_sent\":" << bytes_sent << ",\"bytes_received\":" << bytes_received
+        << ",\"packets_sent\":" << packets_sent << ",\"packets_received\":" << packets_received
+        << ",\"timeout_retransmits\":" << timeout_retransmits << ",\"fast_retransmits\":" << fast_retransmits
+        << ",\"tail_probes\":" << tail_probes << ",\"spurious_retransmits\":" << spurious_retransmits
+        << ",\"cwnd_undos\":" << cwnd_undos << ",\"ce_received\":" << ce_received
+        << ",\"ecn_reductions\":" << ecn_reductions << ",\"dup_acks\":" << dup_acks
+        << ",\"out_of_order\":" << out_of_order << ",\"kernel_drops\":" << kernel_drops
+        << ",\"compress_in\":" << compress_in << ",\"compress_out\":" << compress_out
+        << ",\"compress_bypassed\":" << compress_bypassed << ",\"compress_us\":" << compress_us
+        << ",\"decompress_us\":" << decompress_us << ",\"compress_ratio\":" << compress_ratio
+        << ",\"cwnd\":" << cwnd << ",\"ssthresh\":" << ssthresh << ",\"srtt_ms\":" << srtt_ms
+        << ",\"rttvar_ms\":" << rttvar_ms << ",\"rto_ms\":" << rto_ms << ",\"delivery_rate\":" << delivery_rate
+        << ",\"rtt_hist\":[";
+    for (size_t i = 0; i < RTT_HIST_BUCKETS; ++i) oss << (i ? "," : "") << rtt_hist[i];
+    oss << "]}";
+    return oss.str();
+}
+
+string RUDP_Stats::csvHeader()
+{
+    ostringstream oss;
+    oss << "bytes_sent,bytes_received,packets_sent,packets_received,timeout_retransmits,fast_retransmits,tail_probes,"
+           "spurious_retransmits,cwnd_undos,ce_received,ecn_reductions,dup_acks,out_of_order,kernel_drops,"
+           "compress_in,compress_out,compress_bypassed,compress_us,decompress_us,compress_ratio,cwnd,ssthresh,"
+           "srtt_ms,rttvar_ms,rto_ms,delivery_rate";
+    for (size_t i = 0; i < RTT_HIST_BUCKETS; ++i) oss << ",rtt_hist_" << i;
+    return oss.str();
+}
+
+string RUDP_Stats::toCsv() const
+{
+    ostringstream oss;
+    oss << bytes_sent << ',' << bytes_received << ',' << packets_sent << ',' << packets_received << ','
+        << timeout_retransmits << ',' << fast_retransmits << ',' << tail_probes << ',' << spurious_retransmits << ','
+        << cwnd_undos << ',' << ce_received << ',' << ecn_reductions << ',' << dup_acks << ',' << out_of_order << ','
+        << kernel_drops << ',' << compress_in << ',' << compress_out << ',' << compress_bypassed << ',' << compress_us
+        << ',' << decompress_us << ',' << compress_ratio << ',' << cwnd << ',' << ssthresh << ',' << srtt_ms << ','
+        << rttvar_ms << ',' << rto_ms << ',' << delivery_rate;
+    for (size_t i = 0; i < RTT_HIST_BUCKETS; ++i) oss << ',' << rtt_hist[i];
+    return oss.str();
+}
@@ -0,0 +1,96 @@
+#include <net/rudp/rudp_token.h>
+#include <cstddef>
+#include <random>
+using namespace std;
+
+namespace
+{
+    uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+    void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+    {
+        v0 += v1;
+        v1 = rotl(v1, 13) ^ v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16) ^ v2;
+        v0 += v3;
+        v3 = rotl(v3, 21) ^ v0;
+        v2 += v1;
+        v1 = rotl(v1, 17) ^ v2;
+        v2 = rotl(v2, 32);
+    }
+
+    // SipHash-2-4，按小端读取消息
+    uint64_t sipHash(uint64_t k0, uint64_t k1, const uint8_t* data, size_t len)
+    {
+        uint64_t v0 = k0 ^ 0x736f6d6570736575ull;
+        uint64_t v1 = k1 ^ 0x646f72616e646f6dull;
+        uint64_t v2 = k0 ^ 0x6c7967656e657261ull;
+        uint64_t v3 = k1 ^ 0x7465646279746573ull;
+
+        size_t tail = len & 7;
+        for (const uint8_t* end = data + len - tail; data != end; data += 8)
+        {
+            uint64_t m = 0;
+            for (int i = 0; i < 8; ++i) m |= static_cast<uint64_t>(data[i]) << (8 * i);
+            v3 ^= m;
+            sipRound(v0, v1, v2, v3);
+            sipRound(v0, v1, v2, v3);
+            v0 ^= m;
+        }
+
+        uint64_t b = static_cast<uint64_t>(len) << 56;
+        for (size_t i = 0; i < tail; ++i) b |= static_cast<uint64_t>(data[i]) << (8 * i);
+        v3 ^= b;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= b;
+
+        v2 ^= 0xff;
+        for (int i = 0; i < 4; ++i) sipRound(v0, v1, v2, v3);
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    // 逐字节累积差异后一次判断，耗时与第一个不同字节的位置无关；volatile防止编译器提前退出
+    bool macEqual(uint64_t a, uint64_t b)
+    {
+        volatile uint8_t diff = 0;
+        for (int i = 0; i < 8; ++i) diff = diff | static_cast<uint8_t>((a ^ b) >> (8 * i));
+        return diff == 0;
+    }
+}  // namespace
+
+TokenIssuer::TokenIssuer() : _counter(0)
+{
+    random_device rd;
+    _k0 = (static_cast<uint64_t>(rd()) << 32) | rd();
+    _k1 = (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+uint64_t TokenIssuer::_mac(const RUDP_TOKEN& token) const
+{
+    return sipHash(_k0, _k1, reinterpret_cast<const uint8_t*>(&token), offsetof(RUDP_TOKEN, mac));
+}
+
+RUDP_TOKEN TokenIssuer::issue(uint32_t addr, uint64_t now_ms)
+{
+    RUDP_TOKEN token;
+    token.addr      = addr;
+    token.expire_ms = now_ms + TOKEN_LIFETIME_MS;
+    token.nonce     = _counter++;
+    token.mac       = _mac(token);
+    return token;
+}
+
+bool TokenIssuer::redeem(const RUDP_TOKEN& token, uint32_t addr, uint64_t now_ms)
+{
+    if (!macEqual(token.mac, _mac(token)) || token.addr != addr || token.expire_ms <= now_ms) return false;
+
+    // 过期的记录不再需要，令牌本身已无法通过期限检查
+    for (auto it = _redeemed.begin(); it != _redeemed.end();)
+        it = it->second <= now_ms ? _redeemed.erase(it) : next(it);
+    if (_redeemed.size() >= TOKEN_REPLAY_CACHE) return false;
+
+    return _redeemed.emplace(token.nonce, token.expire_ms).second;
+}
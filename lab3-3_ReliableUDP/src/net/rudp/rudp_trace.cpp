@@ -0,0 +1,71 @@
+#include <net/rudp/rudp_trace.h>
+#include <fstream>
+using namespace std;
+
+string traceEventStr(TraceEvent type)
+{
+    switch (type)
+    {
+#define X(name, idx) \
+    case TraceEvent::name: return #name;
+        TRACE_EVENT_LIST
+#undef X
+        default: return "UNKNOWN";
+    }
+}
+
+string ccStateStr(CcState state)
+{
+    switch (state)
+    {
+#define X(name, idx) \
+    case CcState::name: return #name;
+        CC_STATE_LIST
+#undef X
+        default: return "UNKNOWN";
+    }
+}
+
+RUDP_Trace::RUDP_Trace(RUDP_Env& env) : _env(env), _head(0), _enabled(false) {}
+
+void RUDP_Trace::enable(bool on)
+{
+    if (on && !_ring) _ring.reset(new TraceRecord[TRACE_CAPACITY]);
+    _enabled = on;
+}
+
+bool RUDP_Trace::enabled() const { return _enabled; }
+
+void RUDP_Trace::clear() { _head = 0; }
+
+void RUDP_Trace::record(TraceEvent type, uint32_t seq, float v1, float v2, uint8_t aux, uint16_t len)
+{
+    if (!_enabled.load(memory_order_relaxed)) return;
+
+    uint64_t     idx = _head.fetch_add(1, memory_order_relaxed);
+    TraceRecord& rec = _ring[idx & (TRACE_CAPACITY - 1)];
+    rec.ts_ns        = chrono::duration_cast<chrono::nanoseconds>(_env.now().time_since_epoch()).count();
+    rec.type         = static_cast<uint8_t>(type);
+    rec.aux          = aux;
+    rec.len          = len;
+    rec.seq          = seq;
+    rec.v1           = v1;
+    rec.v2           = v2;
+}
+
+bool RUDP_Trace::dump(const string& path) const
+{
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+
+    uint64_t head  = _ring ? _head.load() : 0;
+    uint64_t count = head < TRACE_CAPACITY ? head : TRACE_CAPACITY;
+
+    TraceFileHeader header{TRACE_MAGIC, TRACE_VERSION, sizeof(TraceRecord), count};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // 环写满后最旧的记录位于head处
+    for (uint64_t i = head - count; i < head; ++i)
+        out.write(reinterpret_cast<const char*>(&_ring[i & (TRACE_CAPACITY - 1)]), sizeof(TraceRecord));
+    return out.good();
+}
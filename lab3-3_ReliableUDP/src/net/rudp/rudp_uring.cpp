@@ -0,0 +1,392 @@
+#include <net/rudp/rudp_uring.h>
+#include <algorithm>
+#include <cstring>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+#ifdef __linux__
+
+struct UringIo::SendSlot
+{
+    msghdr      msg;
+    iovec       iov;
+    sockaddr_in to;
+    RUDP_P      packet;
+};
+
+namespace
+{
+    constexpr size_t CTRL_SIZE = CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(int));  // SO_RXQ_OVFL与IP_TOS
+
+    int sysSetup(unsigned entries, io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int sysRegister(int fd, unsigned opcode, void* arg, unsigned nr_args)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    void* mapRing(int fd, size_t size, off_t offset)
+    {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+}  // namespace
+
+bool UringIo::Ring::setup(unsigned entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = sysSetup(entries, &params);
+    if (fd < 0) return false;
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_size = cq_size = max(sq_size, cq_size);
+
+    sq_ptr    = mapRing(fd, sq_size, IORING_OFF_SQ_RING);
+    cq_ptr    = single_mmap ? sq_ptr : mapRing(fd, cq_size, IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes      = mapRing(fd, sqes_size, IORING_OFF_SQES);
+    if (!sq_ptr || !cq_ptr || !sqes)
+    {
+        teardown();
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ptr);
+    char* cq = static_cast<char*>(cq_ptr);
+    sq_head  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes     = cq + params.cq_off.cqes;
+    sqe_tail = *sq_tail;
+    pending  = 0;
+    return true;
+}
+
+void UringIo::Ring::teardown()
+{
+    if (sqes) munmap(sqes, sqes_size);
+    if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+    if (sq_ptr) munmap(sq_ptr, sq_size);
+    if (fd >= 0) ::close(fd);
+    *this = Ring();
+}
+
+void* UringIo::Ring::next_sqe()
+{
+    if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) > *sq_mask) return nullptr;
+
+    unsigned      idx = sqe_tail & *sq_mask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + idx;
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sq_array[idx] = idx;
+    ++sqe_tail;
+    ++pending;
+    return sqe;
+}
+
+int UringIo::Ring::enter(unsigned min_complete)
+{
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+
+    int ret;
+    do {
+        ret = sysEnter(fd, pending, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret > 0) pending -= min<unsigned>(ret, pending);
+    return ret;
+}
+
+void* UringIo::Ring::peek_cqe()
+{
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return nullptr;
+    return static_cast<io_uring_cqe*>(cqes) + (head & *cq_mask);
+}
+
+void UringIo::Ring::advance_cqe() { __atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE); }
+
+UringIo::UringIo()
+    : _sockfd(INVALID_SOCKET), _buf_ring(nullptr), _buf_ring_size(0), _rx_buf_size(0), _rx_msg(nullptr), _rx_armed(false)
+{}
+
+UringIo::~UringIo() { close(); }
+
+bool UringIo::valid() const { return _rx.fd >= 0; }
+
+bool UringIo::open(SOCKET sockfd)
+{
+    close();
+    _sockfd = sockfd;
+    if (!_rx.setup(URING_ENTRIES) || !_tx.setup(URING_ENTRIES))
+    {
+        close();
+        return false;
+    }
+
+    // 缓冲区环：内核从中取缓冲区放数据报，用户态处理完后把同一缓冲区挂回环尾
+    _buf_ring_size = URING_RECV_BUFS * sizeof(io_uring_buf);
+    _buf_ring      = mmap(nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_buf_ring == MAP_FAILED)
+    {
+        _buf_ring = nullptr;
+        close();
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr    = reinterpret_cast<uint64_t>(_buf_ring);
+    reg.ring_entries = URING_RECV_BUFS;
+    reg.bgid         = URING_BUF_GROUP;
+    if (sysRegister(_rx.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        close();
+        return false;
+    }
+
+    // 每个缓冲区依次放io_uring_recvmsg_out、来源地址、控制消息与报文
+    _rx_buf_size = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + CTRL_SIZE + sizeof(RUDP_P);
+    _rx_bufs.assign(URING_RECV_BUFS * _rx_buf_size, 0);
+    for (uint16_t bid = 0; bid < URING_RECV_BUFS; ++bid) _recycle(bid);
+
+    msghdr* msg         = new msghdr();
+    msg->msg_namelen    = sizeof(sockaddr_in);
+    msg->msg_controllen = CTRL_SIZE;
+    _rx_msg             = msg;
+
+    _tx_slots.resize(URING_SEND_SLOTS);
+    _tx_free.clear();
+    for (int i = URING_SEND_SLOTS - 1; i >= 0; --i) _tx_free.push_back(i);
+
+    // 缓冲区环(5.19)注册成功不代表支持多发recvmsg(6.0)：不支持时请求在提交时即以-EINVAL完成，
+    // 此时返回false让调用方退回套接字收发，否则之后每次recv都会失败并反复重新挂起
+    _arm_recv();
+    if (_rx.enter(0) < 0)
+    {
+        close();
+        return false;
+    }
+    io_uring_cqe* cqe = static_cast<io_uring_cqe*>(_rx.peek_cqe());
+    if (cqe && cqe->res < 0 && cqe->res != -ENOBUFS && !(cqe->flags & IORING_CQE_F_MORE))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UringIo::close()
+{
+    if (_tx.fd >= 0)
+    {
+        // 等已提交的发送全部完成，槽位才能释放
+        lock_guard<mutex> lk(_tx_mtx);
+        _reap_sends();
+        while (_tx_free.size() < _tx_slots.size() && _tx.enter(1) >= 0) _reap_sends();
+    }
+
+    _rx.teardown();
+    _tx.teardown();
+    if (_buf_ring) munmap(_buf_ring, _buf_ring_size);
+    _buf_ring = nullptr;
+    delete static_cast<msghdr*>(_rx_msg);
+    _rx_msg   = nullptr;
+    _rx_armed = false;
+    _rx_bufs.clear();
+    _tx_slots.clear();
+    _tx_free.clear();
+    _sockfd = INVALID_SOCKET;
+}
+
+void UringIo::_arm_recv()
+{
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(_rx.next_sqe());
+    if (!sqe) return;
+
+    sqe->opcode    = IORING_OP_RECVMSG;
+    sqe->fd        = _sockfd;
+    sqe->addr      = reinterpret_cast<uint64_t>(_rx_msg);
+    sqe->len       = 1;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    _rx_armed      = true;
+}
+
+void UringIo::_recycle(uint16_t bid)
+{
+    // 按C++编译时内核头里的柔性数组bufs会偏移8字节，这里直接按io_uring_buf数组下标访问
+    io_uring_buf_ring* ring = static_cast<io_uring_buf_ring*>(_buf_ring);
+    io_uring_buf*      bufs = static_cast<io_uring_buf*>(_buf_ring);
+    uint16_t           tail = ring->tail;
+    io_uring_buf&      buf  = bufs[tail & (URING_RECV_BUFS - 1)];
+    buf.addr                = reinterpret_cast<uint64_t>(_rx_bufs.data() + bid * _rx_buf_size);
+    buf.len                 = static_cast<uint32_t>(_rx_buf_size);
+    buf.bid                 = bid;
+    __atomic_store_n(&ring->tail, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+}
+
+int UringIo::recv(void* buf, size_t len, sockaddr_in* from, uint32_t& drops, uint8_t* tos)
+{
+    return recv(
+        [&](size_t& n) {
+            n = min(n, len);
+            return buf;
+        },
+        from, drops, tos);
+}
+
+int UringIo::recv(const function<void*(size_t&)>& place, sockaddr_in* from, uint32_t& drops, uint8_t* tos)
+{
+    lock_guard<mutex> lk(_rx_mtx);
+    while (true)
+    {
+        io_uring_cqe* cqe = static_cast<io_uring_cqe*>(_rx.peek_cqe());
+        if (!cqe)
+        {
+            // 完成队列已空才进入内核；多发请求失效时在同一次调用里重新挂起
+            if (!_rx_armed) _arm_recv();
+            if (_rx.enter(1) < 0) return -1;
+            continue;
+        }
+
+        int      res   = cqe->res;
+        unsigned flags = cqe->flags;
+        _rx.advance_cqe();
+        if (!(flags & IORING_CQE_F_MORE)) _rx_armed = false;
+
+        if (res < 0)
+        {
+            // 缓冲区暂时用尽时多发请求终止，下次等待前重新挂起即可
+            if (res == -ENOBUFS) continue;
+            errno = -res;
+            return -1;
+        }
+        if (!(flags & IORING_CQE_F_BUFFER)) continue;
+
+        uint16_t              bid  = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        char*                 base = _rx_bufs.data() + bid * _rx_buf_size;
+        io_uring_recvmsg_out* out  = reinterpret_cast<io_uring_recvmsg_out*>(base);
+        char*                 name = base + sizeof(io_uring_recvmsg_out);
+        char*                 ctrl = name + sizeof(sockaddr_in);
+        char*                 data = ctrl + CTRL_SIZE;
+
+        if (from && out->namelen >= sizeof(sockaddr_in)) memcpy(from, name, sizeof(sockaddr_in));
+
+        msghdr msg{};
+        msg.msg_control    = ctrl;
+        msg.msg_controllen = out->controllen;
+        if (tos) *tos = 0;
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+#ifdef SO_RXQ_OVFL
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+#endif
+            if (tos && cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS) *tos = *CMSG_DATA(cmsg);
+        }
+
+        size_t n = min(static_cast<size_t>(out->payloadlen), sizeof(RUDP_P));
+        memcpy(place(n), data, n);
+        _recycle(bid);
+        return static_cast<int>(n);
+    }
+}
+
+void UringIo::_reap_sends()
+{
+    // 调用方持有_tx_mtx；发送失败与UDP丢包等价，交给重传处理
+    while (io_uring_cqe* cqe = static_cast<io_uring_cqe*>(_tx.peek_cqe()))
+    {
+        _tx_free.push_back(static_cast<int>(cqe->user_data));
+        _tx.advance_cqe();
+    }
+}
+
+int UringIo::send(const void* data, size_t len, const sockaddr_in& to, bool more)
+{
+    lock_guard<mutex> lk(_tx_mtx);
+    _reap_sends();
+    while (_tx_free.empty())
+    {
+        if (_tx.enter(1) < 0) return -1;
+        _reap_sends();
+    }
+
+    int id = _tx_free.back();
+    _tx_free.pop_back();
+
+    SendSlot& slot = _tx_slots[id];
+    len            = min(len, sizeof(RUDP_P));
+    memcpy(&slot.packet, data, len);
+    slot.to              = to;
+    slot.iov             = {&slot.packet, len};
+    slot.msg             = msghdr{};
+    slot.msg.msg_name    = &slot.to;
+    slot.msg.msg_namelen = sizeof(sockaddr_in);
+    slot.msg.msg_iov     = &slot.iov;
+    slot.msg.msg_iovlen  = 1;
+
+    // 槽位数小于SQ深度，这里总能取到SQE
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(_tx.next_sqe());
+    sqe->opcode       = IORING_OP_SENDMSG;
+    sqe->fd           = _sockfd;
+    sqe->addr         = reinterpret_cast<uint64_t>(&slot.msg);
+    sqe->len          = 1;
+    sqe->user_data    = static_cast<uint64_t>(id);
+
+    if (!more && _tx.enter(0) < 0) return -1;
+    return static_cast<int>(len);
+}
+
+void UringIo::flush()
+{
+    lock_guard<mutex> lk(_tx_mtx);
+    if (_tx.pending) _tx.enter(0);
+}
+
+#else
+
+struct UringIo::SendSlot
+{};
+
+bool UringIo::Ring::setup(unsigned entries) { return false; }
+void UringIo::Ring::teardown() {}
+
+UringIo::UringIo()
+    : _sockfd(INVALID_SOCKET), _buf_ring(nullptr), _buf_ring_size(0), _rx_buf_size(0), _rx_msg(nullptr), _rx_armed(false)
+{}
+UringIo::~UringIo() {}
+
+bool UringIo::valid() const { return false; }
+bool UringIo::open(SOCKET sockfd) { return false; }
+void UringIo::close() {}
+int  UringIo::recv(void* buf, size_t len, sockaddr_in* from, uint32_t& drops, uint8_t* tos) { return -1; }
+int  UringIo::recv(const function<void*(size_t&)>& place, sockaddr_in* from, uint32_t& drops, uint8_t* tos)
+{
+    return -1;
+}
+int  UringIo::send(const void* data, size_t len, const sockaddr_in& to, bool more) { return -1; }
+void UringIo::flush() {}
+
+#endif
@@ -0,0 +1,71 @@
+#include <transfer/chunk_hash.h>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t rotl(uint64_t v, int r) { return (v << r) | (v >> (64 - r)); }
+
+    inline uint64_t read64(const char* p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t read32(const char* p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t step(uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; }
+
+    inline uint64_t merge(uint64_t acc, uint64_t v) { return (acc ^ step(0, v)) * P1 + P4; }
+}  // namespace
+
+uint64_t chunkHash(const char* data, size_t len)
+{
+    const char* p   = data;
+    const char* end = data + len;
+    uint64_t    h;
+
+    if (len >= 32)
+    {
+        // 四路独立累加，每轮吃进32字节
+        uint64_t v1 = P1 + P2, v2 = P2, v3 = 0, v4 = 0 - P1;
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = step(v1, read64(p));
+            v2 = step(v2, read64(p + 8));
+            v3 = step(v3, read64(p + 16));
+            v4 = step(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+        h = P5;
+
+    h += len;
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ step(0, read64(p)), 27) * P1 + P4;
+    if (p + 4 <= end)
+    {
+        h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; ++p) h = rotl(h ^ (static_cast<uint8_t>(*p) * P5), 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
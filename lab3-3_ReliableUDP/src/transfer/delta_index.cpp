@@ -0,0 +1,147 @@
+#include <transfer/delta_index.h>
+#include <transfer/chunk_hash.h>
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+#ifdef __SSE2__
+namespace
+{
+    // 8个16位元素的组内前缀和
+    inline __m128i prefix8(__m128i v)
+    {
+        v = _mm_add_epi16(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi16(v, _mm_slli_si128(v, 4));
+        return _mm_add_epi16(v, _mm_slli_si128(v, 8));
+    }
+
+    // 把最后一个元素广播到8个位置
+    inline __m128i last8(__m128i v) { return _mm_shuffle_epi32(_mm_shufflehi_epi16(v, 0xff), 0xff); }
+}  // namespace
+#endif
+
+uint32_t weakChecksum(const char* data, size_t len)
+{
+    uint32_t a = 0;
+    uint32_t b = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        a += static_cast<uint8_t>(data[i]);
+        b += a;
+    }
+    return (a & 0xffff) | b << 16;
+}
+
+const uint32_t* RollingChecksum::scan(const char* data, size_t count, size_t block)
+{
+    size_t n = count + block - 1;
+    _sum.resize(n + 1);
+    _weighted.resize(n + 1);
+    _weak.resize(count);
+
+    // 只用到a、b的低16位，前缀和、下标与乘积都按2^16回绕
+    uint16_t* sum      = _sum.data();
+    uint16_t* weighted = _weighted.data();
+    uint16_t  a        = 0;
+    uint16_t  b        = 0;
+    size_t    i        = 0;
+    sum[0]             = 0;
+    weighted[0]        = 0;
+#ifdef __SSE2__
+    // 每次8个字节：组内前缀和用三次移位相加求出，再加上前一组的末项
+    __m128i zero   = _mm_setzero_si128();
+    __m128i carry  = zero;
+    __m128i wcarry = zero;
+    __m128i index  = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i x  = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i)), zero);
+        __m128i sx = _mm_add_epi16(prefix8(x), carry);
+        __m128i wx = _mm_add_epi16(prefix8(_mm_mullo_epi16(x, index)), wcarry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sum + i + 1), sx);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(weighted + i + 1), wx);
+        carry  = last8(sx);
+        wcarry = last8(wx);
+        index  = _mm_add_epi16(index, _mm_set1_epi16(8));
+    }
+    a = sum[i];
+    b = weighted[i];
+#endif
+    for (; i < n; ++i)
+    {
+        uint16_t x = static_cast<uint8_t>(data[i]);
+        a += x;
+        b += static_cast<uint16_t>(i * x);
+        sum[i + 1]      = a;
+        weighted[i + 1] = b;
+    }
+
+    // 以k开头的块：a = sum[k + L] - sum[k]，b = Σ(k + L - i)·x_i = (k + L)·a - (weighted[k + L] - weighted[k])
+    const uint16_t* __restrict head  = sum + block;
+    const uint16_t* __restrict whead = weighted + block;
+    uint32_t* __restrict       weak  = _weak.data();
+    uint16_t                   pos   = static_cast<uint16_t>(block);
+    for (size_t k = 0; k < count; ++k)
+    {
+        uint16_t sa = head[k] - sum[k];
+        uint16_t sb = static_cast<uint16_t>((pos + k) * sa) - (whead[k] - weighted[k]);
+        weak[k]     = sa | static_cast<uint32_t>(sb) << 16;
+    }
+    return _weak.data();
+}
+
+DeltaIndex::DeltaIndex(vector<BlockSignature> sigs, size_t block)
+    : _sigs(std::move(sigs)), _order(_sigs.size()), _tags((1 << 16) / 64), _block(block)
+{
+    for (uint32_t i = 0; i < _order.size(); ++i)
+    {
+        _order[i] = i;
+        uint32_t tag = _tag(_sigs[i].weak);
+        _tags[tag / 64] |= 1ull << (tag % 64);
+    }
+    sort(_order.begin(), _order.end(), [this](uint32_t x, uint32_t y) { return _sigs[x].weak < _sigs[y].weak; });
+}
+
+uint32_t DeltaIndex::_tag(uint32_t weak) { return (weak ^ weak >> 16) & 0xffff; }
+
+uint32_t DeltaIndex::find(uint32_t weak, const char* data, uint32_t hint) const
+{
+    uint32_t tag = _tag(weak);
+    if (!(_tags[tag / 64] >> (tag % 64) & 1)) return UINT32_MAX;
+
+    // 强散列只在弱校验和命中后计算一次
+    bool     hashed = false;
+    uint64_t strong = 0;
+    auto     same   = [&](uint32_t i) {
+        if (_sigs[i].weak != weak) return false;
+        if (!hashed) strong = chunkHash(data, _block);
+        hashed = true;
+        return _sigs[i].strong == strong;
+    };
+
+    if (hint < _sigs.size() && same(hint)) return hint;
+    auto it = lower_bound(
+        _order.begin(), _order.end(), weak, [this](uint32_t i, uint32_t w) { return _sigs[i].weak < w; });
+    for (; it != _order.end() && _sigs[*it].weak == weak; ++it)
+        if (*it != hint && same(*it)) return *it;
+    return UINT32_MAX;
+}
+
+uint32_t DeltaIndex::block_size_for(uint64_t size)
+{
+    uint64_t block = max<uint64_t>(static_cast<uint64_t>(sqrt(static_cast<double>(size))),
+        (size + DELTA_MAX_BLOCKS - 1) / DELTA_MAX_BLOCKS);
+    block          = max<uint64_t>(DELTA_MIN_BLOCK, (block + 1023) / 1024 * 1024);
+    return static_cast<uint32_t>(min<uint64_t>(block, UINT32_MAX / 1024 * 1024));
+}
+
+vector<BlockSignature> DeltaIndex::sign(const char* data, size_t size, size_t block)
+{
+    vector<BlockSignature> sigs(size / block);
+    for (size_t i = 0; i < sigs.size(); ++i)
+        sigs[i] = BlockSignature{weakChecksum(data + i * block, block), chunkHash(data + i * block, block)};
+    return sigs;
+}
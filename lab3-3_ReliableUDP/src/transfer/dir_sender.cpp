@@ -0,0 +1,235 @@
+#include <transfer/dir_sender.h>
+#include <transfer/file_msg.h>
+#include <transfer/file_sender.h>
+#include <transfer/mapped_file.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+DirectorySender::DirectorySender(RUDP_C& conn, size_t mss, size_t jobs)
+    : _conn(conn),
+      _mss(max<size_t>(sizeof(SegmentHeader) + 1, min<size_t>(mss, BODY_SIZE))),
+      _jobs(max<size_t>(1, jobs)),
+      _next(0),
+      _sent(0),
+      _failed(0),
+      _rejected(0),
+      _confirmed(false)
+{}
+
+bool DirectorySender::send(const string& dir)
+{
+    error_code ec;
+    fs::path   root = fs::absolute(dir, ec).lexically_normal();
+    if (ec || !fs::is_directory(root, ec)) return false;
+    if (!root.has_filename()) root = root.parent_path();
+
+    // 根目录本身是第一个条目，接收方以它的名字为根重建目录树
+    string rootName = root.filename().string();
+    auto   mode     = [](const fs::file_status& st) { return static_cast<uint32_t>(st.permissions()) & 07777; };
+    _entries.clear();
+    _entries.push_back(Entry{root.string(), rootName, 0, mode(fs::status(root, ec)) | MANIFEST_DIR, 0});
+
+    // 只传普通文件与目录，符号链接等跳过；按路径排序，父目录总在其内容之前
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+    if (ec) return false;
+    for (; it != end; it.increment(ec))
+    {
+        if (ec) return false;
+        fs::file_status st   = it->symlink_status(ec);
+        string          name = rootName + "/" + it->path().lexically_relative(root).generic_string();
+        if (fs::is_directory(st))
+            _entries.push_back(Entry{it->path().string(), name, 0, mode(st) | MANIFEST_DIR, 0});
+        else if (fs::is_regular_file(st))
+            _entries.push_back(Entry{it->path().string(), name, it->file_size(ec), mode(st), 0});
+    }
+    sort(_entries.begin() + 1, _entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    uint32_t id = FileSender::next_id(static_cast<uint32_t>(_entries.size()));
+    for (auto& entry : _entries) entry.id = id++;
+
+    _next      = 0;
+    _sent      = 0;
+    _failed    = 0;
+    _rejected  = 0;
+    _confirmed = false;
+    _pack.clear();
+    _send_manifest();
+
+    size_t         files = files_sent();  // 尚未开始发送，即文件总数
+    vector<thread> workers;
+    for (size_t i = 0; i < min(_jobs, files); ++i) workers.emplace_back([this]() { _worker_handler(); });
+    for (auto& worker : workers) worker.join();
+
+    {
+        lock_guard<mutex> lk(_send_mtx);
+        _flush_pack();
+    }
+    if (!_failed) _await_result();
+    return true;
+}
+
+void DirectorySender::_await_result()
+{
+    // 接收方写完全部条目才应答，先等数据都被确认，再按续传协商的节奏超时重发QUERY
+    _conn.flush();
+    ReplyQuery   query{_entries[0].id, 0};
+    vector<char> reply;
+    uint16_t     type;
+    milliseconds timeout(RESUME_REPLY_TIMEOUT);
+    for (int retry = 0; retry <= RESUME_QUERY_RETRIES; ++retry, timeout *= 2)
+    {
+        if (retry)
+        {
+            const char* raw = reinterpret_cast<const char*>(&query);
+            _conn.send_fragment(static_cast<uint16_t>(FileMsg::QUERY), raw, sizeof(query), true, true);
+        }
+        auto deadline = steady_clock::now() + timeout;
+        for (milliseconds left = timeout; _conn.recv_reply(type, reply, left);
+             left = max(milliseconds(0), duration_cast<milliseconds>(deadline - steady_clock::now())))
+        {
+            BatchResult result;
+            if (type != static_cast<uint16_t>(FileMsg::RESULT) || reply.size() < sizeof(result)) continue;
+            memcpy(&result, reply.data(), sizeof(result));
+            if (result.id != query.id) continue;
+            _rejected  = result.failed;
+            _confirmed = true;
+            return;
+        }
+    }
+}
+
+void DirectorySender::_send_manifest()
+{
+    // 每个分片只放完整的条目，接收方逐分片解析，不必先拼出整条清单
+    ManifestHeader header{static_cast<uint32_t>(_entries.size()), 0};
+    for (auto& entry : _entries) header.bytes += entry.size;
+
+    vector<char> fragment(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+    bool         first = true;
+    for (auto& entry : _entries)
+    {
+        ManifestEntry record{entry.id, entry.size, entry.mode, static_cast<uint16_t>(entry.name.size())};
+        if (fragment.size() + sizeof(record) + entry.name.size() > BODY_SIZE)
+        {
+            _conn.send_fragment(
+                static_cast<uint16_t>(FileMsg::MANIFEST), fragment.data(), fragment.size(), first, false);
+            fragment.clear();
+            first = false;
+        }
+        const char* raw = reinterpret_cast<const char*>(&record);
+        fragment.insert(fragment.end(), raw, raw + sizeof(record));
+        fragment.insert(fragment.end(), entry.name.begin(), entry.name.end());
+    }
+    _conn.send_fragment(static_cast<uint16_t>(FileMsg::MANIFEST), fragment.data(), fragment.size(), first, true);
+}
+
+void DirectorySender::_worker_handler()
+{
+    for (size_t i = _next++; i < _entries.size(); i = _next++)
+    {
+        const Entry& entry = _entries[i];
+        // 空文件随清单即已完整，无需发送内容
+        if (entry.mode & MANIFEST_DIR || entry.size == 0) continue;
+        if (entry.size <= PACK_FILE_SIZE && sizeof(PackRecord) + entry.size <= _mss)
+            _pack_file(entry);
+        else
+            _send_file(entry);
+    }
+}
+
+void DirectorySender::_pack_file(const Entry& entry)
+{
+    vector<char> data(entry.size);
+    ifstream     file(entry.path, ios::binary);
+    if (!file.read(data.data(), data.size()))
+    {
+        cerr << "Failed to read file: " << entry.path << endl;
+        ++_failed;
+        return;
+    }
+
+    PackRecord        record{entry.id, static_cast<uint32_t>(entry.size)};
+    lock_guard<mutex> lk(_send_mtx);
+    if (_pack.size() + sizeof(record) + data.size() > _mss) _flush_pack();
+    _pack.insert(_pack.end(), reinterpret_cast<const char*>(&record), reinterpret_cast<const char*>(&record + 1));
+    _pack.insert(_pack.end(), data.begin(), data.end());
+    _sent += entry.size;
+}
+
+void DirectorySender::_flush_pack()
+{
+    if (_pack.empty()) return;
+    _conn.send_fragment(static_cast<uint16_t>(FileMsg::PACK), _pack.data(), _pack.size(), true, true);
+    _pack.clear();
+}
+
+void DirectorySender::_send_file(const Entry& entry)
+{
+    // 清单发出后文件变短则无法补齐，变长时只发清单中的长度
+    MappedFile file;
+    if (!file.open(entry.path) || file.size() < entry.size)
+    {
+        cerr << "Failed to read file: " << entry.path << endl;
+        ++_failed;
+        return;
+    }
+
+    // 每个分片单独成为一条消息，与其他文件的分片交错时接收方无需按消息拼接
+    size_t size       = entry.size;
+    size_t chunk      = _mss - sizeof(SegmentHeader);
+    size_t prefetched = 0;
+    size_t released   = 0;
+    for (size_t off = 0; off < size;)
+    {
+        // 预读在发送锁之外进行，本线程等待磁盘时其他文件继续发送
+        while (prefetched < min(size, off + READ_AHEAD_STEP))
+        {
+            size_t len = min<size_t>(size - prefetched, READ_AHEAD_STEP);
+            file.prefetch(prefetched, len);
+            prefetched += len;
+        }
+
+        size_t        len = min(chunk, size - off);
+        SegmentHeader segment{entry.id, off};
+        {
+            lock_guard<mutex> lk(_send_mtx);
+            _conn.send_fragment(static_cast<uint16_t>(FileMsg::DATA),
+                reinterpret_cast<const char*>(&segment),
+                sizeof(segment),
+                file.data() + off,
+                len,
+                true,
+                true);
+        }
+        off += len;
+
+        if (off - released >= READ_AHEAD_STEP || off == size)
+        {
+            size_t page = MappedFile::page_size();
+            size_t end  = off / page * page;
+            file.release(released, end - released);
+            released = end;
+        }
+    }
+    _sent += size;
+}
+
+uint64_t DirectorySender::bytes_sent() const { return _sent; }
+
+size_t DirectorySender::files_sent() const
+{
+    size_t files = count_if(_entries.begin(), _entries.end(), [](const Entry& e) { return !(e.mode & MANIFEST_DIR); });
+    return files - _failed;
+}
+
+size_t DirectorySender::files_failed() const { return _failed + _rejected; }
+
+bool DirectorySender::confirmed() const { return _confirmed; }
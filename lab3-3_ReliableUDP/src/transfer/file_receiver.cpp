@@ -0,0 +1,522 @@
+#include <transfer/file_receiver.h>
+#include <transfer/chunk_hash.h>
+#include <transfer/delta_index.h>
+#include <net/rudp/rudp_defs.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+FileReceiver::FileReceiver(const string& dir) : _dir(dir), _reply_id(0), _block_size(0), _result{0, 0, 0} {}
+
+void FileReceiver::on_packet(const PacketBuf& packet)
+{
+    switch (static_cast<FileMsg>(packet->header.msg_type))
+    {
+        case FileMsg::NAME: _on_name(packet); break;
+        case FileMsg::DATA: _on_data(packet); break;
+        case FileMsg::MANIFEST: _on_manifest(packet); break;
+        case FileMsg::PACK: _on_pack(packet, false); break;
+        case FileMsg::SKIP: _on_skip(packet); break;
+        case FileMsg::COPY: _on_copy(packet); break;
+        case FileMsg::QUERY:
+        {
+            // 应答可能丢失，发送方超时后询问，原样重发
+            ReplyQuery query;
+            if (packet->header.data_len < sizeof(query)) return;
+            memcpy(&query, packet->body, sizeof(query));
+            if (!_reply) break;
+            {
+                lock_guard<mutex> lk(_result_mtx);
+                if (_result.id && query.id == _result.id)
+                {
+                    _reply(static_cast<uint16_t>(FileMsg::RESULT), reinterpret_cast<const char*>(&_result),
+                        sizeof(_result));
+                    break;
+                }
+            }
+            if (query.id != _reply_id) break;
+            if (!_reply_cache.empty())
+                _reply(static_cast<uint16_t>(FileMsg::RESUME), _reply_cache.data(), _reply_cache.size());
+            else
+                _send_signatures(query.first);
+            break;
+        }
+        default: break;
+    }
+}
+
+void FileReceiver::_on_name(const PacketBuf& packet)
+{
+    FileHeader header;
+    if (packet->header.data_len < sizeof(header))
+    {
+        cerr << "Malformed file header." << endl;
+        return;
+    }
+    memcpy(&header, packet->body, sizeof(header));
+    string fileName(packet->body + sizeof(header), packet->header.data_len - sizeof(header));
+    string filePath = _dir + "/" + fileName;
+    cout << "Receiving file: " << fileName << " (" << header.size << " bytes)" << endl;
+
+    // 旁路记录与文件都在且长度、分块一致时沿用已有内容，否则从头接收并新建记录
+    unique_ptr<ResumeJournal> journal;
+    bool                      reuse   = false;
+    string                    sidecar = filePath + RESUME_SUFFIX;
+    error_code                ec;
+    if (ResumeJournal::valid(header.size, header.chunk_size))
+    {
+        journal = make_unique<ResumeJournal>();
+        reuse   = journal->load(sidecar, header.size, header.chunk_size) &&
+                fs::file_size(filePath, ec) == header.size && !ec;
+    }
+    // 没有可续传的记录而已有同名文件时以它为基础增量接收，不再需要旁路记录
+    bool delta = header.flags & FILE_DELTA;
+    if (!reuse && delta && _delta(header.id, filePath, header.size))
+    {
+        journal.reset();
+        fs::remove(sidecar, ec);
+        return;
+    }
+    if (journal && !reuse && !journal->create(sidecar, header.size, header.chunk_size)) journal.reset();
+
+    bool opened = _open(header.id, filePath, header.size, 0, nullptr, !reuse);
+    if (!opened) cerr << "Failed to open file: " << filePath << endl;
+    // 发送方请求了续传或增量就一定等应答，打开失败时也回一个没有可跳过块的应答
+    if (header.chunk_size || delta)
+        _resume(header.id, filePath, opened ? header.chunk_size : 0, std::move(journal), reuse);
+}
+
+bool FileReceiver::_delta(uint32_t id, const string& path, uint64_t size)
+{
+    auto     basis = make_shared<MappedFile>();
+    uint32_t block = 0;
+    if (size && basis->open(path)) block = DeltaIndex::block_size_for(basis->size());
+    if (!block || basis->size() < block || !_open(id, path + DELTA_SUFFIX, size, 0, nullptr)) return false;
+
+    Incoming& file  = _files[id];
+    file.basis      = basis;
+    file.block_size = block;
+    file.target     = path;
+
+    // 签名在收包线程中计算，此时发送方正等待应答，连接上没有别的数据
+    _signatures = DeltaIndex::sign(basis->data(), basis->size(), block);
+    _block_size = block;
+    _reply_id   = id;
+    _reply_cache.clear();
+    cout << "Delta against the existing copy: " << _signatures.size() << " blocks of " << block << " bytes." << endl;
+    _send_signatures(0);
+    return true;
+}
+
+void FileReceiver::_send_signatures(uint32_t first)
+{
+    // 签名可能超过一个应答，按页从first起依次发出；发送方收不齐时从缺的第一块起再要
+    uint32_t count = static_cast<uint32_t>(_signatures.size());
+    size_t   page  = (BODY_SIZE - sizeof(SignatureHeader)) / sizeof(BlockSignature);
+    for (vector<char> reply; _reply && first < count; first += static_cast<uint32_t>(page))
+    {
+        SignatureHeader header{_reply_id, _block_size, count, first};
+        const char*     raw  = reinterpret_cast<const char*>(&header);
+        const char*     sigs = reinterpret_cast<const char*>(_signatures.data() + first);
+        reply.assign(raw, raw + sizeof(header));
+        reply.insert(reply.end(), sigs, sigs + min<size_t>(page, count - first) * sizeof(BlockSignature));
+        _reply(static_cast<uint16_t>(FileMsg::SIGNATURE), reply.data(), reply.size());
+    }
+}
+
+void FileReceiver::_on_copy(const PacketBuf& packet)
+{
+    CopyHeader header;
+    if (packet->header.data_len < sizeof(header)) return;
+    memcpy(&header, packet->body, sizeof(header));
+    if (packet->header.data_len < sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(CopyRecord)) return;
+
+    // 引用的块直接从已有副本的映射区写入，映射由文件关闭回调持有到写完
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        auto it = _files.find(header.id);
+        if (it == _files.end() || !it->second.basis) return;
+        const Incoming& file = it->second;
+
+        CopyRecord record;
+        memcpy(&record, packet->body + sizeof(header) + i * sizeof(record), sizeof(record));
+        uint64_t from = static_cast<uint64_t>(record.block) * file.block_size;
+        uint64_t len  = static_cast<uint64_t>(record.count) * file.block_size;
+        if (from + len > file.basis->size() || record.offset + len > file.size)
+        {
+            cerr << "Malformed copy record." << endl;
+            return;
+        }
+        _sink.write(header.id, record.offset, PacketBuf(), file.basis->data() + from, len);
+        _received(header.id, record.offset, len);
+    }
+}
+
+void FileReceiver::_resume(uint32_t id, const string& path, uint32_t chunk_size, unique_ptr<ResumeJournal> journal,
+    bool reuse)
+{
+    auto     it    = _files.find(id);
+    uint64_t size  = it != _files.end() ? it->second.size : 0;
+    uint32_t count = ResumeJournal::valid(size, chunk_size) ? (size + chunk_size - 1) / chunk_size : 0;
+
+    ResumeState  state{id, count};
+    vector<char> reply(sizeof(state) + (count + 7) / 8);
+    memcpy(reply.data(), &state, sizeof(state));
+
+    if (count)
+    {
+        Incoming& file  = it->second;
+        file.chunk_size = chunk_size;
+        file.journal    = std::move(journal);
+        for (uint32_t c = 0; c < count; ++c)
+            file.chunk_left.push_back(min<uint64_t>(chunk_size, size - static_cast<uint64_t>(c) * chunk_size));
+
+        // 记录为完成的块只是候选，算出散列交给发送方与源文件比对；校验在收包线程中进行，
+        // 此时发送方正等待应答，连接上没有别的数据
+        MappedFile data;
+        uint32_t   found = 0;
+        if (reuse && file.journal && data.open(path) && data.size() == size)
+            for (uint32_t c = 0; c < count; ++c)
+            {
+                if (!file.journal->done(c)) continue;
+                uint64_t    off  = static_cast<uint64_t>(c) * chunk_size;
+                uint64_t    hash = chunkHash(data.data() + off, file.chunk_left[c]);
+                const char* raw  = reinterpret_cast<const char*>(&hash);
+                data.release(off, file.chunk_left[c]);
+                reply[sizeof(state) + c / 8] |= 1 << (c % 8);
+                reply.insert(reply.end(), raw, raw + sizeof(hash));
+                ++found;
+            }
+        if (found) cout << "Found " << found << " of " << count << " chunks from an earlier transfer." << endl;
+    }
+
+    _reply_id    = id;
+    _reply_cache = std::move(reply);
+    _signatures.clear();
+    if (_reply) _reply(static_cast<uint16_t>(FileMsg::RESUME), _reply_cache.data(), _reply_cache.size());
+}
+
+void FileReceiver::_on_skip(const PacketBuf& packet)
+{
+    ResumeState state;
+    if (packet->header.data_len < sizeof(state)) return;
+    memcpy(&state, packet->body, sizeof(state));
+
+    auto it = _files.find(state.id);
+    if (it == _files.end() || state.count != it->second.chunk_left.size() ||
+        packet->header.data_len < sizeof(state) + (state.count + 7) / 8)
+        return;
+
+    // 跳过的块按已收到计入；已有数据到达的块说明并未跳过，不重复计入
+    const uint8_t* bits       = reinterpret_cast<const uint8_t*>(packet->body + sizeof(state));
+    uint64_t       chunk_size = it->second.chunk_size;
+    uint64_t       skipped    = 0;
+    for (uint32_t c = 0; c < state.count; ++c)
+    {
+        if (!(bits[c / 8] >> (c % 8) & 1)) continue;
+        it = _files.find(state.id);
+        if (it == _files.end()) break;
+        uint64_t len = min<uint64_t>(chunk_size, it->second.size - c * chunk_size);
+        if (it->second.chunk_left[c] != len) continue;
+        skipped += len;
+        _received(state.id, c * chunk_size, len);
+    }
+    if (skipped) cout << "Resumed: " << skipped << " bytes already on disk." << endl;
+}
+
+bool FileReceiver::on_early(const PacketBuf& packet)
+{
+    // 文件名与清单必须按序处理；尚未打开的文件的分片留给按序交付，到时再按编号判断
+    switch (static_cast<FileMsg>(packet->header.msg_type))
+    {
+        case FileMsg::DATA:
+        {
+            SegmentHeader header;
+            if (packet->header.data_len < sizeof(header)) return false;
+            memcpy(&header, packet->body, sizeof(header));
+            if (!_files.count(header.id)) return false;
+            return _on_data(packet);
+        }
+        case FileMsg::PACK: return _on_pack(packet, true);
+        default: return false;
+    }
+}
+
+void FileReceiver::_on_manifest(const PacketBuf& packet)
+{
+    const char* p    = packet->body;
+    size_t      left = packet->header.data_len;
+
+    if (CHK_MSB(*packet))
+    {
+        ManifestHeader header;
+        if (left < sizeof(header))
+        {
+            cerr << "Malformed manifest header." << endl;
+            return;
+        }
+        memcpy(&header, p, sizeof(header));
+        p += sizeof(header);
+        left -= sizeof(header);
+
+        _batch          = make_shared<Batch>();
+        _batch->count   = header.count;
+        _batch->bytes   = header.bytes;
+        _batch->start   = steady_clock::now();
+        _batch->pending = header.count + 1;
+    }
+    if (!_batch) return;
+
+    while (left)
+    {
+        ManifestEntry entry;
+        if (left < sizeof(entry))
+        {
+            cerr << "Malformed manifest entry." << endl;
+            break;
+        }
+        memcpy(&entry, p, sizeof(entry));
+        if (left - sizeof(entry) < entry.name_len)
+        {
+            cerr << "Malformed manifest entry." << endl;
+            break;
+        }
+        string name(p + sizeof(entry), entry.name_len);
+        p += sizeof(entry) + entry.name_len;
+        left -= sizeof(entry) + entry.name_len;
+
+        // 只接受指向dir之内的相对路径
+        fs::path rel = fs::path(name).lexically_normal();
+        if (rel.empty() || rel.has_root_path() || *rel.begin() == "..")
+        {
+            cerr << "Unsafe path in manifest: " << name << ". Skipping." << endl;
+            ++_batch->failed;
+            _release(*_batch);
+            continue;
+        }
+        if (_batch->root.empty()) _batch->root = rel.begin()->string();
+        if (!_batch->id) _batch->id = entry.id;
+
+        error_code ec;
+        fs::path   path = fs::path(_dir) / rel;
+        if (entry.mode & MANIFEST_DIR)
+        {
+            fs::create_directories(path, ec);
+            if (ec)
+            {
+                cerr << "Failed to create directory: " << path.string() << endl;
+                ++_batch->failed;
+            }
+            _batch->dirs.emplace_back(path.string(), entry.mode);
+            _release(*_batch);
+            continue;
+        }
+
+        // 只登记不打开，成千上万的文件不会同时占用描述符
+        fs::create_directories(path.parent_path(), ec);
+        if (!_open(entry.id, path.string(), entry.size, entry.mode, _batch, true, true))
+        {
+            cerr << "Failed to open file: " << path.string() << endl;
+            ++_batch->failed;
+            _release(*_batch);
+        }
+    }
+
+    if (CHK_MSE(*packet))
+    {
+        cout << "Receiving directory: " << _batch->root << " (" << _batch->count << " entries, " << _batch->bytes
+             << " bytes)" << endl;
+        _release(*_batch);
+        _batch.reset();
+    }
+}
+
+bool FileReceiver::_open(
+    uint32_t id, const string& path, uint64_t size, uint32_t mode, shared_ptr<Batch> batch, bool truncate, bool defer)
+{
+    // 空文件不会有分片到达，总是立即创建
+    defer = defer && size;
+    if (!defer && !_sink.open(id, path, size, truncate)) return false;
+    _files[id] = Incoming{size, 0, mode, std::move(batch), 0, {}, nullptr, nullptr, 0, {}, defer ? path : string()};
+    if (size == 0) _received(id, 0, 0);
+    return true;
+}
+
+bool FileReceiver::_opened(uint32_t id)
+{
+    auto it = _files.find(id);
+    if (it == _files.end()) return false;
+    Incoming& file = it->second;
+    if (file.path.empty()) return true;
+    if (_sink.open(id, file.path, file.size))
+    {
+        file.path.clear();
+        return true;
+    }
+
+    cerr << "Failed to open file: " << file.path << endl;
+    shared_ptr<Batch> batch = std::move(file.batch);
+    _files.erase(it);
+    if (batch)
+    {
+        ++batch->failed;
+        _release(*batch);
+    }
+    return false;
+}
+
+bool FileReceiver::_on_data(const PacketBuf& packet)
+{
+    SegmentHeader header;
+    if (packet->header.data_len < sizeof(header)) return false;
+    memcpy(&header, packet->body, sizeof(header));
+
+    auto it = _files.find(header.id);
+    if (it == _files.end())
+    {
+        cerr << "Received data for unknown file " << header.id << ". Dropping." << endl;
+        return true;
+    }
+
+    size_t len  = packet->header.data_len - sizeof(header);
+    size_t size = it->second.size;
+    if (header.offset > size || len > size - header.offset)
+    {
+        cerr << "Segment at " << header.offset << " exceeds file size " << size << ". Dropping." << endl;
+        return true;
+    }
+    if (!_opened(header.id)) return true;
+    _sink.write(header.id, header.offset, packet, packet->body + sizeof(header), len);
+    _received(header.id, header.offset, len);
+    return true;
+}
+
+bool FileReceiver::_on_pack(const PacketBuf& packet, bool early)
+{
+    const char* body = packet->body;
+    size_t      len  = packet->header.data_len;
+
+    // 提前交付时所有记录都须属于已打开的文件，否则整包留给按序交付
+    for (size_t off = 0; early && off + sizeof(PackRecord) <= len;)
+    {
+        PackRecord record;
+        memcpy(&record, body + off, sizeof(record));
+        if (!_files.count(record.id)) return false;
+        off += sizeof(record) + record.len;
+    }
+
+    for (size_t off = 0; off < len;)
+    {
+        PackRecord record;
+        if (len - off < sizeof(record))
+        {
+            cerr << "Malformed pack record." << endl;
+            break;
+        }
+        memcpy(&record, body + off, sizeof(record));
+        off += sizeof(record);
+        if (len - off < record.len)
+        {
+            cerr << "Malformed pack record." << endl;
+            break;
+        }
+
+        auto it = _files.find(record.id);
+        if (it == _files.end())
+            cerr << "Received data for unknown file " << record.id << ". Dropping." << endl;
+        else if (record.len > it->second.size)
+            cerr << "Packed file " << record.id << " exceeds file size " << it->second.size << ". Dropping." << endl;
+        else if (_opened(record.id))
+        {
+            _sink.write(record.id, 0, packet, body + off, record.len);
+            _received(record.id, 0, record.len);
+        }
+        off += record.len;
+    }
+    return true;
+}
+
+void FileReceiver::_received(uint32_t id, uint64_t offset, size_t len)
+{
+    auto      it   = _files.find(id);
+    Incoming& file = it->second;
+    file.received += len;
+
+    // 块收齐即记入旁路记录，数据可能仍在写入队列中，续传时靠散列核对兜底
+    for (uint64_t pos = offset, end = offset + len; file.chunk_size && pos < end;)
+    {
+        uint32_t  c    = static_cast<uint32_t>(pos / file.chunk_size);
+        uint64_t  stop = min<uint64_t>(end, static_cast<uint64_t>(c + 1) * file.chunk_size);
+        uint64_t& left = file.chunk_left[c];
+        left -= min(left, stop - pos);
+        if (!left && file.journal) file.journal->mark(c);
+        pos = stop;
+    }
+    if (file.received < file.size) return;
+
+    uint32_t               mode      = file.mode;
+    shared_ptr<Batch>      batch     = std::move(file.batch);
+    bool                   journaled = file.journal != nullptr;
+    shared_ptr<MappedFile> basis     = std::move(file.basis);
+    string                 target    = std::move(file.target);
+    _files.erase(it);
+    _sink.close(id, [this, mode, batch, journaled, basis, target](const string& path, bool ok) {
+        error_code ec;
+        // 增量传输的新内容收齐落盘后才替换原文件，期间中断原文件不受影响
+        if (ok && !target.empty())
+        {
+            fs::rename(path, target, ec);
+            ok = !ec;
+        }
+        if (ok && mode) fs::permissions(path, static_cast<fs::perms>(mode & 07777), ec);
+        // 同步完成后才删除旁路记录，之前中断仍可续传
+        if (ok && journaled) fs::remove(path + RESUME_SUFFIX, ec);
+        if (batch)
+        {
+            if (!ok)
+            {
+                cerr << "Failed to write file: " << path << endl;
+                ++batch->failed;
+            }
+            _release(*batch);
+        }
+        else if (ok)
+            cout << "File received successfully." << endl;
+        else
+            cerr << "Failed to write file: " << path << endl;
+    });
+}
+
+void FileReceiver::_release(Batch& batch)
+{
+    if (--batch.pending == 0) _finish(batch);
+}
+
+void FileReceiver::_finish(Batch& batch)
+{
+    // 由深到浅设置目录权限，子目录先于父目录变为只读
+    error_code ec;
+    for (auto it = batch.dirs.rbegin(); it != batch.dirs.rend(); ++it)
+        if (it->second & 07777) fs::permissions(it->first, static_cast<fs::perms>(it->second & 07777), ec);
+
+    auto duration = duration_cast<milliseconds>(steady_clock::now() - batch.start);
+    cout << "Directory " << batch.root << " received: " << batch.count << " entries, " << batch.bytes << " bytes in "
+         << duration.count() << " milliseconds." << endl;
+    if (duration.count() > 0)
+        cout << "Throughput: " << batch.bytes * 8.0 / duration.count() / 1000 << " mbps." << endl;
+    if (batch.failed) cerr << batch.failed << " entries of " << batch.root << " were not received intact." << endl;
+
+    // 应答不可靠，发送方收不到时以QUERY索取
+    lock_guard<mutex> lk(_result_mtx);
+    _result = BatchResult{batch.id, static_cast<uint32_t>(batch.count), static_cast<uint32_t>(batch.failed)};
+    if (_reply)
+        _reply(static_cast<uint16_t>(FileMsg::RESULT), reinterpret_cast<const char*>(&_result), sizeof(_result));
+}
+
+void FileReceiver::set_reply(reply_callback cb) { _reply = std::move(cb); }
+
+void FileReceiver::flush() { _sink.flush(); }
@@ -0,0 +1,368 @@
+#include <transfer/file_sender.h>
+#include <transfer/chunk_hash.h>
+#include <transfer/delta_index.h>
+#include <transfer/resume_journal.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+using namespace std;
+using namespace chrono;
+
+namespace
+{
+    atomic<uint32_t> next_file_id(1);
+}  // namespace
+
+// 每个分片的负载含SegmentHeader，文件内容占其余部分
+FileSender::FileSender(RUDP_C& conn, size_t mss)
+    : _conn(conn),
+      _mss(max<size_t>(sizeof(SegmentHeader) + 1, min<size_t>(mss, BODY_SIZE))),
+      _sent(0),
+      _skipped(0),
+      _chunk_size(0),
+      _delta(false),
+      _block_size(0),
+      _pos(0),
+      _done(false)
+{}
+
+void FileSender::_read_ahead_handler()
+{
+    size_t             fetched = 0;
+    unique_lock<mutex> lk(_mtx);
+    while (!_done && fetched < _file.size())
+    {
+        if (_skipped_at(fetched))
+        {
+            fetched = (fetched / _chunk_size + 1) * _chunk_size;
+            continue;
+        }
+        size_t target = min(_file.size(), _pos + READ_AHEAD_SIZE);
+        if (fetched >= target)
+        {
+            _cv.wait(lk);
+            continue;
+        }
+
+        // 缺页在本线程发生，不持锁，发送线程随时可以推进位置；不越过块边界，以免读入跳过的块
+        size_t len = min<size_t>(target - fetched, READ_AHEAD_STEP);
+        if (_chunk_size) len = min<size_t>(len, (fetched / _chunk_size + 1) * _chunk_size - fetched);
+        lk.unlock();
+        _file.prefetch(fetched, len);
+        fetched += len;
+        lk.lock();
+    }
+}
+
+void FileSender::_advance(size_t pos)
+{
+    {
+        lock_guard<mutex> lk(_mtx);
+        _pos = pos;
+    }
+    _cv.notify_one();
+}
+
+bool FileSender::_skipped_at(size_t off) const { return _chunk_size && _skip[off / _chunk_size]; }
+
+uint16_t FileSender::_await_reply(uint32_t id, vector<char>& resume)
+{
+    // 应答不可靠，超时后发QUERY请求重发，签名只要缺的第一块起的部分；接收方校验已有块或计算签名
+    // 时可能较久，超时逐次加倍
+    vector<char> reply;
+    uint16_t     type;
+    vector<bool> have;       // 已收到的签名
+    uint32_t     first = 0;  // 第一个尚未收到的签名
+    milliseconds timeout(RESUME_REPLY_TIMEOUT);
+    for (int retry = 0; retry <= RESUME_QUERY_RETRIES; ++retry, timeout *= 2)
+    {
+        if (retry)
+        {
+            ReplyQuery query{id, first};
+            const char* raw = reinterpret_cast<const char*>(&query);
+            _conn.send_fragment(static_cast<uint16_t>(FileMsg::QUERY), raw, sizeof(query), true, true);
+        }
+        auto deadline = steady_clock::now() + timeout;
+        for (milliseconds left = timeout; _conn.recv_reply(type, reply, left);
+             left = max(milliseconds(0), duration_cast<milliseconds>(deadline - steady_clock::now())))
+        {
+            // 此前传输遗留的应答与其他类型的应答直接丢弃
+            ResumeState state;
+            if (type == static_cast<uint16_t>(FileMsg::RESUME) && reply.size() >= sizeof(state))
+            {
+                memcpy(&state, reply.data(), sizeof(state));
+                if (state.id != id) continue;
+                resume = std::move(reply);
+                return type;
+            }
+
+            SignatureHeader header;
+            if (type != static_cast<uint16_t>(FileMsg::SIGNATURE) || reply.size() < sizeof(header)) continue;
+            memcpy(&header, reply.data(), sizeof(header));
+            if (header.id != id || !header.block_size) continue;
+            if (have.empty())
+            {
+                _block_size = header.block_size;
+                _signatures.assign(header.count, BlockSignature{0, 0});
+                have.assign(header.count, false);
+            }
+            if (header.count != have.size() || header.block_size != _block_size || header.first > header.count)
+                continue;
+
+            size_t n = (reply.size() - sizeof(header)) / sizeof(BlockSignature);
+            n        = min<size_t>(n, header.count - header.first);
+            memcpy(_signatures.data() + header.first, reply.data() + sizeof(header), n * sizeof(BlockSignature));
+            fill(have.begin() + header.first, have.begin() + header.first + n, true);
+            while (first < have.size() && have[first]) ++first;
+            if (first == have.size()) return type;
+        }
+    }
+
+    // 接收方已进入增量接收但签名没能收齐，不引用任何块，全部内容照常发送
+    _signatures.clear();
+    return have.empty() ? 0 : static_cast<uint16_t>(FileMsg::SIGNATURE);
+}
+
+void FileSender::_skip_chunks(uint32_t id, const vector<char>& resume)
+{
+    size_t   size  = _file.size();
+    uint32_t count = static_cast<uint32_t>((size + _chunk_size - 1) / _chunk_size);
+    _skip.assign(count, false);
+
+    ResumeState state{id, 0};
+    if (resume.size() >= sizeof(state)) memcpy(&state, resume.data(), sizeof(state));
+    size_t bitmap = (count + 7) / 8;
+    if (state.count == count && resume.size() >= sizeof(state) + bitmap)
+    {
+        // 接收方已有的块只是候选，与源文件的散列一致才跳过
+        const uint8_t* bits = reinterpret_cast<const uint8_t*>(resume.data() + sizeof(state));
+        size_t         pos  = sizeof(state) + bitmap;
+        for (uint32_t c = 0; c < count && pos + sizeof(uint64_t) <= resume.size(); ++c)
+        {
+            if (!(bits[c / 8] >> (c % 8) & 1)) continue;
+            uint64_t hash;
+            memcpy(&hash, resume.data() + pos, sizeof(hash));
+            pos += sizeof(hash);
+
+            size_t off = static_cast<size_t>(c) * _chunk_size;
+            size_t len = min<size_t>(_chunk_size, size - off);
+            _skip[c]   = chunkHash(_file.data() + off, len) == hash;
+            if (_skip[c]) _skipped += len;
+            _file.release(off, len);
+        }
+    }
+
+    // 无论是否跳过都发SKIP，接收方据此把跳过的块计入进度
+    vector<char> skip(sizeof(state) + bitmap);
+    state.count = count;
+    memcpy(skip.data(), &state, sizeof(state));
+    for (uint32_t c = 0; c < count; ++c)
+        if (_skip[c]) skip[sizeof(state) + c / 8] |= 1 << (c % 8);
+    _conn.send_fragment(static_cast<uint16_t>(FileMsg::SKIP), skip.data(), skip.size(), true, true);
+}
+
+bool FileSender::send(const string& path)
+{
+    _sent    = 0;
+    _skipped = 0;
+    if (!_file.open(path)) return false;
+
+    // 不足一块的文件续传省不下什么，不协商
+    size_t size = _file.size();
+    _chunk_size = size > RESUME_CHUNK_SIZE ? ResumeJournal::chunk_size_for(size) : 0;
+    if (!ResumeJournal::valid(size, _chunk_size)) _chunk_size = 0;
+    _skip.clear();
+    _signatures.clear();
+
+    bool       delta = _delta && size;
+    string     name  = path.substr(path.find_last_of("/\\") + 1);
+    FileHeader header{next_id(), size, _chunk_size, delta ? FILE_DELTA : 0u};
+    _conn.send_fragment(static_cast<uint16_t>(FileMsg::NAME),
+        reinterpret_cast<const char*>(&header),
+        sizeof(header),
+        name.c_str(),
+        name.size(),
+        true,
+        true);
+
+    // 接收方选了增量接收时不再按块续传
+    vector<char> resume;
+    bool         diff = (_chunk_size || delta) &&
+                _await_reply(header.id, resume) == static_cast<uint16_t>(FileMsg::SIGNATURE);
+    if (diff) _chunk_size = 0;
+    if (_chunk_size) _skip_chunks(header.id, resume);
+
+    _pos  = 0;
+    _done = false;
+    thread read_ahead([this]() { _read_ahead_handler(); });
+
+    // 没有可引用的块时与普通发送相同
+    if (diff && !_signatures.empty())
+        _send_delta(header.id);
+    else
+        _send_chunks(header.id);
+
+    {
+        lock_guard<mutex> lk(_mtx);
+        _done = true;
+    }
+    _cv.notify_one();
+    read_ahead.join();
+
+    _file.close();
+    return true;
+}
+
+void FileSender::_send_chunks(uint32_t id)
+{
+    // 最后一个要发送的字节之后，跳过的块不再发送；空文件随NAME即已完整，不发DATA
+    size_t size = _file.size();
+    size_t last = size;
+    while (last && _skipped_at(last - 1)) last = (last - 1) / _chunk_size * _chunk_size;
+
+    // 其余内容是一条DATA消息，首尾分片携带消息起止标记；分片不跨块边界，跳过的块不会混入
+    const char* data     = _file.data();
+    size_t      chunk    = _mss - sizeof(SegmentHeader);
+    size_t      released = 0;
+    for (size_t off = 0; off < last;)
+    {
+        if (_skipped_at(off))
+        {
+            off      = (off / _chunk_size + 1) * _chunk_size;
+            released = off;
+            _advance(off);
+            continue;
+        }
+
+        size_t len = min(chunk, last - off);
+        if (_chunk_size) len = min(len, (off / _chunk_size + 1) * _chunk_size - off);
+        SegmentHeader segment{id, off};
+        _conn.send_fragment(static_cast<uint16_t>(FileMsg::DATA),
+            reinterpret_cast<const char*>(&segment),
+            sizeof(segment),
+            data + off,
+            len,
+            _sent == 0,
+            off + len == last);
+        off += len;
+        _sent += len;
+
+        if (off - released >= READ_AHEAD_STEP || off == last)
+        {
+            _advance(off);
+
+            // 报文已拷入发送缓冲区，重传不再读映射区，发出的整页可以回收
+            size_t page = MappedFile::page_size();
+            size_t end  = off / page * page;
+            _file.release(released, end - released);
+            released = end;
+        }
+    }
+}
+
+void FileSender::_send_delta(uint32_t id)
+{
+    const char*     data  = _file.data();
+    size_t          size  = _file.size();
+    size_t          block = _block_size;
+    DeltaIndex      index(std::move(_signatures), block);
+    RollingChecksum rolling;
+
+    vector<CopyRecord> records;
+    size_t             per      = max<size_t>(1, (_mss - sizeof(CopyHeader)) / sizeof(CopyRecord));
+    size_t             literal  = 0;  // 尚未发出的不匹配内容的起点
+    size_t             pos      = 0;  // 扫描位置
+    size_t             released = 0;
+    uint32_t           hint     = UINT32_MAX;
+    while (pos + block <= size)
+    {
+        // 整批算出弱校验和再逐个查找，匹配后跳过一个块，之后的位置可能落在下一批
+        size_t          count = min<size_t>(DELTA_SCAN_BATCH, size - block + 1 - pos);
+        const uint32_t* weak  = rolling.scan(data + pos, count, block);
+        size_t          i     = 0;
+        while (i < count)
+        {
+            uint32_t match = index.find(weak[i], data + pos + i, hint);
+            if (match == UINT32_MAX)
+            {
+                ++i;
+                continue;
+            }
+            _send_literal(id, literal, pos + i);
+
+            // 与上一条记录首尾相接时合并，未改动的区域只占一条记录
+            CopyRecord* last = records.empty() ? nullptr : &records.back();
+            if (last && last->block + last->count == match && last->offset + last->count * block == pos + i)
+                ++last->count;
+            else
+                records.push_back(CopyRecord{pos + i, match, 1});
+            if (records.size() > per) _send_copies(id, records);
+
+            hint = match + 1;
+            i += block;
+            literal = pos + i;
+            _skipped += block;
+        }
+        pos += i;
+
+        // 长段不匹配的内容边扫描边发出，不必等到下一次匹配
+        if (pos - literal >= READ_AHEAD_STEP)
+        {
+            _send_literal(id, literal, pos);
+            literal = pos;
+        }
+        _advance(pos);
+        size_t page = MappedFile::page_size();
+        size_t end  = min(literal, pos) / page * page;
+        _file.release(released, end - released);
+        released = end;
+    }
+    _send_literal(id, literal, size);
+    _send_copies(id, records);
+}
+
+void FileSender::_send_literal(uint32_t id, size_t from, size_t to)
+{
+    // 与COPY交错发送，每个分片单独成为一条消息
+    size_t chunk = _mss - sizeof(SegmentHeader);
+    for (size_t off = from; off < to;)
+    {
+        size_t        len = min(chunk, to - off);
+        SegmentHeader segment{id, off};
+        _conn.send_fragment(static_cast<uint16_t>(FileMsg::DATA),
+            reinterpret_cast<const char*>(&segment),
+            sizeof(segment),
+            _file.data() + off,
+            len,
+            true,
+            true);
+        off += len;
+        _sent += len;
+    }
+}
+
+void FileSender::_send_copies(uint32_t id, vector<CopyRecord>& records)
+{
+    size_t per = max<size_t>(1, (_mss - sizeof(CopyHeader)) / sizeof(CopyRecord));
+    for (size_t i = 0; i < records.size(); i += per)
+    {
+        CopyHeader header{id, static_cast<uint32_t>(min(per, records.size() - i))};
+        _conn.send_fragment(static_cast<uint16_t>(FileMsg::COPY),
+            reinterpret_cast<const char*>(&header),
+            sizeof(header),
+            reinterpret_cast<const char*>(records.data() + i),
+            header.count * sizeof(CopyRecord),
+            true,
+            true);
+    }
+    records.clear();
+}
+
+void FileSender::set_delta(bool enabled) { _delta = enabled; }
+
+size_t FileSender::bytes_sent() const { return _sent; }
+
+size_t FileSender::bytes_skipped() const { return _skipped; }
+
+uint32_t FileSender::next_id(uint32_t count) { return next_file_id.fetch_add(count); }
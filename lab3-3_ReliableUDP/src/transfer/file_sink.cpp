@@ -0,0 +1,154 @@
+#include <transfer/file_sink.h>
+#include <fstream>
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+struct FileSink::Target
+{
+    string   path;
+    bool     ok       = true;
+    uint64_t unsynced = 0;  // 上次fdatasync之后写入的字节数
+#ifdef __linux__
+    int fd = -1;
+    ~Target()
+    {
+        if (fd >= 0) ::close(fd);
+    }
+#else
+    fstream file;
+#endif
+};
+
+FileSink::FileSink() : _busy(0), _stop(false) { _writer = thread([this]() { _writer_handler(); }); }
+
+FileSink::~FileSink()
+{
+    {
+        lock_guard<mutex> lk(_mtx);
+        _stop = true;
+    }
+    _cv.notify_all();
+    _writer.join();
+}
+
+bool FileSink::open(uint32_t id, const string& path, uint64_t size, bool truncate)
+{
+    close(id);
+
+    auto target  = make_shared<Target>();
+    target->path = path;
+#ifdef __linux__
+    target->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (target->fd < 0) return false;
+    // 一次分配好全部空间，乱序写入不会产生碎片或稀疏空洞；文件系统不支持时按长度截断
+    if (size && fallocate(target->fd, 0, 0, static_cast<off_t>(size)) < 0 &&
+        ftruncate(target->fd, static_cast<off_t>(size)) < 0)
+        return false;
+#else
+    target->file.open(path, ios::binary | ios::in | ios::out | (truncate ? ios::trunc : ios::openmode()));
+    if (!target->file.is_open()) return false;
+    if (size && truncate)
+    {
+        target->file.seekp(static_cast<streamoff>(size - 1));
+        target->file.put('\0');
+    }
+#endif
+    _files[id] = std::move(target);
+    return true;
+}
+
+void FileSink::_push(Job job)
+{
+    unique_lock<mutex> lk(_mtx);
+    _cv.wait(lk, [this]() { return _jobs.size() < SINK_QUEUE_DEPTH; });
+    _jobs.push_back(std::move(job));
+    _cv.notify_all();
+}
+
+void FileSink::write(uint32_t id, uint64_t offset, const PacketBuf& packet, const char* data, size_t len)
+{
+    auto it = _files.find(id);
+    if (it == _files.end() || !len) return;
+    _push(Job{it->second, offset, packet, data, len, false, nullptr});
+}
+
+void FileSink::close(uint32_t id, done_callback done)
+{
+    auto it = _files.find(id);
+    if (it == _files.end()) return;
+    _push(Job{std::move(it->second), 0, PacketBuf(), nullptr, 0, true, std::move(done)});
+    _files.erase(it);
+}
+
+void FileSink::flush()
+{
+    unique_lock<mutex> lk(_mtx);
+    _cv.wait(lk, [this]() { return _jobs.empty() && _busy == 0; });
+}
+
+void FileSink::_writer_handler()
+{
+    unique_lock<mutex> lk(_mtx);
+    while (true)
+    {
+        _cv.wait(lk, [this]() { return !_jobs.empty() || _stop; });
+        if (_jobs.empty()) break;
+
+        Job job = std::move(_jobs.front());
+        _jobs.pop_front();
+        ++_busy;
+        _cv.notify_all();
+        lk.unlock();
+
+        Target& target = *job.target;
+#ifdef __linux__
+        if (job.close)
+        {
+            target.ok &= fdatasync(target.fd) == 0;
+            target.ok &= ::close(target.fd) == 0;
+            target.fd = -1;
+        }
+        else
+        {
+            for (size_t done = 0; done < job.len && target.ok;)
+            {
+                ssize_t ret = pwrite(target.fd, job.data + done, job.len - done, static_cast<off_t>(job.offset + done));
+                if (ret < 0 && errno == EINTR) continue;
+                if (ret <= 0)
+                    target.ok = false;
+                else
+                    done += static_cast<size_t>(ret);
+            }
+            target.unsynced += job.len;
+            if (target.unsynced >= SINK_SYNC_BYTES)
+            {
+                fdatasync(target.fd);
+                target.unsynced = 0;
+            }
+        }
+#else
+        if (job.close)
+        {
+            target.file.flush();
+            target.ok &= !target.file.fail();
+            target.file.close();
+        }
+        else
+        {
+            target.file.seekp(static_cast<streamoff>(job.offset));
+            target.file.write(job.data, job.len);
+            target.ok &= !target.file.fail();
+        }
+#endif
+        if (job.close && job.done) job.done(target.path, target.ok);
+        job = Job();
+
+        lk.lock();
+        --_busy;
+        _cv.notify_all();
+    }
+}
@@ -0,0 +1,106 @@
+#include <transfer/mapped_file.h>
+#include <algorithm>
+#include <fstream>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+MappedFile::MappedFile() : _data(nullptr), _size(0) {}
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const string& path)
+{
+    close();
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    _size = static_cast<size_t>(st.st_size);
+    if (_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    // 映射建立后即可关闭描述符，映射本身持有对文件的引用
+    void* base = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        _size = 0;
+        return false;
+    }
+    madvise(base, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(base);
+    return true;
+#else
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file.is_open()) return false;
+    _fallback.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(_fallback.data(), _fallback.size());
+    _data = _fallback.data();
+    _size = _fallback.size();
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef __linux__
+    if (_data) munmap(const_cast<char*>(_data), _size);
+#endif
+    _fallback.clear();
+    _data = nullptr;
+    _size = 0;
+}
+
+const char* MappedFile::data() const { return _data; }
+
+size_t MappedFile::size() const { return _size; }
+
+size_t MappedFile::page_size()
+{
+#ifdef __linux__
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+void MappedFile::prefetch(size_t offset, size_t len) const
+{
+    if (!_data || offset >= _size) return;
+    len = min(len, _size - offset);
+#ifdef __linux__
+    // 先让内核发起异步预读，再逐页读一个字节把页表建好
+    size_t page  = page_size();
+    size_t start = offset / page * page;
+    madvise(const_cast<char*>(_data) + start, offset + len - start, MADV_WILLNEED);
+    volatile char sink;
+    for (size_t off = start; off < offset + len; off += page) sink = _data[off];
+    (void)sink;
+#endif
+}
+
+void MappedFile::release(size_t offset, size_t len) const
+{
+#ifdef __linux__
+    if (!_data || offset >= _size) return;
+    size_t page  = page_size();
+    size_t start = offset / page * page;
+    len          = min(len, _size - offset);
+    madvise(const_cast<char*>(_data) + start, offset + len - start, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,162 @@
+#include <transfer/resume_journal.h>
+#include <transfer/file_msg.h>
+#include <net/rudp/rudp_defs.h>
+#include <algorithm>
+#include <cstring>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace
+{
+#pragma pack(1)
+    struct JournalHeader
+    {
+        char     magic[8];
+        uint64_t size;
+        uint32_t chunk_size;
+        uint32_t count;
+    };
+#pragma pack()
+
+    const char JOURNAL_MAGIC[8] = {'R', 'U', 'D', 'P', 'P', 'A', 'R', 'T'};
+
+    // RESUME应答中每块至多占1位位图加8字节散列
+    constexpr uint64_t MAX_CHUNKS = (BODY_SIZE - sizeof(ResumeState)) * 8 / 65;
+
+    uint32_t chunks(uint64_t size, uint32_t chunk_size)
+    {
+        return static_cast<uint32_t>((size + chunk_size - 1) / chunk_size);
+    }
+}  // namespace
+
+#ifdef __linux__
+ResumeJournal::ResumeJournal() : _size(0), _chunk_size(0), _fd(-1) {}
+#else
+ResumeJournal::ResumeJournal() : _size(0), _chunk_size(0) {}
+#endif
+
+ResumeJournal::~ResumeJournal() { close(); }
+
+bool ResumeJournal::load(const string& path, uint64_t size, uint32_t chunk_size)
+{
+    close();
+    if (!valid(size, chunk_size)) return false;
+
+    JournalHeader   header;
+    vector<uint8_t> done(chunks(size, chunk_size));
+    auto            matches = [&]() {
+        return !memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) && header.size == size &&
+               header.chunk_size == chunk_size && header.count == done.size();
+    };
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) return false;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || !matches() ||
+        pread(fd, done.data(), done.size(), sizeof(header)) != static_cast<ssize_t>(done.size()))
+    {
+        ::close(fd);
+        return false;
+    }
+    _fd = fd;
+#else
+    _file.open(path, ios::binary | ios::in | ios::out);
+    if (!_file.is_open()) return false;
+    _file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!_file || !matches() || !_file.read(reinterpret_cast<char*>(done.data()), done.size()))
+    {
+        _file.close();
+        return false;
+    }
+#endif
+    _size       = size;
+    _chunk_size = chunk_size;
+    _done       = std::move(done);
+    return true;
+}
+
+bool ResumeJournal::create(const string& path, uint64_t size, uint32_t chunk_size)
+{
+    close();
+    if (!valid(size, chunk_size)) return false;
+
+    JournalHeader header;
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.size       = size;
+    header.chunk_size = chunk_size;
+    header.count      = chunks(size, chunk_size);
+
+    vector<char> image(sizeof(header) + header.count, 0);
+    memcpy(image.data(), &header, sizeof(header));
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    if (pwrite(fd, image.data(), image.size(), 0) != static_cast<ssize_t>(image.size()))
+    {
+        ::close(fd);
+        return false;
+    }
+    _fd = fd;
+#else
+    _file.open(path, ios::binary | ios::in | ios::out | ios::trunc);
+    if (!_file.is_open() || !_file.write(image.data(), image.size()))
+    {
+        _file.close();
+        return false;
+    }
+#endif
+    _size       = size;
+    _chunk_size = chunk_size;
+    _done.assign(header.count, 0);
+    return true;
+}
+
+void ResumeJournal::close()
+{
+#ifdef __linux__
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+#else
+    if (_file.is_open()) _file.close();
+#endif
+    _done.clear();
+}
+
+uint32_t ResumeJournal::count() const { return static_cast<uint32_t>(_done.size()); }
+
+uint64_t ResumeJournal::chunk_len(uint32_t chunk) const
+{
+    uint64_t off = static_cast<uint64_t>(chunk) * _chunk_size;
+    return min<uint64_t>(_chunk_size, _size - off);
+}
+
+bool ResumeJournal::done(uint32_t chunk) const { return chunk < _done.size() && _done[chunk]; }
+
+void ResumeJournal::mark(uint32_t chunk)
+{
+    if (chunk >= _done.size() || _done[chunk]) return;
+    _done[chunk] = 1;
+    // 只改写该块的标记字节，由页缓存合并，不额外同步
+#ifdef __linux__
+    pwrite(_fd, &_done[chunk], 1, sizeof(JournalHeader) + chunk);
+#else
+    _file.seekp(static_cast<streamoff>(sizeof(JournalHeader) + chunk));
+    _file.write(reinterpret_cast<const char*>(&_done[chunk]), 1);
+    _file.flush();
+#endif
+}
+
+uint32_t ResumeJournal::chunk_size_for(uint64_t size)
+{
+    // 块数超过上限时按上限均分，再向上取整到RESUME_CHUNK_SIZE的倍数
+    uint64_t chunk = max<uint64_t>(RESUME_CHUNK_SIZE, (size + MAX_CHUNKS - 1) / MAX_CHUNKS);
+    chunk          = (chunk + RESUME_CHUNK_SIZE - 1) / RESUME_CHUNK_SIZE * RESUME_CHUNK_SIZE;
+    return static_cast<uint32_t>(min<uint64_t>(chunk, UINT32_MAX / RESUME_CHUNK_SIZE * RESUME_CHUNK_SIZE));
+}
+
+bool ResumeJournal::valid(uint64_t size, uint32_t chunk_size)
+{
+    return size && chunk_size && (size + chunk_size - 1) / chunk_size <= MAX_CHUNKS;
+}
@@ -0,0 +1,137 @@
+#include <net/rudp/rudp_trace.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ *  把RUDP::dump_trace导出的二进制事件文件转换为qlog风格JSON或CSV，输出到标准输出
+ *  用法: trace_conv <trace.bin> [json|csv] [vantage]
+ *  时间以首个事件为零点，单位毫秒
+ */
+
+static string qlogName(TraceEvent type)
+{
+    switch (type)
+    {
+        case TraceEvent::PACKET_SENT: return "transport:packet_sent";
+        case TraceEvent::PACKET_ACKED: return "recovery:packet_acked";
+        case TraceEvent::PACKET_LOST: return "recovery:packet_lost";
+        case TraceEvent::CWND_CHANGE: return "recovery:metrics_updated";
+        case TraceEvent::RTO_FIRED: return "recovery:loss_timer_updated";
+        case TraceEvent::STATE_CHANGE: return "recovery:congestion_state_updated";
+        case TraceEvent::RTT_SAMPLE: return "recovery:metrics_updated";
+        case TraceEvent::PROBE_SENT: return "recovery:loss_timer_updated";
+        default: return "rudp:unknown";
+    }
+}
+
+static void writeQlogData(ostream& out, const TraceRecord& rec)
+{
+    switch (static_cast<TraceEvent>(rec.type))
+    {
+        case TraceEvent::PACKET_SENT:
+            out << "{\"header\":{\"packet_number\":" << rec.seq << ",\"flags\":" << static_cast<int>(rec.aux)
+                << "},\"raw\":{\"payload_length\":" << rec.len << "}}";
+            break;
+        case TraceEvent::PACKET_ACKED:
+        case TraceEvent::PACKET_LOST:
+            out << "{\"header\":{\"packet_number\":" << rec.seq << "},\"path\":" << static_cast<int>(rec.aux) << "}";
+            break;
+        case TraceEvent::CWND_CHANGE:
+            out << "{\"congestion_window\":" << rec.v1 << ",\"ssthresh\":" << rec.v2
+                << ",\"path\":" << static_cast<int>(rec.aux) << "}";
+            break;
+        case TraceEvent::RTO_FIRED:
+            out << "{\"timer_type\":\"pto\",\"event_type\":\"expired\",\"packet_number\":" << rec.seq
+                << ",\"delta\":" << rec.v1 << "}";
+            break;
+        case TraceEvent::PROBE_SENT:
+            out << "{\"timer_type\":\"pto\",\"event_type\":\"expired\",\"packet_number\":" << rec.seq
+                << ",\"delta\":" << rec.v1 << ",\"tail_probe\":true,\"path\":" << static_cast<int>(rec.aux) << "}";
+            break;
+        case TraceEvent::STATE_CHANGE:
+            out << "{\"new\":\"" << ccStateStr(static_cast<CcState>(rec.aux)) << "\"}";
+            break;
+        case TraceEvent::RTT_SAMPLE:
+            out << "{\"latest_rtt\":" << rec.v1 << ",\"smoothed_rtt\":" << rec.v2
+                << ",\"path\":" << static_cast<int>(rec.aux) << "}";
+            break;
+        default: out << "{}";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: trace_conv <trace.bin> [json|csv] [vantage]" << endl;
+        return 1;
+    }
+
+    string format  = argc > 2 ? argv[2] : "json";
+    string vantage = argc > 3 ? argv[3] : "client";
+
+    ifstream in(argv[1], ios::binary);
+    if (!in.is_open())
+    {
+        cerr << "Failed to open trace file: " << argv[1] << endl;
+        return 1;
+    }
+
+    TraceFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != TRACE_MAGIC || header.record_size != sizeof(TraceRecord))
+    {
+        cerr << "Not a RUDP trace file (or version mismatch): " << argv[1] << endl;
+        return 1;
+    }
+
+    // 头部的记录数不可信(写入中断或文件被截断)，以文件实际容纳的整条记录数为上限
+    in.seekg(0, ios::end);
+    uint64_t available = (static_cast<uint64_t>(in.tellg()) - sizeof(header)) / sizeof(TraceRecord);
+    in.seekg(sizeof(header));
+    uint64_t count = min<uint64_t>(header.count, available);
+    if (count < header.count)
+        cerr << "Trace truncated: header claims " << header.count << " records, file holds " << available << "."
+             << endl;
+
+    vector<TraceRecord> records(count);
+    in.read(reinterpret_cast<char*>(records.data()), count * sizeof(TraceRecord));
+    records.resize(in.gcount() / sizeof(TraceRecord));
+
+    uint64_t origin = records.empty() ? 0 : records.front().ts_ns;
+
+    if (format == "csv")
+    {
+        cout << "time_ms,event,seq,len,aux,v1,v2" << endl;
+        for (const auto& rec : records)
+        {
+            TraceEvent type = static_cast<TraceEvent>(rec.type);
+            cout << (rec.ts_ns - origin) / 1e6 << ',' << traceEventStr(type) << ',' << rec.seq << ',' << rec.len << ','
+                 << static_cast<int>(rec.aux) << ',' << rec.v1 << ',' << rec.v2 << endl;
+        }
+        return 0;
+    }
+
+    if (format != "json")
+    {
+        cerr << "Unknown format: " << format << endl;
+        return 1;
+    }
+
+    cout << "{\"qlog_version\":\"0.3\",\"qlog_format\":\"JSON\",\"traces\":[{\"vantage_point\":{\"type\":\"" << vantage
+         << "\"},\"common_fields\":{\"time_format\":\"relative\",\"reference_time\":0},\"events\":[";
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        const TraceRecord& rec = records[i];
+        cout << (i ? ",\n" : "\n") << "{\"time\":" << (rec.ts_ns - origin) / 1e6 << ",\"name\":\""
+             << qlogName(static_cast<TraceEvent>(rec.type)) << "\",\"data\":";
+        writeQlogData(cout, rec);
+        cout << "}";
+    }
+    cout << "\n]}]}" << endl;
+    return 0;
+}